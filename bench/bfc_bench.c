@@ -0,0 +1,644 @@
+#define _GNU_SOURCE
+
+#include "bfc_cli.h"
+#include "bfc_codegen.h"
+#include "bfc_driver.h"
+#include "bfc_error.h"
+#include "bfc_io.h"
+#include "bfc_pass.h"
+#include "bfc_report.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Benchmark harness: compiles every workload in-process to time the
+ * compiler phase by phase and count IR instructions around each pass, then
+ * runs the real bfc binary and the executables it writes as child
+ * processes to measure compile peak RSS and the runtime of each execution
+ * engine. Timings are the best of --repeat runs. Results go out as JSON.
+ */
+
+#define BFC_BENCH_MAX_FLAGS   16
+#define BFC_BENCH_MAX_PHASES  BFC_REPORT_MAX_PHASES
+#define BFC_BENCH_ENGINES     3
+
+typedef bfc_error_t (*bfc_bench_generator_t)(const char *path, const size_t param);
+
+typedef struct {
+	const char *name;
+
+	// vendored under the corpus directory, or NULL when `generate` writes the source
+	const char *file;
+	bfc_bench_generator_t generate;
+
+	const char *flags[4];
+} bfc_bench_workload_t;
+
+typedef struct {
+	const char *name;
+	double seconds;
+
+	// IR instructions going into the phase and coming out of it, 0 before there is IR
+	size_t ir_before;
+	size_t ir_after;
+} bfc_bench_phase_t;
+
+typedef struct {
+	bfc_bench_phase_t phases[BFC_BENCH_MAX_PHASES];
+	size_t phase_count;
+	size_t arena_bytes;
+	size_t code_bytes;
+	char error[512];
+} bfc_bench_compile_t;
+
+typedef struct {
+	uint8_t ran;
+	double seconds;
+	long peak_rss_kib;
+	int exit_status;
+	int signal;
+	size_t output_bytes;
+} bfc_bench_proc_t;
+
+typedef struct {
+	const char *bfc;
+	const char *corpus;
+	const char *output;
+	const char *scratch;
+	unsigned repeat;
+	unsigned timeout;
+	size_t huge_size;
+	size_t depth;
+
+	// appended to every compile, after the workload's own flags
+	char *extra_flags[BFC_BENCH_MAX_FLAGS];
+	size_t extra_count;
+
+	char **only;
+	size_t only_count;
+} bfc_bench_opts_t;
+
+static const char *const bfc_bench_engines[BFC_BENCH_ENGINES] = { "interpret", "run", "native" };
+
+static bfc_error_t bfc_bench_write_huge(const char *path, const size_t size);
+static bfc_error_t bfc_bench_write_deep(const char *path, const size_t depth);
+
+static const bfc_bench_workload_t bfc_bench_workloads[] = {
+	{ "fractal",        "fractal.b",        NULL, { NULL } },
+	{ "disc-moves",     "disc-moves.b",     NULL, { NULL } },
+	{ "trial-division", "trial-division.b", NULL, { "-fcell-width=16", NULL } },
+	{ "ripple-counter", "ripple-counter.b", NULL, { NULL } },
+	{ "nested-sevens",  "nested-sevens.b",  NULL, { NULL } },
+	{ "huge",           NULL,               bfc_bench_write_huge, { NULL } },
+	{ "deep",           NULL,               bfc_bench_write_deep, { NULL } },
+};
+
+static double bfc_bench_now(void) {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Straight-line code of about `size` bytes: runs of '+', '-', '<' and '>'
+ * with clear and transfer loops sprinkled in, split into lines. The pointer
+ * stays within the first 64 cells, so the program runs to completion.
+ */
+static bfc_error_t bfc_bench_write_huge(const char *path, const size_t size) {
+
+	static const char *const loops[] = { "[-]", "[->+<]", "[->>+++<<]", "[-<+>]" };
+
+	char *buffer = (char*) malloc(size + 128);
+	if (!buffer) return BFC_ERR_ALLOC;
+
+	uint64_t state = 0x2545F4914F6CDD1Dull;
+	size_t length = 0;
+	size_t line = 0;
+	size_t ptr = 8;
+
+	// the transfer loops reach one cell to the left, so start a few cells in
+	memset(buffer, '>', ptr);
+	length += ptr;
+
+	while (length < size) {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		const uint32_t r = (uint32_t) (state >> 33);
+		const size_t run = 1 + (r >> 8) % 12;
+
+		switch (r % 8) {
+			case 0: case 1: case 2: memset(buffer + length, '+', run); length += run; break;
+			case 3: case 4:         memset(buffer + length, '-', run); length += run; break;
+
+			case 5: {
+				const size_t steps = (ptr + run < 60) ? run : 0;
+				memset(buffer + length, '>', steps);
+				length += steps;
+				ptr += steps;
+			} break;
+
+			case 6: {
+				const size_t steps = (ptr >= run + 4) ? run : 0;
+				memset(buffer + length, '<', steps);
+				length += steps;
+				ptr -= steps;
+			} break;
+
+			default: {
+				const char *loop = loops[(r >> 16) % 4];
+				const size_t n = strlen(loop);
+				memcpy(buffer + length, loop, n);
+				length += n;
+			} break;
+		}
+
+		if (length - line >= 72) {
+			buffer[length++] = '\n';
+			line = length;
+		}
+	}
+
+	bfc_error_t err = bfc_write_file(path, buffer, length);
+	free(buffer);
+
+	return err;
+}
+
+// `depth` loops nested inside each other, each entered exactly once
+static bfc_error_t bfc_bench_write_deep(const char *path, const size_t depth) {
+
+	char *buffer = (char*) malloc(5 * depth + 1);
+	if (!buffer) return BFC_ERR_ALLOC;
+
+	size_t length = 0;
+	for (size_t i = 0; i < depth; ++i) {
+		memcpy(buffer + length, ">+[-", 4);
+		length += 4;
+	}
+
+	memset(buffer + length, ']', depth);
+	length += depth;
+	buffer[length++] = '\n';
+
+	bfc_error_t err = bfc_write_file(path, buffer, length);
+	free(buffer);
+
+	return err;
+}
+
+static void bfc_bench_record(bfc_bench_compile_t *result, const char *name, const double seconds, const size_t ir_before, const size_t ir_after) {
+
+	bfc_bench_phase_t *phase = &result->phases[result->phase_count++];
+
+	phase->name = name;
+	phase->seconds = seconds;
+	phase->ir_before = ir_before;
+	phase->ir_after = ir_after;
+}
+
+// bfc's own pipeline for an executable, one phase per step it reports under -ftime-report
+static bfc_error_t bfc_bench_compile(bfc_bench_compile_t *result, const bfc_args_t cmd_args) {
+
+	bfc_driver_t driver = {0};
+	bfc_asm_t *asm_prog = NULL;
+	char *image         = NULL;
+	size_t image_length = 0;
+
+	result->phase_count = 0;
+
+	driver.report.time = 1;
+
+	bfc_error_t err = bfc_driver_frontend(&driver, &cmd_args, stderr);
+	if (err.code == ERR_OK) err = bfc_driver_executable(&driver, &cmd_args, &asm_prog, &image, &image_length);
+	if (err.code != ERR_OK) goto end;
+
+	const bfc_report_t *report = &driver.report;
+
+	for (size_t i = 0; i < report->length && result->phase_count < BFC_BENCH_MAX_PHASES; ++i) {
+		const bfc_report_phase_t *phase = &report->phases[i];
+		const int pass = bfc_pass_find(phase->name);
+
+		// a pass rerun towards a fixpoint is reported once, with the IR it started and ended with
+		if (pass >= 0) {
+			const bfc_pass_stat_t *stat = &driver.pass_ctx.stats[pass];
+
+			bfc_bench_record(result, phase->name, phase->wall, stat->before, stat->after);
+			continue;
+		}
+
+		const size_t ir_before = (phase->in_unit && strcmp(phase->in_unit, "instrs") == 0) ? phase->in : 0;
+		const size_t ir_after = (phase->out_unit && strcmp(phase->out_unit, "instrs") == 0) ? phase->out : 0;
+
+		bfc_bench_record(result, phase->name, phase->wall, ir_before, ir_after);
+	}
+
+	result->arena_bytes = driver.arena->bytes_reserved;
+	result->code_bytes = image_length;
+
+end:
+	bfc_driver_destroy(&driver);
+	if (asm_prog) bfc_asm_destroy(&asm_prog);
+	free(image);
+
+	return err;
+}
+
+/*
+ * Runs `argv` with stdin from /dev/null and stdout drained into a pipe, so
+ * output costs the same for every engine. A child that outlives `timeout`
+ * seconds is killed by SIGALRM, which is then reported as its signal.
+ */
+static void bfc_bench_spawn(char *const argv[], const unsigned timeout, bfc_bench_proc_t *proc) {
+
+	int fds[2];
+	if (pipe(fds) != 0) return;
+
+	const double start = bfc_bench_now();
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+
+		return;
+	}
+
+	if (pid == 0) {
+		int null_fd = open("/dev/null", O_RDWR);
+
+		dup2(null_fd, STDIN_FILENO);
+		dup2(fds[1], STDOUT_FILENO);
+		dup2(null_fd, STDERR_FILENO);
+		close(fds[0]);
+
+		alarm(timeout);
+		execv(argv[0], argv);
+		_exit(127);
+	}
+
+	close(fds[1]);
+
+	char buffer[65536];
+	size_t output_bytes = 0;
+	ssize_t n;
+	while ((n = read(fds[0], buffer, sizeof(buffer))) != 0) {
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) break;
+
+		output_bytes += (size_t) n;
+	}
+
+	close(fds[0]);
+
+	int status = 0;
+	struct rusage usage;
+	while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR);
+
+	const double seconds = bfc_bench_now() - start;
+
+	if (!proc->ran || seconds < proc->seconds) proc->seconds = seconds;
+	if (usage.ru_maxrss > proc->peak_rss_kib) proc->peak_rss_kib = usage.ru_maxrss;
+
+	proc->ran = 1;
+	proc->output_bytes = output_bytes;
+	proc->exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	proc->signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+}
+
+static void bfc_bench_json_string(FILE *out, const char *str) {
+
+	fputc('"', out);
+
+	for (; *str; ++str) {
+		if (*str == '"' || *str == '\\') {
+			fprintf(out, "\\%c", *str);
+		} else if ((unsigned char) *str < 0x20) {
+			fprintf(out, "\\u%04x", *str);
+		} else {
+			fputc(*str, out);
+		}
+	}
+
+	fputc('"', out);
+}
+
+static void bfc_bench_json_proc(FILE *out, const bfc_bench_proc_t *proc) {
+
+	if (!proc->ran) {
+		fprintf(out, "null");
+		return;
+	}
+
+	fprintf(out,
+		"{ \"seconds\": %.6f, \"peak_rss_kib\": %ld, \"exit_status\": %d, \"signal\": %d, \"output_bytes\": %zu }",
+		proc->seconds, proc->peak_rss_kib, proc->exit_status, proc->signal, proc->output_bytes
+	);
+}
+
+static void bfc_bench_json_workload(
+	FILE *out, const bfc_bench_workload_t *workload, const char *path, const size_t source_bytes,
+	const bfc_bench_compile_t *compile, const bfc_bench_proc_t *compile_proc, const bfc_bench_proc_t *engines
+) {
+
+	fprintf(out, "    {\n      \"name\": ");
+	bfc_bench_json_string(out, workload->name);
+	fprintf(out, ",\n      \"file\": ");
+	bfc_bench_json_string(out, path);
+	fprintf(out, ",\n      \"flags\": [");
+
+	for (size_t i = 0; workload->flags[i]; ++i) {
+		if (i > 0) fprintf(out, ", ");
+		bfc_bench_json_string(out, workload->flags[i]);
+	}
+
+	fprintf(out, "],\n      \"source_bytes\": %zu,\n      \"compile\": {\n", source_bytes);
+
+	if (compile->error[0]) {
+		fprintf(out, "        \"error\": ");
+		bfc_bench_json_string(out, compile->error);
+		fprintf(out, ",\n");
+	}
+
+	double total = 0;
+	fprintf(out, "        \"phases\": [\n");
+
+	for (size_t i = 0; i < compile->phase_count; ++i) {
+		const bfc_bench_phase_t *phase = &compile->phases[i];
+		total += phase->seconds;
+
+		fprintf(out, "          { \"name\": ");
+		bfc_bench_json_string(out, phase->name);
+		fprintf(out,
+			", \"seconds\": %.6f, \"ir_before\": %zu, \"ir_after\": %zu }%s\n",
+			phase->seconds, phase->ir_before, phase->ir_after, (i + 1 < compile->phase_count) ? "," : ""
+		);
+	}
+
+	fprintf(out, "        ],\n        \"seconds\": %.6f,\n", total);
+	fprintf(out, "        \"arena_bytes\": %zu,\n        \"code_bytes\": %zu,\n", compile->arena_bytes, compile->code_bytes);
+	fprintf(out, "        \"process\": ");
+	bfc_bench_json_proc(out, compile_proc);
+	fprintf(out, "\n      },\n      \"engines\": {\n");
+
+	for (size_t i = 0; i < BFC_BENCH_ENGINES; ++i) {
+		fprintf(out, "        \"%s\": ", bfc_bench_engines[i]);
+		bfc_bench_json_proc(out, &engines[i]);
+		fprintf(out, "%s\n", (i + 1 < BFC_BENCH_ENGINES) ? "," : "");
+	}
+
+	fprintf(out, "      }\n    }");
+}
+
+static uint8_t bfc_bench_selected(const bfc_bench_opts_t *opts, const char *name) {
+
+	if (opts->only_count == 0) return 1;
+
+	for (size_t i = 0; i < opts->only_count; ++i) {
+		if (strcmp(opts->only[i], name) == 0) return 1;
+	}
+
+	return 0;
+}
+
+static void bfc_bench_usage(void) {
+
+	printf("USAGE: bfc_bench [options] [workload...] [-- <bfc flags>]\n\n");
+	printf("OPTIONS:\n");
+	printf("  %-20s %s\n", "--bfc=<path>",      "bfc binary the engines are run with (default: ./bfc)");
+	printf("  %-20s %s\n", "--corpus=<dir>",    "Directory holding the vendored programs (default: bench/corpus)");
+	printf("  %-20s %s\n", "--depth=<n>",       "Nesting depth of the generated deep program (default: 5000)");
+	printf("  %-20s %s\n", "--huge-size=<n>",   "Size in bytes of the generated huge program (default: 8 MiB)");
+	printf("  %-20s %s\n", "--repeat=<n>",      "Runs per measurement, the best is kept (default: 3)");
+	printf("  %-20s %s\n", "--timeout=<s>",     "Seconds a single run may take (default: 120)");
+	printf("  %-20s %s\n", "-o <file>",         "Write the JSON report to <file> ('-' for stdout, default: bench_output.json)");
+}
+
+static int bfc_bench_parse_size(const char *str, size_t *value) {
+
+	char *end = NULL;
+	unsigned long long n = (*str >= '0' && *str <= '9') ? strtoull(str, &end, 10) : 0;
+
+	if (n == 0 || *end != '\0') return 0;
+
+	*value = (size_t) n;
+
+	return 1;
+}
+
+static int bfc_bench_parse_args(bfc_bench_opts_t *opts, int argc, char **argv) {
+
+	size_t value;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--") == 0) {
+			for (++i; i < argc && opts->extra_count < BFC_BENCH_MAX_FLAGS; ++i)
+				opts->extra_flags[opts->extra_count++] = argv[i];
+
+			if (i < argc) {
+				fprintf(stderr, "bfc_bench: at most %d bfc flags can be passed\n", BFC_BENCH_MAX_FLAGS);
+				return 0;
+			}
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			opts->output = argv[++i];
+		} else if (strncmp(argv[i], "--bfc=", 6) == 0) {
+			opts->bfc = argv[i] + 6;
+		} else if (strncmp(argv[i], "--corpus=", 9) == 0) {
+			opts->corpus = argv[i] + 9;
+		} else if (strncmp(argv[i], "--depth=", 8) == 0 && bfc_bench_parse_size(argv[i] + 8, &value)) {
+			opts->depth = value;
+		} else if (strncmp(argv[i], "--huge-size=", 12) == 0 && bfc_bench_parse_size(argv[i] + 12, &value)) {
+			opts->huge_size = value;
+		} else if (strncmp(argv[i], "--repeat=", 9) == 0 && bfc_bench_parse_size(argv[i] + 9, &value)) {
+			opts->repeat = (unsigned) value;
+		} else if (strncmp(argv[i], "--timeout=", 10) == 0 && bfc_bench_parse_size(argv[i] + 10, &value)) {
+			opts->timeout = (unsigned) value;
+		} else if (argv[i][0] == '-') {
+			bfc_bench_usage();
+			return 0;
+		} else {
+			opts->only[opts->only_count++] = argv[i];
+		}
+	}
+
+	return 1;
+}
+
+int main(int argc, char **argv) {
+
+	int ret = EXIT_FAILURE;
+	FILE *out = NULL;
+	char scratch[] = "/tmp/bfc-bench-XXXXXX";
+
+	bfc_bench_opts_t opts = {
+		.bfc = "./bfc",
+		.corpus = "bench/corpus",
+		.output = "bench_output.json",
+		.repeat = 3,
+		.timeout = 120,
+		.huge_size = 8 * 1024 * 1024,
+		.depth = 5000,
+	};
+
+	opts.only = (char**) calloc((size_t) argc, sizeof(char*));
+	if (!opts.only || !bfc_bench_parse_args(&opts, argc, argv)) goto end;
+
+	if (!mkdtemp(scratch)) {
+		perror("bfc_bench: mkdtemp");
+		goto end;
+	}
+
+	opts.scratch = scratch;
+
+	out = (strcmp(opts.output, "-") == 0) ? stdout : fopen(opts.output, "w");
+	if (!out) {
+		perror(opts.output);
+		goto end;
+	}
+
+	fprintf(out, "{\n  \"bfc\": ");
+	bfc_bench_json_string(out, opts.bfc);
+	fprintf(out, ",\n  \"repeat\": %u,\n  \"workloads\": [\n", opts.repeat);
+
+	ret = EXIT_SUCCESS;
+
+	size_t written = 0;
+	const size_t workload_count = sizeof(bfc_bench_workloads) / sizeof(bfc_bench_workloads[0]);
+
+	for (size_t w = 0; w < workload_count; ++w) {
+		const bfc_bench_workload_t *workload = &bfc_bench_workloads[w];
+		if (!bfc_bench_selected(&opts, workload->name)) continue;
+
+		char path[4096];
+		char exe_path[4096];
+		snprintf(exe_path, sizeof(exe_path), "%s/%s", opts.scratch, workload->name);
+
+		if (workload->file) {
+			snprintf(path, sizeof(path), "%s/%s", opts.corpus, workload->file);
+		} else {
+			snprintf(path, sizeof(path), "%s/%s.b", opts.scratch, workload->name);
+
+			bfc_error_t err = workload->generate(path, (workload->generate == bfc_bench_write_huge) ? opts.huge_size : opts.depth);
+			if (err.code != ERR_OK) {
+				fprintf(stderr, "bfc_bench: %s: %s\n", workload->name, err.msg);
+				ret = EXIT_FAILURE;
+				continue;
+			}
+		}
+
+		struct stat st;
+		if (stat(path, &st) != 0) {
+			perror(path);
+			ret = EXIT_FAILURE;
+			continue;
+		}
+
+		// bfc <workload flags> <extra flags> [engine flag] <file> [-o <exe>]
+		char *bfc_argv[BFC_BENCH_MAX_FLAGS * 2 + 8];
+		size_t bfc_argc = 0;
+
+		bfc_argv[bfc_argc++] = (char*) opts.bfc;
+		for (size_t i = 0; workload->flags[i]; ++i) bfc_argv[bfc_argc++] = (char*) workload->flags[i];
+		for (size_t i = 0; i < opts.extra_count; ++i) bfc_argv[bfc_argc++] = opts.extra_flags[i];
+
+		const size_t flag_end = bfc_argc;
+
+		bfc_argv[bfc_argc++] = path;
+		bfc_argv[bfc_argc] = NULL;
+
+		bfc_args_t cmd_args = {0};
+		bfc_bench_compile_t compile = {0};
+
+		bfc_error_t err = bfc_process_args(&cmd_args, (int) bfc_argc, bfc_argv);
+
+		for (unsigned r = 0; r < opts.repeat && err.code == ERR_OK; ++r) {
+			bfc_bench_compile_t run = {0};
+
+			err = bfc_bench_compile(&run, cmd_args);
+			if (err.code != ERR_OK) {
+				compile = run;
+				break;
+			}
+
+			if (r == 0) {
+				compile = run;
+				continue;
+			}
+
+			for (size_t i = 0; i < run.phase_count; ++i) {
+				if (run.phases[i].seconds < compile.phases[i].seconds) compile.phases[i].seconds = run.phases[i].seconds;
+			}
+		}
+
+		bfc_args_destroy(&cmd_args);
+
+		if (err.code != ERR_OK) {
+			snprintf(compile.error, sizeof(compile.error), "%s", err.msg);
+			fprintf(stderr, "bfc_bench: %s: %s\n", workload->name, err.msg);
+			ret = EXIT_FAILURE;
+		}
+
+		bfc_bench_proc_t compile_proc = {0};
+		bfc_bench_proc_t engines[BFC_BENCH_ENGINES] = {{0}};
+
+		char *compile_argv[BFC_BENCH_MAX_FLAGS * 2 + 8];
+		memcpy(compile_argv, bfc_argv, bfc_argc * sizeof(char*));
+		compile_argv[bfc_argc] = "-o";
+		compile_argv[bfc_argc + 1] = exe_path;
+		compile_argv[bfc_argc + 2] = NULL;
+
+		char *engine_argv[BFC_BENCH_MAX_FLAGS * 2 + 8];
+		memcpy(engine_argv, bfc_argv, flag_end * sizeof(char*));
+		engine_argv[flag_end + 1] = path;
+		engine_argv[flag_end + 2] = NULL;
+
+		char *native_argv[] = { exe_path, NULL };
+
+		for (unsigned r = 0; r < opts.repeat && err.code == ERR_OK; ++r) {
+			bfc_bench_spawn(compile_argv, opts.timeout, &compile_proc);
+			if (!compile_proc.ran || compile_proc.exit_status != 0) break;
+
+			engine_argv[flag_end] = "--interpret";
+			bfc_bench_spawn(engine_argv, opts.timeout, &engines[0]);
+
+			engine_argv[flag_end] = "--run";
+			bfc_bench_spawn(engine_argv, opts.timeout, &engines[1]);
+
+			bfc_bench_spawn(native_argv, opts.timeout, &engines[2]);
+		}
+
+		fprintf(stderr, "%-15s compile %9.3f ms", workload->name, compile_proc.seconds * 1e3);
+		for (size_t i = 0; i < BFC_BENCH_ENGINES; ++i) {
+			if (!engines[i].ran) continue;
+
+			fprintf(stderr, "  %s %8.3f s", bfc_bench_engines[i], engines[i].seconds);
+			if (engines[i].exit_status != 0) fprintf(stderr, " (failed)");
+		}
+		fprintf(stderr, "\n");
+
+		fprintf(out, "%s", written++ ? ",\n" : "");
+		bfc_bench_json_workload(out, workload, path, (size_t) st.st_size, &compile, &compile_proc, engines);
+
+		unlink(exe_path);
+		if (!workload->file) unlink(path);
+	}
+
+	fprintf(out, "\n  ]\n}\n");
+
+end:
+	if (out && out != stdout) fclose(out);
+	if (opts.scratch) rmdir(opts.scratch);
+	free(opts.only);
+
+	return ret;
+}
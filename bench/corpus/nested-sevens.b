@@ -0,0 +1,13 @@
+; nested-sevens.b: eight nested loops of 7 iterations each bumping a 16-bit
+; counter whose body does not reduce to a multiplication; prints "OK". 8-bit
+; cells.
+
++++++++[>+++++++[>+++++++[>+++++++[>+++++++[>+++++++[>+++++++[>+++++++[>
++>>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[<[-]>[-]]<[<+>[-]]<<<-]<-]<-]<-]<-]
+<-]<-]<-]>>>>>>>>+++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++>++++++++++[-<+>]>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++.-.+++.----------
+------------------------------------------------.[-]<<[-]>[-]]<[>>++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++.----.-----------------------------------------------------------------
+.[-]<<[-]]
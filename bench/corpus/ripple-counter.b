@@ -0,0 +1,57 @@
+; ripple-counter.b: three nested counting loops (250 * 250 * 160 iterations)
+; driving a 24-bit ripple-carry counter; prints its three bytes, "152 150
+; 128". 8-bit cells.
+
+------[>------[>--------------------------------------------------------
+----------------------------------------[>+>>>+<<<[->>>>+>+<<<<<]>>>>>[-
+<<<<<+>>>>>]<[<[-]>[-]]<[<<+>>>+<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<[<
+[-]>[-]]<[<<+>>[-]]<[-]]<<<<-]<-]<-]>>>>>[->>>>+>>+<<<<<<]>>>>>>[-<<<<<<
++>>>>>>]<++++++++++<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>
+>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+
+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<<+>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>
+[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<
+[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+
+>]>+>>]<<<<<]>>[-<<<<<<<+>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[-
+>>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+
+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<
+]>>[-<<<<<<+>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[-]>[-]<<[->>+>+
+<<<]>>>[-<<<+>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<[->>>>+>+
+<<<<<]>>>>>[-<<<<<+>>>>>]<++++++++++++++++++++++++++++++++++++++++++++++
+++.[-]<<<[-]+>>[-]]<[-]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<[->+>+<<]>>[-<<
++>>]<[->+>+<<]>>[-<<+>>]<[<<<<[->>>>>+>+<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<++
+++++++++++++++++++++++++++++++++++++++++++++++.[-]<<<[-]+>>[-]]<[-]<<<<[
+->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<++++++++++++++++++++++++++++++++++++++
+++++++++++.[-]<[-]<<<[-]>[-]>[-]<<++++++++++++++++++++++++++++++++.[-]<<
+[->>>>>+>>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<++++++++++<[->>>+>>>>>>+<<<
+<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>
+>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<<+
+>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>
+>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<
+<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<+>>>>>>>]>[-
+<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<
+<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>
+]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<+>>>>>>]>[-<<<<+>>>>]<<[-
+]<<<<[-]>>[-<<+>>]<<[-]>[-]<<[->>+>+<<<]>>>[-<<<+>>>]<<[->+>+<<]>>[-<<+>
+>]<[->+>+<<]>>[-<<+>>]<[<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<++++++++++
+++++++++++++++++++++++++++++++++++++++.[-]<<<[-]+>>[-]]<[-]<<<[->>>+>+<<
+<<]>>>>[-<<<<+>>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<<[->>>>
+>+>+<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<++++++++++++++++++++++++++++++++++++++
+++++++++++.[-]<<<[-]+>>[-]]<[-]<<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<++
+++++++++++++++++++++++++++++++++++++++++++++++.[-]<[-]<<<[-]>[-]>[-]<<++
+++++++++++++++++++++++++++++++.[-]<<<[->>>>>>+>>+<<<<<<<<]>>>>>>>>[-<<<<
+<<<<+>>>>>>>>]<++++++++++<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>
+>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[
+->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<<+>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<
+<[-]>>[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<
+<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>
+[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<+>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>
+>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+
+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>
+]<<<<<]>>[-<<<<<<+>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[-]>[-]<<[
+->>+>+<<<]>>>[-<<<+>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<[->
+>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<++++++++++++++++++++++++++++++++++++++++
+++++++++.[-]<<<[-]+>>[-]]<[-]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<[->+>+<<]
+>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<<[->>>>>+>+<<<<<<]>>>>>>[-<<<<<<+>>>>
+>>]<++++++++++++++++++++++++++++++++++++++++++++++++.[-]<<<[-]+>>[-]]<[-
+]<<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<++++++++++++++++++++++++++++++++
+++++++++++++++++.[-]<[-]<<<[-]>[-]>[-]<<++++++++++.[-]
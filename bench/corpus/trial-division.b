@@ -0,0 +1,129 @@
+; trial-division.b: prints the prime factorization of every number from 2 to 2000
+; by trial division. Needs -fcell-width=16.
+; bfc-flags: -fcell-width=16
+
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++>++<[>[->>>>>>>>>
++>>+<<<<<<<<<<<]>>>>>>>>>>>[-<<<<<<<<<<<+>>>>>>>>>>>]<++++++++++<[->>>+>
+>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<
+<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-
+<<<<<<<<<<+>>>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[->>>+>>>>>>+
+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>
+>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<
+<<<+>>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<
+<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-
+<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<<+>>>>>
+>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>
+>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>
+>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<+>>>>>>>]>[-<<<<+
+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<
++>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<
+<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<+>>>>>>]>[-<<<<+>>>>]<<[-]<<<<
+[-]>>[-<<+>>]<<[-]>[-]<<[->>+>+<<<]>>>[-<<<+>>>]<<[->+>+<<]>>[-<<+>>]<[-
+>+>+<<]>>[-<<+>>]<[<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<+++++++++++++++
++++++++++++++++++++++++++++++++++.[-]<<<[-]+>>[-]]<[-]<<<[->>>+>+<<<<]>>
+>>[-<<<<+>>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<<[->>>>>+>+<
+<<<<<]>>>>>>[-<<<<<<+>>>>>>]<+++++++++++++++++++++++++++++++++++++++++++
++++++.[-]<<<[-]+>>[-]]<[-]<<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<<[->+>+
+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<<<[->>>>>>+>+<<<<<<<]>>>>>>>[-<<<<
+<<<+>>>>>>>]<++++++++++++++++++++++++++++++++++++++++++++++++.[-]<<<[-]+
+>>[-]]<[-]<<<<<[->>>>>+>+<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<<[->+>+<<]>>[-<<+
+>>]<[->+>+<<]>>[-<<+>>]<[<<<<<<[->>>>>>>+>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>
+>>>>>>>]<++++++++++++++++++++++++++++++++++++++++++++++++.[-]<<<[-]+>>[-
+]]<[-]<<<<<<[->>>>>>+>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<+++++++++++++++
++++++++++++++++++++++++++++++++++.[-]<[-]<<<<<[-]>[-]>[-]>[-]>[-]<<<<+++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++.[-]<<<<[->+>>>+<
+<<<]>>>>[-<<<<+>>>>]<<[-]++>[-]+[<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[-<<<[->
+>+>>+<<<<]>>>>[-<<<<+>>>>]<]<<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<[-<[-
+>>+>+<<<]>>>[-<<<+>>>]<[<<->>[-]]<]+<[->>+>+<<<]>>>[-<<<+>>>]<[<<<[-]>>[
+-]>[-]]<[<<<<[->>>>>>>>+>>>>>>+<<<<<<<<<<<<<<]>>>>>>>>>>>>>>[-<<<<<<<<<<
+<<<<+>>>>>>>>>>>>>>]<<<<<<<<<<<<<[->>>>>>>>+>>>>>+<<<<<<<<<<<<<]>>>>>>>>
+>>>>>[-<<<<<<<<<<<<<+>>>>>>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>
+>[-<<<+>>>]>[-<<<<<+>>>>>]<<[-]<+<[->>+>+<<<]>>>[-<<<+>>>]<[<<<<<<<<+>>>
+>>[-]>>[-]>[-]]<[>>++++++++++++++++++++++++++++++++.[-]<<<<<<<<<[->>>>>>
+>>>>>>>>+>>+<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<+>>>>>>>>
+>>>>>>>>]<++++++++++<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>
+>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>
++>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<<<<+>>>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<
+[-]>>[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<
+<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[
++[-<+>]>+>>]<<<<<]>>[-<<<<<<<<<+>>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<
+<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->
+>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>
++>>]<<<<<]>>[-<<<<<<<<+>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[->
+>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<
+<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]
+>>[-<<<<<<<+>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[->>>+>>>>>>+<<
+<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>
+>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<+>
+>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[-]>[-]<<[->>+>+<<<]>>>[-<<<+
+>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<[->>>>+>+<<<<<]>>>>>[-
+<<<<<+>>>>>]<++++++++++++++++++++++++++++++++++++++++++++++++.[-]<<<[-]+
+>>[-]]<[-]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<
+]>>[-<<+>>]<[<<<<[->>>>>+>+<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<+++++++++++++++
++++++++++++++++++++++++++++++++++.[-]<<<[-]+>>[-]]<[-]<<<<[->>>>+>+<<<<<
+]>>>>>[-<<<<<+>>>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<<<[->>
+>>>>+>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<+++++++++++++++++++++++++++++++
++++++++++++++++++.[-]<<<[-]+>>[-]]<[-]<<<<<[->>>>>+>+<<<<<<]>>>>>>[-<<<<
+<<+>>>>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<<<<[->>>>>>>+>+<
+<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<+++++++++++++++++++++++++++++++++++
++++++++++++++.[-]<<<[-]+>>[-]]<[-]<<<<<<[->>>>>>+>+<<<<<<<]>>>>>>>[-<<<<
+<<<+>>>>>>>]<++++++++++++++++++++++++++++++++++++++++++++++++.[-]<[-]<<<
+<<[-]>[-]>[-]>[-]>[-]<<<<<<<<<<<<<<[-]>>>>>>[-<<<<<<+>>>>>>]>>[-]]<[-]<<
+<[-]]<[-]<]<<-[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[<<<+>>>>+++++++++++++++++++
++++++++++++++.[-]<<<<[->>>>>>>>>+>>+<<<<<<<<<<<]>>>>>>>>>>>[-<<<<<<<<<<<
++>>>>>>>>>>>]<++++++++++<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>
+>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[-
+>-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<<<<+>>>>>>>>>>]>[-<<<<+>>>>]<<[-]
+<<<<[-]>>[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>
+]<<<<<<<<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>
+>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<<<<<<+>>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>
+>[-<<+>>]<<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<
+<[->>>+>>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<
++>]>+>>]<<<<<]>>[-<<<<<<<<+>>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<
+<[->>>+>>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>
+>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<
+<<<]>>[-<<<<<<<+>>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[->>>+>>>>>
+>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<<<[->>>+>>>>>+<<<<<<<<]
+>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<[->-[>+>>]>[+[-<+>]>+>>]<<<<<]>>[-<<<<
+<<+>>>>>>]>[-<<<<+>>>>]<<[-]<<<<[-]>>[-<<+>>]<<[-]>[-]<<[->>+>+<<<]>>>[-
+<<<+>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<[->>>>+>+<<<<<]>>>
+>>[-<<<<<+>>>>>]<++++++++++++++++++++++++++++++++++++++++++++++++.[-]<<<
+[-]+>>[-]]<[-]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<[->+>+<<]>>[-<<+>>]<[->+
+>+<<]>>[-<<+>>]<[<<<<[->>>>>+>+<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<+++++++++++
++++++++++++++++++++++++++++++++++++++.[-]<<<[-]+>>[-]]<[-]<<<<[->>>>+>+<
+<<<<]>>>>>[-<<<<<+>>>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<<<
+[->>>>>>+>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<+++++++++++++++++++++++++++
++++++++++++++++++++++.[-]<<<[-]+>>[-]]<[-]<<<<<[->>>>>+>+<<<<<<]>>>>>>[-
+<<<<<<+>>>>>>]<<[->+>+<<]>>[-<<+>>]<[->+>+<<]>>[-<<+>>]<[<<<<<<[->>>>>>>
++>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<+++++++++++++++++++++++++++++++
++++++++++++++++++.[-]<<<[-]+>>[-]]<[-]<<<<<<[->>>>>>+>+<<<<<<<]>>>>>>>[-
+<<<<<<<+>>>>>>>]<++++++++++++++++++++++++++++++++++++++++++++++++.[-]<[-
+]<<<<<[-]>[-]>[-]>[-]>[-]<<<<<<<<->>>[-]]<<<[-]>[-]>>++++++++++.[-]<<<<+
+<-]
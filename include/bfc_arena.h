@@ -0,0 +1,32 @@
+#ifndef __BFC_ARENA_H
+#define __BFC_ARENA_H
+
+#include <stddef.h>
+
+#include "bfc_error.h"
+
+#define BFC_ARENA_CHUNK_SIZE (64 * 1024)
+
+typedef struct bfc_arena_chunk_t {
+	struct bfc_arena_chunk_t *next;
+	size_t size;
+	size_t used;
+	_Alignas(16) unsigned char data[];
+} bfc_arena_chunk_t;
+
+typedef struct {
+	bfc_arena_chunk_t *head;
+	void *last;
+
+	size_t alloc_count;     // number of allocations served
+	size_t bytes_allocated; // bytes handed out, including copies made by growth
+	size_t bytes_reserved;  // bytes obtained from malloc for chunks
+	size_t chunk_count;
+} bfc_arena_t;
+
+bfc_error_t bfc_arena_create(bfc_arena_t **arena);
+void *bfc_arena_alloc(bfc_arena_t *const arena, const size_t size);
+void *bfc_arena_grow(bfc_arena_t *const arena, void *ptr, const size_t old_size, const size_t new_size);
+void bfc_arena_destroy(bfc_arena_t **parena);
+
+#endif // __BFC_ARENA_H
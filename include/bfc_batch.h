@@ -0,0 +1,23 @@
+#ifndef __BFC_BATCH_H
+#define __BFC_BATCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "bfc_error.h"
+
+#define BFC_BATCH_MAX_JOBS 256
+
+// compiles input `index` of a batch, with its diagnostics going to `diag`; returns an exit status
+typedef int (*bfc_batch_job_t)(void *ctx, const size_t index, FILE *diag);
+
+/*
+ * Runs jobs 0 to `count` - 1 on up to `threads` threads, the calling one
+ * included. Each job's diagnostics are buffered and written to `out` in job
+ * order as soon as every job before it is done, so they come out the same
+ * however the jobs were scheduled. `failed` receives the number of jobs that
+ * did not return EXIT_SUCCESS.
+ */
+bfc_error_t bfc_batch_run(const size_t count, const size_t threads, bfc_batch_job_t job, void *ctx, FILE *out, size_t *failed);
+
+#endif // __BFC_BATCH_H
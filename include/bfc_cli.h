@@ -1,25 +1,60 @@
 #ifndef __BFC_CLI_H
 #define __BFC_CLI_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "bfc_codegen.h"
 #include "bfc_error.h"
+#include "bfc_pass.h"
 
 typedef struct {
 	union {
 		struct {
-			uint8_t do_assemble        : 1;
-			uint8_t ask_help           : 1;
-			uint8_t f_no_comments : 1;
+			uint16_t do_assemble        : 1;
+			uint16_t ask_help           : 1;
+			uint16_t f_no_comments      : 1;
+			uint16_t do_run             : 1;
+			uint16_t do_interpret       : 1;
+			uint16_t f_staged_frontend  : 1;
+			uint16_t f_time_report      : 1;
+			uint16_t f_mem_report       : 1;
 		};
-		uint8_t flags;
+		uint16_t flags;
 	};
+	bfc_runtime_opts_t runtime_opts;
+	bfc_pass_opts_t passes;
+	bfc_arch_t target;
+
+	// -fprofile-generate; empty for the default path next to the input
+	const char *profile_generate;
+
+	// -fprofile-use; likewise
+	const char *profile_use;
+
+	// -j; how many of the inputs are compiled at once
+	size_t jobs;
+
+	// the file being compiled, one of `inputs`; those and the strings are owned by the args
 	char *input;
+	char **inputs;
+	size_t input_count;
+	size_t input_capacity;
+
 	char *outputs[UINT8_MAX];
 } bfc_args_t;
 
 void bfc_cmd_help(void);
 
 bfc_error_t bfc_process_args(bfc_args_t *const cmd_args, int argc, char **argv);
+void bfc_args_destroy(bfc_args_t *const cmd_args);
+
+const char *bfc_get_output_path(const bfc_args_t *const cmd_args, char *path_buf, const size_t size, const char *ext);
+
+// -o if given, a.out for a single input and the input's name without its extension in a batch
+const char *bfc_get_executable_path(const bfc_args_t *const cmd_args, char *path_buf, const size_t size);
+
+// `path` if one was given, otherwise the input's name with BFC_PROFILE_EXT
+const char *bfc_get_profile_path(const bfc_args_t *const cmd_args, const char *path, char *path_buf, const size_t size);
 
 #endif // __BFC_CLI_H
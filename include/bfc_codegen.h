@@ -1,10 +1,14 @@
 #ifndef __BFC_CODEGEN_H
 #define __BFC_CODEGEN_H
 
+#include <stdint.h>
 #include <sys/types.h>
 
 #include "bfc_error.h"
+#include "bfc_eval.h"
+#include "bfc_io.h"
 #include "bfc_ir.h"
+#include "bfc_profile.h"
 
 typedef enum {
 	ARCH_X86_64,
@@ -13,50 +17,188 @@ typedef enum {
 	ARCH_arm32,
 } bfc_arch_t;
 
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define BFC_HOST_ARCH ARCH_aarch64
+#elif defined(__i386__) || defined(_M_IX86)
+#define BFC_HOST_ARCH ARCH_i386
+#elif defined(__arm__) || defined(_M_ARM)
+#define BFC_HOST_ARCH ARCH_arm32
+#else
+#define BFC_HOST_ARCH ARCH_X86_64
+#endif
+
 typedef enum {
 	OS_WIN,
 	OS_MAC,
 	OS_LINUX,
 } bfc_os_t;
 
+typedef enum {
+	ASM_FMT_TEXT,
+
+	// position-independent machine code for `void entry(uint8_t *tape)`
+	ASM_FMT_JIT,
+
+	// machine code for a freestanding program that starts at offset 0 and maps its own tape
+	ASM_FMT_EXEC,
+} bfc_asm_format_t;
+
+#define BFC_XSTR(x)  #x
+#define BFC_STR(x)   BFC_XSTR(x)
+
+// default tape length in cells
+#define BFC_TAPE_SIZE 30000
+
+// tape and guards are sized in multiples of this, so both ends of the tape are page aligned on any common page size
+#define BFC_TAPE_GRANULE (64 * 1024)
+#define BFC_TAPE_MAX_BYTES ((size_t) 1024 * 1024 * 1024)
+
+#define BFC_IO_BUFFER_SIZE (64 * 1024)
+
+// what `,` stores once the input is exhausted
+typedef enum {
+	EOF_UNCHANGED,
+	EOF_ZERO,
+	EOF_MINUS_ONE,
+} bfc_eof_t;
+
+// run-time behaviour every execution engine has to agree on
+typedef struct {
+	bfc_eof_t eof;
+	size_t tape_size;     // in cells
+	uint8_t cell_width;   // in bytes: 1, 2 or 4
+
+	// set for -fprofile-generate: the program counts its loops and writes the profile when it ends
+	const bfc_profile_t *profile;
+} bfc_runtime_opts_t;
+
+/*
+ * Memory native code runs on, addressed from cell 0:
+ * [guard][tape][guard][output buffer][input buffer][counters]. The guards are
+ * PROT_NONE and span at least the furthest a program can get past the
+ * tape between two accesses, so running off either end faults instead of
+ * touching other memory.
+ */
+typedef struct {
+	size_t tape_bytes;
+	size_t guard_bytes;
+	size_t output_offset;
+	size_t input_offset;
+
+	// 64-bit profile counters, none unless the program is instrumented
+	size_t counter_offset;
+	size_t counter_bytes;
+
+	// the whole mapping, starting at the lower guard
+	size_t map_size;
+} bfc_runtime_layout_t;
+
+// where generated code at `pc` came from; `pc` is a label id in text output
+typedef struct {
+	size_t pc;
+	uint32_t line;
+	uint32_t col;
+} bfc_asm_loc_t;
+
 struct bfc_asm_t;
 
+typedef struct {
+	size_t offset;
+	size_t label;
+} bfc_asm_fixup_t;
+
 typedef struct {
 	void (*emit_header)(struct bfc_asm_t *asm_prog);
 	void (*emit_data_section)(struct bfc_asm_t *asm_prog);
 	void (*emit_symbol)(struct bfc_asm_t *asm_prog);
 	void (*emit_end)(struct bfc_asm_t *asm_prog);
+	void (*emit_label)(struct bfc_asm_t *asm_prog, const char *label);
+
+	// pads to the next 16-byte boundary so a hot loop body starts on a fresh fetch block
+	void (*emit_align)(struct bfc_asm_t *asm_prog);
+
+	// restores `asm_prog->snapshot` at program start; its data goes into the data section
+	void (*emit_snapshot)(struct bfc_asm_t *asm_prog);
 	
-	void (*emit_op_add)(struct bfc_asm_t *asm_prog, ssize_t imm);
+	// cell ops address tape[ptr + off]
+	void (*emit_op_add)(struct bfc_asm_t *asm_prog, ssize_t off, ssize_t imm);
 	void (*emit_op_move)(struct bfc_asm_t *asm_prog, ssize_t imm);
-	void (*emit_op_get)(struct bfc_asm_t *asm_prog);
-	void (*emit_op_put)(struct bfc_asm_t *asm_prog);
-	void (*emit_op_set)(struct bfc_asm_t *asm_prog, ssize_t imm);
+	void (*emit_op_get)(struct bfc_asm_t *asm_prog, ssize_t off);
+	void (*emit_op_put)(struct bfc_asm_t *asm_prog, ssize_t off);
+
+	// makes room for the next `count` PUTs, which then append without checking
+	void (*emit_output_reserve)(struct bfc_asm_t *asm_prog, size_t count);
+
+	void (*emit_op_set)(struct bfc_asm_t *asm_prog, ssize_t off, ssize_t imm);
+	void (*emit_op_mul)(struct bfc_asm_t *asm_prog, ssize_t off, ssize_t dst, ssize_t factor);
+	void (*emit_op_scan)(struct bfc_asm_t *asm_prog, ssize_t stride);
+	void (*emit_op_count)(struct bfc_asm_t *asm_prog, size_t counter);
 	void (*emit_loop_test_z)(struct bfc_asm_t *asm_prog, const char* label);
 	void (*emit_loop_test_nz)(struct bfc_asm_t *asm_prog, const char* label);
 } bfc_backend_t;
 
-typedef struct {
+typedef struct bfc_asm_t {
 	bfc_arch_t arch;
 	bfc_os_t os;
+	bfc_asm_format_t format;
 	bfc_backend_t backend;
 	size_t label_id;
+	uint8_t alloc_failed;
+
+	const bfc_snapshot_t *snapshot;
+	bfc_runtime_opts_t opts;
+	bfc_runtime_layout_t layout;
+	size_t data_label;
+	size_t runtime_label;
+
+	// inside a loop the profile never saw run: prefer small code over fast code
+	uint8_t cold;
+
+	// source locations of tape accesses, ordered by `pc`, for reporting tape overflows
+	bfc_program_t *program;
+	bfc_asm_loc_t *locs;
+	size_t loc_length;
+	size_t loc_capacity;
+	uint32_t loc_src;
 
 	char *buffer;
 	size_t length;
 	size_t capacity;
+
+	size_t *labels;
+	size_t label_capacity;
+
+	bfc_asm_fixup_t *fixups;
+	size_t fixup_length;
+	size_t fixup_capacity;
 } bfc_asm_t;
 
-bfc_error_t bfc_codegen(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block);
+size_t bfc_runtime_tape_bytes(const bfc_runtime_opts_t opts);
+bfc_runtime_layout_t bfc_runtime_layout(const bfc_runtime_opts_t opts, const bfc_ir_block_t *const ir_block);
+
+bfc_error_t bfc_codegen(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_arch_t target, const bfc_runtime_opts_t opts);
+bfc_error_t bfc_codegen_binary(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_arch_t target, const bfc_runtime_opts_t opts);
+bfc_error_t bfc_codegen_jit(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_runtime_opts_t opts);
 bfc_error_t bfc_codegen_x86_64(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block);
 bfc_error_t bfc_codegen_i386(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block);
 bfc_error_t bfc_codegen_aarch64(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block);
 bfc_error_t bfc_codegen_arm32(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block);
 
 void bfc_codegen_emit_asm(bfc_asm_t **asm_prog, const char *asm_str);
+void bfc_codegen_emit_bytes(bfc_asm_t **asm_prog, const void *bytes, const size_t n);
 void bfc_codegen_emit_label(bfc_asm_t **asm_prog, const char *label_str);
+
+// `.byte` directives, 16 values per line
+void bfc_codegen_emit_byte_rows(bfc_asm_t **asm_prog, const uint8_t *data, const size_t length);
 void bfc_codegen_emit_block(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block);
 
+// records that the code emitted next accesses the tape on behalf of source offset `src`
+void bfc_codegen_mark_loc(bfc_asm_t **asm_prog, const uint32_t src);
+
+void bfc_codegen_bind_label(bfc_asm_t **asm_prog, const char *label_str);
+void bfc_codegen_emit_rel32(bfc_asm_t **asm_prog, const char *label_str);
+bfc_error_t bfc_codegen_resolve_fixups(bfc_asm_t **asm_prog);
+
 void bfc_asm_destroy(bfc_asm_t **pasm_prog);
 
 #endif // __BFC_CODEGEN_H
@@ -0,0 +1,56 @@
+#ifndef __BFC_DRIVER_H
+#define __BFC_DRIVER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "bfc_arena.h"
+#include "bfc_cli.h"
+#include "bfc_codegen.h"
+#include "bfc_error.h"
+#include "bfc_eval.h"
+#include "bfc_io.h"
+#include "bfc_ir.h"
+#include "bfc_lexer.h"
+#include "bfc_pass.h"
+#include "bfc_profile.h"
+#include "bfc_report.h"
+
+/*
+ * One compilation of one input, shared by bfc and the benchmark harness so
+ * both run the same pipeline. Every step is a phase of `report`, which the
+ * caller sets up before the first step and prints, or reads, afterwards.
+ */
+typedef struct {
+	bfc_arena_t *arena;
+	bfc_program_t *program;
+	bfc_token_stream_t *tok_stream;
+	ssize_t *jump_table;
+	bfc_ir_block_t *root_block;
+	bfc_snapshot_t *snapshot;
+
+	// the command line's runtime options, with the profile counters of -fprofile-generate
+	bfc_runtime_opts_t runtime;
+
+	bfc_report_t report;
+	bfc_pass_ctx_t pass_ctx;
+
+	bfc_profile_t *profile;
+	bfc_profile_t *profile_in;
+	char profile_path[4096];
+	char profile_in_path[4096];
+} bfc_driver_t;
+
+// reads the input and takes it through the front end, the passes and the profile steps
+bfc_error_t bfc_driver_frontend(bfc_driver_t *const driver, const bfc_args_t *const cmd_args, FILE *diag);
+
+// machine code and the ELF image around it, for the IR bfc_driver_frontend left
+bfc_error_t bfc_driver_executable(bfc_driver_t *const driver, const bfc_args_t *const cmd_args, bfc_asm_t **asm_prog, char **image, size_t *length);
+
+// IR instructions left in the compilation, only counted when the report will show them
+size_t bfc_driver_report_ir(const bfc_driver_t *const driver);
+
+void bfc_driver_destroy(bfc_driver_t *const driver);
+
+#endif // __BFC_DRIVER_H
@@ -0,0 +1,12 @@
+#ifndef __BFC_ELF_H
+#define __BFC_ELF_H
+
+#include <stddef.h>
+
+#include "bfc_codegen.h"
+#include "bfc_error.h"
+
+// wraps freestanding machine code from bfc_codegen_binary into a static, libc-free x86_64 Linux executable
+bfc_error_t bfc_elf_create(char **image, size_t *length, const bfc_asm_t *const asm_prog);
+
+#endif // __BFC_ELF_H
@@ -1,6 +1,8 @@
 #ifndef __BFC_ERROR_H
 #define __BFC_ERROR_H
 
+#include <stdio.h>
+
 #include "bfc_token.h"
 
 #define COL_OFF     "\033[m"
@@ -17,6 +19,7 @@ typedef enum {
 	ERR_MISSING_BRACKET,
 	ERR_ALLOC,
 	ERR_INTERNAL,
+	ERR_RUNTIME,
 } bfc_err_code_t;
 
 typedef struct {
@@ -41,7 +44,7 @@ typedef struct {
 bfc_error_t bfc_make_error(const bfc_err_code_t error_code, const char *msg);
 bfc_error_t bfc_make_error_with_token(const bfc_err_code_t error_code, const char *msg, const bfc_token_t token);
 const char *bfc_get_error_code(const bfc_err_code_t error_code);
-void bfc_log_error(const bfc_error_t err, const struct bfc_program_t *const program);
+void bfc_log_error(const bfc_error_t err, const struct bfc_program_t *const program, FILE *out);
 
 
 #endif // __BFC_ERROR_H
@@ -0,0 +1,34 @@
+#ifndef __BFC_EVAL_H
+#define __BFC_EVAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "bfc_arena.h"
+#include "bfc_error.h"
+#include "bfc_ir.h"
+
+// IR instructions (and loop iterations) run at compile time before giving up
+#define BFC_EVAL_STEP_BUDGET (1 << 24)
+
+/*
+ * Where the program stands after its input-independent prefix ran at
+ * compile time: everything it printed so far, the tape and the pointer.
+ * The tape holds cells as the target lays them out, little-endian and
+ * `cell_width` bytes each; only bytes in [tape_begin, tape_end) can be
+ * non-zero. `ptr` counts cells.
+ */
+typedef struct {
+	uint8_t *output;
+	size_t output_length;
+
+	uint8_t *tape;
+	size_t tape_begin;
+	size_t tape_end;
+	ssize_t ptr;
+} bfc_snapshot_t;
+
+bfc_error_t bfc_eval_prefix(bfc_snapshot_t **snapshot, bfc_ir_block_t **ir_block, const size_t step_budget, const size_t tape_bytes, const uint8_t cell_width, bfc_arena_t *const arena);
+
+#endif // __BFC_EVAL_H
@@ -0,0 +1,14 @@
+#ifndef __BFC_INTERP_H
+#define __BFC_INTERP_H
+
+#include <stdio.h>
+
+#include "bfc_codegen.h"
+#include "bfc_error.h"
+#include "bfc_eval.h"
+#include "bfc_io.h"
+#include "bfc_ir.h"
+
+bfc_error_t bfc_interp_run(const bfc_ir_code_t *const ir_code, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_runtime_opts_t opts, FILE *in, FILE *out);
+
+#endif // __BFC_INTERP_H
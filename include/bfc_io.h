@@ -2,19 +2,26 @@
 #define __BFC_IO_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "bfc_error.h"
 
 typedef struct {
 	char *path;
-	char *buffer;
+	const char *buffer;        // not NUL-terminated; mapped straight from the file when possible
 	size_t file_size;
+	uint8_t is_mapped;
+	size_t *line_starts;       // built lazily by the first line lookup
 	size_t line_count;
 } bfc_program_t;
 
 bfc_error_t bfc_program_create(bfc_program_t **program, const char *file_path);
 void bfc_program_destroy(bfc_program_t **pprogram);
 const char *bfc_program_getname(const bfc_program_t *const program);
-char *bfc_program_getline(const bfc_program_t *const program, const size_t n);
+char *bfc_program_getline(bfc_program_t *const program, const size_t n);
+int bfc_program_locate(bfc_program_t *const program, const size_t offset, size_t *const line, size_t *const col);
+
+bfc_error_t bfc_write_file(const char *file_path, const char *buffer, const size_t length);
+bfc_error_t bfc_write_executable(const char *file_path, const char *buffer, const size_t length);
 
 #endif // __BFC_IO_H
@@ -1,10 +1,19 @@
 #ifndef __BFC_IR_H
 #define __BFC_IR_H
 
+#include <stdint.h>
+#include <stdio.h>
 #include <sys/types.h>
 
+#include "bfc_arena.h"
 #include "bfc_error.h"
 
+// all ones in the low `width` bytes; cell arithmetic wraps modulo this plus one
+#define BFC_CELL_MASK(width) ((uint32_t) (0xFFFFFFFFu >> (32 - 8 * (width))))
+
+// largest cell offset an instruction may address, so it stays a 32-bit byte displacement at any cell width
+#define BFC_IR_MAX_OFFSET (INT32_MAX / 4)
+
 typedef enum {
 	IR_ADD,
 	IR_MOVE,
@@ -12,16 +21,45 @@ typedef enum {
 	IR_GET,
 	IR_SET,
 	IR_LOOP,
+	IR_LOOP_END,
+	IR_MUL,
+	IR_SCAN,
+
+	// adds one to profile counter `imm`; only inserted by bfc_profile_instrument
+	IR_COUNT,
 } bfc_ir_token_type_t;
 
+// how -fprofile-use wants an IR_LOOP compiled; set by bfc_profile_apply
+typedef enum {
+	IR_HINT_COLD   = 1 << 0,   // never entered: keep it small
+	IR_HINT_ALIGN  = 1 << 1,   // hot: start the body on a fresh fetch block
+	IR_HINT_UNROLL = 1 << 2,   // hot, small and usually goes around several times
+} bfc_ir_hint_t;
+
 struct bfc_ir_block_t;
+struct bfc_ir_writes_t;
 
 typedef struct {
     bfc_ir_token_type_t op;
 
+    // cell addressed by ADD/SET/PUT/GET/MUL, relative to the tape pointer
+    int32_t off;
+
+    // source offset of the command the instruction came from, for run-time diagnostics
+    uint32_t src;
+
+    // IR_LOOP: bfc_ir_hint_t flags
+    uint8_t hints;
+
     union {
         ssize_t imm;
         struct bfc_ir_block_t *body;
+
+        // IR_MUL: tape[p + off + mul.off] += factor * tape[p + off]; cells are at most 32 bits wide
+        struct {
+            int32_t off;
+            int32_t factor;
+        } mul;
     } val;
 } bfc_ir_instr_t;
 
@@ -30,6 +68,9 @@ typedef struct {
 
 	size_t length;
 	size_t capacity;
+
+	// cells a loop body writes, summarized afresh by every run of the const pass; NULL before the first
+	struct bfc_ir_writes_t *writes;
 } bfc_ir_block_t;
 
 typedef struct {
@@ -39,10 +80,44 @@ typedef struct {
 	size_t capacity;
 } bfc_ir_stack_t;
 
+/*
+ * Flat form of the IR: one contiguous array of fixed-size instructions.
+ * An IR_LOOP is followed by its body and closed by an IR_LOOP_END; for
+ * both, `imm` holds the index of the matching partner. Cell ops address
+ * `off` relative to the tape pointer; IR_MUL adds `imm` times that cell to
+ * cell `dst`. IR_SCAN keeps its stride in `imm`, IR_COUNT its counter.
+ * `src` is the source offset of the command, an IR_LOOP_END's is its `[`.
+ */
+typedef struct {
+	uint8_t op;
+	int32_t off;
+	int32_t imm;
+	int32_t dst;
+	uint32_t src;
+} bfc_ir_flat_instr_t;
+
+typedef struct {
+	bfc_ir_flat_instr_t *instr;
+	size_t length;
+} bfc_ir_code_t;
+
 bfc_ir_instr_t bfc_ir_make_imm_instr(const bfc_ir_token_type_t ir_token_type, const ssize_t imm);
 bfc_ir_instr_t bfc_ir_make_zero_instr(const bfc_ir_token_type_t ir_token_type);
-bfc_error_t bfc_ir_create(bfc_ir_block_t **root_block, const bfc_token_stream_t *const tok_stream);
+bfc_ir_instr_t bfc_ir_make_mul_instr(const ssize_t off, const ssize_t factor);
+bfc_error_t bfc_ir_create(bfc_ir_block_t **root_block, const bfc_token_stream_t *const tok_stream, bfc_arena_t *const arena);
 bfc_error_t bfc_ir_optimize_rep(bfc_ir_block_t **ir_block);
-void bfc_ir_destroy(bfc_ir_block_t **proot_block);
+bfc_error_t bfc_ir_optimize_clear(bfc_ir_block_t **ir_block);
+bfc_error_t bfc_ir_optimize_mul(bfc_ir_block_t **ir_block, bfc_arena_t *const arena);
+bfc_error_t bfc_ir_optimize_scan(bfc_ir_block_t **ir_block);
+bfc_error_t bfc_ir_optimize_offsets(bfc_ir_block_t **ir_block, const uint8_t cell_width);
+bfc_error_t bfc_ir_optimize_const(bfc_ir_block_t **ir_block, const uint8_t cell_width, const size_t tape_size, bfc_arena_t *const arena);
+
+// instructions in the block and in every loop body nested inside it
+size_t bfc_ir_count(const bfc_ir_block_t *const ir_block);
+
+// one instruction per line, loop bodies indented
+void bfc_ir_dump(const bfc_ir_block_t *const ir_block, FILE *out);
+
+bfc_error_t bfc_ir_flatten(bfc_ir_code_t **code, const bfc_ir_block_t *const root_block, bfc_arena_t *const arena);
 
 #endif // __BFC_IR_H
@@ -0,0 +1,13 @@
+#ifndef __BFC_JIT_H
+#define __BFC_JIT_H
+
+#include "bfc_codegen.h"
+#include "bfc_error.h"
+#include "bfc_eval.h"
+#include "bfc_io.h"
+#include "bfc_ir.h"
+
+// runs the program in-process; a tape overflow reports its source location and exits the process
+bfc_error_t bfc_jit_run(const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_runtime_opts_t opts);
+
+#endif // __BFC_JIT_H
@@ -4,8 +4,10 @@
 #include <sys/types.h>
 
 #include "bfc_error.h"
+#include "bfc_ir.h"
 
 bfc_error_t bfc_parse_jump_table(ssize_t **jump_table, const bfc_token_stream_t *const tok_stream);
+bfc_error_t bfc_link_jump_table(bfc_ir_code_t *const code);
 void bfc_jump_table_destroy(ssize_t **pjump_table);
 
 #endif // __BFC_JUMPTABLE_H
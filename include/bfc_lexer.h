@@ -8,6 +8,20 @@
 #include "bfc_error.h"
 #include "bfc_io.h"
 
+// source bytes classified per call of a bfc_lex_classify_t
+#define BFC_LEX_BLOCK 64
+
+/*
+ * Returns a mask with bit i set if block[i] is a command or ';'; the front
+ * ends only look at those bytes and skip a comment with one memchr for
+ * its '\n'. Block kernels read exactly BFC_LEX_BLOCK bytes, the tail of a
+ * buffer goes through the scalar one.
+ */
+typedef uint64_t (*bfc_lex_classify_t)(const char *block);
+
+bfc_lex_classify_t bfc_lex_select_classifier(void);
+uint64_t bfc_lex_classify_tail(const char *block, const size_t length);
+
 bfc_error_t bfc_lex(bfc_token_stream_t **token_stream, const bfc_program_t *const program, const bfc_args_t cmd_args);
 void bfc_token_stream_destroy(bfc_token_stream_t **ptok_stream);
 
@@ -0,0 +1,12 @@
+#ifndef __BFC_PARSER_H
+#define __BFC_PARSER_H
+
+#include "bfc_arena.h"
+#include "bfc_cli.h"
+#include "bfc_error.h"
+#include "bfc_io.h"
+#include "bfc_ir.h"
+
+bfc_error_t bfc_parse(bfc_ir_block_t **root_block, const bfc_program_t *const program, const bfc_args_t cmd_args, bfc_arena_t *const arena);
+
+#endif // __BFC_PARSER_H
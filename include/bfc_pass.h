@@ -0,0 +1,79 @@
+#ifndef __BFC_PASS_H
+#define __BFC_PASS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bfc_arena.h"
+#include "bfc_codegen.h"
+#include "bfc_error.h"
+#include "bfc_eval.h"
+#include "bfc_ir.h"
+#include "bfc_report.h"
+
+// -O level used when none is given; runs every pass that used to be hardcoded
+#define BFC_PASS_DEFAULT_LEVEL 2
+#define BFC_PASS_MAX_LEVEL 3
+
+// upper bound on reruns of a pass that iterates to a fixpoint
+#define BFC_PASS_MAX_ITERATIONS 8
+
+#define BFC_PASS_MAX 16
+
+typedef struct {
+	size_t runs;
+
+	// instructions going into the first run and coming out of the last
+	size_t before;
+	size_t after;
+} bfc_pass_stat_t;
+
+// what passes get to work with besides the IR
+typedef struct {
+	bfc_arena_t *arena;
+	bfc_runtime_opts_t runtime;
+
+	// filled in by partial-eval
+	bfc_snapshot_t *snapshot;
+
+	bfc_report_t *report;
+	bfc_pass_stat_t stats[BFC_PASS_MAX];
+
+	// where -fdump-ir-after goes
+	FILE *diag;
+} bfc_pass_ctx_t;
+
+typedef struct {
+	// name used by -f<name>, -fno-<name> and -fdump-ir-after=<name>
+	const char *name;
+
+	// lowest -O level the pass runs at
+	uint8_t level;
+
+	// rerun while it keeps shrinking the IR
+	uint8_t fixpoint;
+
+	bfc_error_t (*run)(bfc_ir_block_t **ir_block, bfc_pass_ctx_t *const ctx);
+} bfc_pass_t;
+
+// pipeline selection from the command line; masks are indexed like bfc_pass_get
+typedef struct {
+	uint8_t level;
+	uint8_t stats;
+	uint32_t enabled;
+	uint32_t disabled;
+	uint32_t dump_after;
+} bfc_pass_opts_t;
+
+// the pipeline, in the order the passes run
+size_t bfc_pass_count(void);
+const bfc_pass_t *bfc_pass_get(const size_t index);
+
+// index of the pass called `name`, or -1 if there is none
+int bfc_pass_find(const char *name);
+
+bfc_error_t bfc_pass_run(bfc_ir_block_t **root_block, bfc_pass_ctx_t *const ctx, const bfc_pass_opts_t opts);
+void bfc_pass_print_stats(const bfc_pass_ctx_t *const ctx, FILE *out);
+
+#endif // __BFC_PASS_H
@@ -0,0 +1,75 @@
+#ifndef __BFC_PROFILE_H
+#define __BFC_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bfc_arena.h"
+#include "bfc_error.h"
+#include "bfc_io.h"
+#include "bfc_ir.h"
+
+#define BFC_PROFILE_MAGIC "BFCPROF2"
+#define BFC_PROFILE_EXT ".bfprof"
+
+// the busiest loops that together run this many per mille of all iterations are hot, if they run at least BFC_PROFILE_HOT_MIN
+#define BFC_PROFILE_HOT_PERMILLE 900
+#define BFC_PROFILE_HOT_MIN      4096
+
+// hot loops are unrolled when they average this many iterations per entry and their body is this small
+#define BFC_PROFILE_UNROLL_TRIPS  4
+#define BFC_PROFILE_UNROLL_INSTRS 16
+
+/*
+ * A counted loop. `hash` covers the loop's IR, nested loops included, but
+ * not where it came from in the source; line and column of its `[` are
+ * only there for reports.
+ */
+typedef struct {
+	uint32_t line;
+	uint32_t col;
+	uint32_t hash;
+} bfc_profile_site_t;
+
+/*
+ * Loop counters of a -fprofile-generate build. Loop k counts how often it
+ * was reached in counters[2k] and how often its body ran in
+ * counters[2k + 1]. On disk the header from bfc_profile_encode_header is
+ * followed by the counters as little-endian 64-bit integers, which is
+ * exactly what native programs write straight out of their memory.
+ */
+typedef struct {
+	bfc_profile_site_t *sites;
+	size_t length;
+
+	// NULL until the program has run
+	uint64_t *counters;
+
+	const char *path;
+} bfc_profile_t;
+
+/*
+ * Numbers the loops left in `root_block` and puts an IR_COUNT for the
+ * entry in front of each and one for the iteration at the start of its
+ * body. Loops the passes already turned into straight-line code or scans
+ * are not counted.
+ */
+bfc_error_t bfc_profile_instrument(bfc_profile_t **profile, bfc_ir_block_t **root_block, bfc_program_t *const program, const char *path, bfc_arena_t *const arena);
+
+size_t bfc_profile_counter_count(const bfc_profile_t *const profile);
+size_t bfc_profile_header_size(const bfc_profile_t *const profile);
+void bfc_profile_encode_header(const bfc_profile_t *const profile, uint8_t *header);
+
+/*
+ * Sets the IR_LOOP hints in `root_block` from a profile read back with
+ * bfc_profile_read. A loop matches the site with the same hash, the k-th
+ * loop of its kind the k-th such site, so moving code around or editing
+ * other loops keeps the counts of the rest. Loops the profile does not
+ * know keep the code they would get without it.
+ */
+bfc_error_t bfc_profile_apply(const bfc_profile_t *const profile, bfc_ir_block_t *const root_block);
+
+bfc_error_t bfc_profile_write(const bfc_profile_t *const profile, const uint64_t *counters);
+bfc_error_t bfc_profile_read(bfc_profile_t **profile, const char *path, bfc_arena_t *const arena);
+
+#endif // __BFC_PROFILE_H
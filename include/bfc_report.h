@@ -0,0 +1,57 @@
+#ifndef __BFC_REPORT_H
+#define __BFC_REPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bfc_arena.h"
+
+#define BFC_REPORT_MAX_PHASES 32
+
+typedef struct {
+	const char *name;
+	size_t runs;
+
+	double wall;   // seconds
+	double cpu;    // seconds of CPU time of the thread running the phase
+
+	size_t arena_bytes;   // handed out by the arena while the phase ran
+	size_t heap_bytes;    // malloc'd and still live when the phase ended
+	size_t peak_rss;      // process high-water mark in bytes once the phase ended
+
+	// elements the phase consumed and produced, e.g. tokens or IR instructions
+	size_t in;
+	size_t out;
+	const char *in_unit;
+	const char *out_unit;
+} bfc_report_phase_t;
+
+/*
+ * Per-phase timing and memory counters for -ftime-report and -fmem-report.
+ * A phase is bracketed by bfc_report_begin and bfc_report_end; beginning a
+ * phase name again adds to its totals. With neither report enabled both
+ * calls return right away, so callers can leave them in unconditionally.
+ */
+typedef struct {
+	uint8_t time;
+	uint8_t mem;
+
+	// allocations through this arena are attributed to the running phase
+	const bfc_arena_t *arena;
+
+	bfc_report_phase_t phases[BFC_REPORT_MAX_PHASES];
+	size_t length;
+
+	bfc_report_phase_t *current;
+	double wall_start;
+	double cpu_start;
+	size_t arena_start;
+} bfc_report_t;
+
+uint8_t bfc_report_enabled(const bfc_report_t *const report);
+void bfc_report_begin(bfc_report_t *const report, const char *name, const size_t in, const char *in_unit);
+void bfc_report_end(bfc_report_t *const report, const size_t out, const char *out_unit);
+void bfc_report_print(const bfc_report_t *const report, FILE *out);
+
+#endif // __BFC_REPORT_H
@@ -15,17 +15,26 @@ typedef enum {
 	TT_INPUT
 } bfc_token_type_t;
 
+// a single token, as carried by diagnostics; line and column are decoded from the offset on demand
 typedef struct {
 	bfc_token_type_t type;
-size_t line;
-	size_t col;
+	uint32_t offset;
 } bfc_token_t;
 
+/*
+ * Tokens are stored column-wise. Repeated commands collapse into one entry
+ * whose count says how often it occurs; brackets always stand alone, so
+ * their indices pair up one-to-one. offsets[i] is the byte offset of the
+ * first character of entry i in the source.
+ */
 typedef struct {
-	bfc_token_t *tokens;
+	uint8_t *types;
+	uint32_t *counts;
+	uint32_t *offsets;
 	size_t length;
+	size_t capacity;
 } bfc_token_stream_t;
 
-bfc_token_t bfc_make_token(const bfc_token_type_t tok_type, const uint32_t line, const uint32_t col);
+bfc_token_t bfc_make_token(const bfc_token_type_t tok_type, const uint32_t offset);
 
 #endif // __BFC_TOKEN_H
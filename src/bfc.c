@@ -1,68 +1,152 @@
+#include "bfc_batch.h"
 #include "bfc_cli.h"
 #include "bfc_codegen.h"
+#include "bfc_driver.h"
 #include "bfc_error.h"
+#include "bfc_interp.h"
 #include "bfc_io.h"
 #include "bfc_ir.h"
-#include "bfc_jumptable.h"
-#include "bfc_lexer.h"
+#include "bfc_jit.h"
+#include "bfc_report.h"
 
 #include <stdlib.h>
 
 #define CHECK_ERROR(err)            \
 	if (err.code != ERR_OK) {            \
-		bfc_log_error(err, (struct bfc_program_t*) program); \
+		bfc_log_error(err, (struct bfc_program_t*) program, diag); \
 		goto end;                    \
 	}
 
-
-int main(int argc, char** argv) {
+// compiles, or runs, `cmd_args.input`; diagnostics and reports go to `diag`
+static int bfc_compile(bfc_args_t cmd_args, FILE *diag) {
 
 	int ret = EXIT_FAILURE;
 
-	bfc_args_t cmd_args = {0};
-
+	bfc_driver_t driver            = {0};
 	bfc_program_t *program         = NULL;
-	bfc_token_stream_t *tok_stream = NULL;
-	ssize_t *jump_table            = NULL;
-	bfc_ir_block_t *root_block     = NULL;
+	bfc_ir_code_t *ir_code         = NULL;
 	bfc_asm_t *asm_prog            = NULL;
+	char *image                    = NULL;
+	size_t image_length            = 0;
 
-	bfc_error_t err;
+	bfc_report_t *const report = &driver.report;
 
-	err = bfc_process_args(&cmd_args, argc, argv);
+	report->time = cmd_args.f_time_report;
+	report->mem = cmd_args.f_mem_report;
+
+	bfc_error_t err = bfc_driver_frontend(&driver, &cmd_args, diag);
+	program = driver.program;
 	CHECK_ERROR(err);
 
-	if (cmd_args.ask_help) {
-		bfc_cmd_help();
+	if (cmd_args.do_interpret) {
+		bfc_report_begin(report, "flatten", bfc_driver_report_ir(&driver), "instrs");
+		err = bfc_ir_flatten(&ir_code, driver.root_block, driver.arena);
+		bfc_report_end(report, ir_code ? ir_code->length : 0, "instrs");
+		CHECK_ERROR(err);
+
+		// the report comes out after the program's own output
+		bfc_report_begin(report, "interpret", ir_code->length, "instrs");
+		err = bfc_interp_run(ir_code, driver.snapshot, program, driver.runtime, stdin, stdout);
+		bfc_report_end(report, 0, NULL);
+		CHECK_ERROR(err);
+
+		ret = EXIT_SUCCESS;
 		goto end;
 	}
 
-	err = bfc_program_create(&program, cmd_args.input);
-	CHECK_ERROR(err);
-	
-	err = bfc_lex(&tok_stream, program, cmd_args);
-	CHECK_ERROR(err);
+	if (cmd_args.do_run) {
+		bfc_report_begin(report, "jit and run", bfc_driver_report_ir(&driver), "instrs");
+		err = bfc_jit_run(driver.root_block, driver.snapshot, program, driver.runtime);
+		bfc_report_end(report, 0, NULL);
+		CHECK_ERROR(err);
 
-	err = bfc_parse_jump_table(&jump_table, tok_stream);
-	CHECK_ERROR(err);
+		ret = EXIT_SUCCESS;
+		goto end;
+	}
 
-	err = bfc_ir_create(&root_block, tok_stream);
-	CHECK_ERROR(err);
+	if (!cmd_args.do_assemble) {
+		err = bfc_driver_executable(&driver, &cmd_args, &asm_prog, &image, &image_length);
+		CHECK_ERROR(err);
 
-	err = bfc_ir_optimize_rep(&root_block);
+		bfc_report_begin(report, "write", image_length, "bytes");
+		char exe_path[4096];
+		err = bfc_write_executable(bfc_get_executable_path(&cmd_args, exe_path, sizeof(exe_path)), image, image_length);
+		bfc_report_end(report, 0, NULL);
+		CHECK_ERROR(err);
+
+		ret = EXIT_SUCCESS;
+		goto end;
+	}
+
+	bfc_report_begin(report, "codegen", bfc_driver_report_ir(&driver), "instrs");
+	err = bfc_codegen(&asm_prog, driver.root_block, driver.snapshot, program, cmd_args.target, driver.runtime);
+	bfc_report_end(report, asm_prog ? asm_prog->length : 0, "bytes");
 	CHECK_ERROR(err);
 
-	err = bfc_codegen(&asm_prog, root_block);
+	char out_path[4096];
+	bfc_report_begin(report, "write", asm_prog->length, "bytes");
+	err = bfc_write_file(
+		bfc_get_output_path(&cmd_args, out_path, sizeof(out_path), ".s"), 
+		asm_prog->buffer, asm_prog->length
+	);
+	bfc_report_end(report, 0, NULL);
 	CHECK_ERROR(err);
 
 	ret = EXIT_SUCCESS;
 
 end:
-	if (program)    bfc_program_destroy(&program);
-	if (tok_stream) bfc_token_stream_destroy(&tok_stream);
-	if (jump_table) bfc_jump_table_destroy(&jump_table);
-	if (root_block) bfc_ir_destroy(&root_block);
-	if (asm_prog)   bfc_asm_destroy(&asm_prog);
+	bfc_report_print(report, diag);
+
+	bfc_driver_destroy(&driver);
+	if (asm_prog) bfc_asm_destroy(&asm_prog);
+	free(image);
+
+	return ret;
+}
+
+// a job of a batch: input `index` with the options shared by the whole batch
+static int bfc_compile_job(void *ctx, const size_t index, FILE *diag) {
+
+	bfc_args_t cmd_args = *(const bfc_args_t*) ctx;
+	cmd_args.input = cmd_args.inputs[index];
+
+	return bfc_compile(cmd_args, diag);
+}
+
+int main(int argc, char** argv) {
+
+	int ret = EXIT_FAILURE;
+
+	bfc_args_t cmd_args = {0};
+
+	bfc_error_t err = bfc_process_args(&cmd_args, argc, argv);
+	if (err.code != ERR_OK) {
+		bfc_log_error(err, NULL, stderr);
+		goto end;
+	}
+
+	if (cmd_args.ask_help) {
+		bfc_cmd_help();
+		goto end;
+	}
+
+	if (cmd_args.input_count == 1) {
+		ret = bfc_compile(cmd_args, stderr);
+		goto end;
+	}
+
+	size_t failed = 0;
+
+	err = bfc_batch_run(cmd_args.input_count, cmd_args.jobs, bfc_compile_job, &cmd_args, stderr, &failed);
+	if (err.code != ERR_OK) {
+		bfc_log_error(err, NULL, stderr);
+		goto end;
+	}
+
+	ret = failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+end:
+	bfc_args_destroy(&cmd_args);
 
 	return ret;
 }
@@ -0,0 +1,119 @@
+#include "bfc_arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BFC_ARENA_ALIGN(n) (((n) + 15) & ~(size_t) 15)
+
+static bfc_arena_chunk_t *bfc_arena_add_chunk(bfc_arena_t *const arena, const size_t min_size) {
+
+	size_t size = min_size > BFC_ARENA_CHUNK_SIZE ? min_size : BFC_ARENA_CHUNK_SIZE;
+
+	bfc_arena_chunk_t *chunk = (bfc_arena_chunk_t*) malloc(sizeof(bfc_arena_chunk_t) + size);
+	if (!chunk) return NULL;
+
+	chunk->size = size;
+	chunk->used = 0;
+	chunk->next = arena->head;
+
+	arena->head = chunk;
+	arena->bytes_reserved += size;
+	++arena->chunk_count;
+
+	return chunk;
+}
+
+bfc_error_t bfc_arena_create(bfc_arena_t **arena) {
+
+	*arena = (bfc_arena_t*) calloc(1, sizeof(bfc_arena_t));
+	if (!*arena) return BFC_ERR_ALLOC;
+
+	return BFC_ERR_OK;
+}
+
+void *bfc_arena_alloc(bfc_arena_t *const arena, const size_t size) {
+
+	if (size > SIZE_MAX - 15) return NULL;
+
+	size_t aligned = BFC_ARENA_ALIGN(size);
+	bfc_arena_chunk_t *chunk = arena->head;
+
+	if (!chunk || chunk->size - chunk->used < aligned) {
+		chunk = bfc_arena_add_chunk(arena, aligned);
+		if (!chunk) return NULL;
+	}
+
+	void *ptr = chunk->data + chunk->used;
+	chunk->used += aligned;
+
+	arena->last = ptr;
+	++arena->alloc_count;
+	arena->bytes_allocated += aligned;
+
+	return ptr;
+}
+
+void *bfc_arena_grow(bfc_arena_t *const arena, void *ptr, const size_t old_size, const size_t new_size) {
+
+	if (!ptr) return bfc_arena_alloc(arena, new_size);
+	if (new_size <= old_size) return ptr;
+
+	bfc_arena_chunk_t *chunk = arena->head;
+
+	// the most recent allocation can simply be extended in place
+	if (ptr == arena->last && new_size <= SIZE_MAX - 15) {
+		size_t offset = (size_t) ((unsigned char*) ptr - chunk->data);
+		size_t aligned = BFC_ARENA_ALIGN(new_size);
+
+		if (chunk->size - offset >= aligned) {
+			arena->bytes_allocated += aligned - (chunk->used - offset);
+			chunk->used = offset + aligned;
+
+			return ptr;
+		}
+	}
+
+	// an allocation that owns a whole chunk can move with it, like realloc
+	if (ptr == arena->last && ptr == (void*) chunk->data && new_size <= SIZE_MAX - 15 - sizeof(bfc_arena_chunk_t)) {
+		size_t aligned = BFC_ARENA_ALIGN(new_size);
+		if (aligned < BFC_ARENA_CHUNK_SIZE) aligned = BFC_ARENA_CHUNK_SIZE;
+
+		bfc_arena_chunk_t *tmp = (bfc_arena_chunk_t*) realloc(chunk, sizeof(bfc_arena_chunk_t) + aligned);
+		if (!tmp) return NULL;
+
+		arena->bytes_reserved += aligned - tmp->size;
+		arena->bytes_allocated += BFC_ARENA_ALIGN(new_size) - tmp->used;
+
+		tmp->size = aligned;
+		tmp->used = BFC_ARENA_ALIGN(new_size);
+
+		arena->head = tmp;
+		arena->last = tmp->data;
+
+		return tmp->data;
+	}
+
+	void *new_ptr = bfc_arena_alloc(arena, new_size);
+	if (!new_ptr) return NULL;
+
+	memcpy(new_ptr, ptr, old_size);
+
+	return new_ptr;
+}
+
+void bfc_arena_destroy(bfc_arena_t **parena) {
+
+	if (!parena || !*parena) return;
+
+	bfc_arena_chunk_t *chunk = (*parena)->head;
+	while (chunk) {
+		bfc_arena_chunk_t *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+
+	free(*parena);
+
+	*parena = NULL;
+}
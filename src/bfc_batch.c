@@ -0,0 +1,122 @@
+#include "bfc_batch.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct {
+	char *diag;
+	size_t diag_length;
+	int status;
+	uint8_t done;
+} bfc_batch_result_t;
+
+typedef struct {
+	bfc_batch_job_t job;
+	void *ctx;
+	FILE *out;
+
+	// guards everything below
+	pthread_mutex_t lock;
+
+	size_t count;
+	size_t next;       // first job nobody has taken yet
+	size_t flushed;    // jobs whose diagnostics have been written
+	size_t failed;
+	bfc_batch_result_t *results;
+} bfc_batch_t;
+
+static void bfc_batch_finish(bfc_batch_t *batch, const size_t index, char *diag, const size_t diag_length, const int status) {
+
+	pthread_mutex_lock(&batch->lock);
+
+	batch->results[index] = (bfc_batch_result_t) { .diag = diag, .diag_length = diag_length, .status = status, .done = 1 };
+	if (status != EXIT_SUCCESS) ++batch->failed;
+
+	while (batch->flushed < batch->count && batch->results[batch->flushed].done) {
+		bfc_batch_result_t *result = &batch->results[batch->flushed++];
+
+		if (result->diag) {
+			fwrite(result->diag, sizeof(char), result->diag_length, batch->out);
+		} else if (result->status != EXIT_SUCCESS) {
+			// the diagnostics could not be buffered, so this is all there is to say
+			bfc_log_error(BFC_ERR_ALLOC, NULL, batch->out);
+		}
+
+		free(result->diag);
+		result->diag = NULL;
+	}
+
+	fflush(batch->out);
+
+	pthread_mutex_unlock(&batch->lock);
+}
+
+static void *bfc_batch_worker(void *arg) {
+
+	bfc_batch_t *batch = (bfc_batch_t*) arg;
+
+	for (;;) {
+		pthread_mutex_lock(&batch->lock);
+		const size_t index = batch->next < batch->count ? batch->next++ : batch->count;
+		pthread_mutex_unlock(&batch->lock);
+
+		if (index == batch->count) break;
+
+		char *diag = NULL;
+		size_t diag_length = 0;
+		int status = EXIT_FAILURE;
+
+		FILE *stream = open_memstream(&diag, &diag_length);
+		if (stream) {
+			status = batch->job(batch->ctx, index, stream);
+
+			// the buffer and its length are only final once the stream is closed
+			if (fclose(stream) != 0) status = EXIT_FAILURE;
+		}
+
+		bfc_batch_finish(batch, index, diag, diag_length, status);
+	}
+
+	return NULL;
+}
+
+bfc_error_t bfc_batch_run(const size_t count, const size_t threads, bfc_batch_job_t job, void *ctx, FILE *out, size_t *failed) {
+
+	bfc_error_t err = BFC_ERR_ALLOC;
+
+	*failed = 0;
+
+	bfc_batch_t batch = { .job = job, .ctx = ctx, .out = out, .count = count };
+	pthread_t *workers = NULL;
+	size_t worker_count = 0;
+
+	if (pthread_mutex_init(&batch.lock, NULL) != 0) return bfc_make_error(ERR_INTERNAL, "Unable to create a mutex!");
+
+	batch.results = (bfc_batch_result_t*) calloc(count ? count : 1, sizeof(bfc_batch_result_t));
+	if (!batch.results) goto end;
+
+	// the calling thread is one of the workers
+	const size_t limit = threads > 1 ? threads : 1;
+	const size_t extra = count > limit ? limit - 1 : (count ? count - 1 : 0);
+
+	workers = (pthread_t*) malloc((extra ? extra : 1) * sizeof(pthread_t));
+	if (!workers) goto end;
+
+	// fewer threads than asked for only make the batch slower
+	while (worker_count < extra && pthread_create(&workers[worker_count], NULL, bfc_batch_worker, &batch) == 0) ++worker_count;
+
+	bfc_batch_worker(&batch);
+
+	for (size_t i = 0; i < worker_count; ++i) pthread_join(workers[i], NULL);
+
+	*failed = batch.failed;
+	err = BFC_ERR_OK;
+
+end:
+	free(workers);
+	free(batch.results);
+	pthread_mutex_destroy(&batch.lock);
+
+	return err;
+}
@@ -1,59 +1,449 @@
 #include "bfc_cli.h"
 
+#include "bfc_batch.h"
+#include "bfc_io.h"
+
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 void bfc_cmd_help(void) {
 
 	printf("OVERVIEW: bfc Brainfuck compiler\n\n");
-	printf("USAGE: bfc [options] <file.bf>\n\n");
+	printf("USAGE: bfc [options] <file.bf | - | @filelist>...\n\n");
 	printf("OPTIONS:\n");
-	printf("  %-20s %s\n", "--fno-comments", "Do not treat lines starting with ';' as comments (for compatibility)");
+	printf("  %-20s %s\n", "-f<pass> / -fno-<pass>", "Run or skip a pass regardless of -O: scan, mul, clear, offsets, const, partial-eval");
+	printf("  %-20s %s\n", "-fcell-width=<bits>", "Width of a tape cell: 8 (default), 16 or 32");
+	printf("  %-20s %s\n", "-fdump-ir-after=<pass>", "Print the IR to stderr after <pass> runs ('all' for every pass)");
+	printf("  %-20s %s\n", "-feof=<mode>",  "Value a read stores at end of input: unchanged (default), zero, minus-one");
+	printf("  %-20s %s\n", "-fmem-report",   "Print memory use and element counts of each compiler phase to stderr");
+	printf("  %-20s %s\n", "-fno-comments", "Do not treat lines starting with ';' as comments (for compatibility)");
+	printf("  %-20s %s\n", "-fpartial-eval", "Run the program up to its first input at compile time");
+	printf("  %-20s %s\n", "-fpass-stats",   "Print how many IR instructions each pass removed to stderr");
+	printf("  %-20s %s\n", "-fprofile-generate[=<file>]", "Count how often each loop runs; the program writes the counts to <file> (default <input>" BFC_PROFILE_EXT ")");
+	printf("  %-20s %s\n", "-fprofile-use[=<file>]", "Align and unroll the hot loops and keep the ones that never ran small, using the counts in <file>");
+	printf("  %-20s %s\n", "-fstaged-frontend", "Lex, match brackets and build the IR in separate passes");
+	printf("  %-20s %s\n", "-ftape-size=<n>", "Number of tape cells (default: " BFC_STR(BFC_TAPE_SIZE) "); running off either end is reported, by native code only past the next 64 KiB");
+	printf("  %-20s %s\n", "-ftime-report",  "Print wall and CPU time of each compiler phase to stderr");
 	printf("  %-20s %s\n", "--help / -h",    "Display available options");
-	printf("  %-20s %s\n", "-o <file>",      "Write output to <file>");
+	printf("  %-20s %s\n", "--interpret",    "Run the program with the portable interpreter");
+	printf("  %-20s %s\n", "--run",          "JIT-compile the program and run it in-process");
+	printf("  %-20s %s\n", "--target=<arch>", "Generate code for <arch>: x86_64, aarch64 (default: host)");
+	printf("  %-20s %s\n", "-j <n>",         "Compile up to <n> of the input files at once (default 1, at most " BFC_STR(BFC_BATCH_MAX_JOBS) ")");
+	printf("  %-20s %s\n", "-O<level>",      "Optimization level: 0 (none) to 3 (adds -fpartial-eval), default " BFC_STR(BFC_PASS_DEFAULT_LEVEL));
+	printf("  %-20s %s\n", "-o <file>",      "Write output to <file> ('-' for stdout, default a.out or <input>.s)");
 	printf("  %-20s %s\n", "-S",             "Only run compilation steps");
+	printf("  %-20s %s\n", "@<file>",        "Compile the files listed in <file>, one path per line");
+}
+
+static bfc_error_t bfc_args_add_input(bfc_args_t *const cmd_args, const char *path, const size_t length) {
+
+	if (cmd_args->input_count == cmd_args->input_capacity) {
+		size_t capacity = cmd_args->input_capacity ? cmd_args->input_capacity * 2 : 16;
+
+		char **tmp = (char**) realloc(cmd_args->inputs, capacity * sizeof(char*));
+		if (!tmp) return BFC_ERR_ALLOC;
+
+		cmd_args->inputs = tmp;
+		cmd_args->input_capacity = capacity;
+	}
+
+	char *input = strndup(path, length);
+	if (!input) return BFC_ERR_ALLOC;
+
+	cmd_args->inputs[cmd_args->input_count++] = input;
+
+	return BFC_ERR_OK;
+}
+
+// one path per line; blank lines are skipped
+static bfc_error_t bfc_args_add_filelist(bfc_args_t *const cmd_args, const char *list_path) {
+
+	bfc_program_t *list = NULL;
+
+	bfc_error_t err = bfc_program_create(&list, list_path);
+	if (err.code != ERR_OK) return err;
+
+	size_t start = 0;
+	for (size_t i = 0; i <= list->file_size && err.code == ERR_OK; ++i) {
+		if (i < list->file_size && list->buffer[i] != '\n') continue;
+
+		size_t end = i;
+		if (end > start && list->buffer[end - 1] == '\r') --end;
+
+		if (end > start) err = bfc_args_add_input(cmd_args, list->buffer + start, end - start);
+
+		start = i + 1;
+	}
+
+	bfc_program_destroy(&list);
+
+	return err;
+}
+
+typedef struct {
+	char *path;
+	char *key;
+	const char *input;
+	uint8_t is_input;
+} bfc_args_path_t;
+
+/*
+ * Names the file `path` refers to, whatever way it is spelled: its device
+ * and inode if it exists, otherwise the resolved directory it would be
+ * created in followed by its name.
+ */
+static char *bfc_args_path_key(const char *path) {
+
+	char key[4096];
+	struct stat st;
+
+	if (strcmp(path, "-") == 0) return strdup(path);
+
+	if (stat(path, &st) == 0) {
+		snprintf(key, sizeof(key), "#%ju:%ju", (uintmax_t) st.st_dev, (uintmax_t) st.st_ino);
+
+		return strdup(key);
+	}
+
+	const char *base = strrchr(path, '/');
+	char *dir = base ? strndup(path, (base == path) ? 1 : (size_t) (base - path)) : strdup(".");
+	if (!dir) return NULL;
+
+	char *resolved = realpath(dir, NULL);
+	free(dir);
+
+	// the directory does not exist either, so nothing can be written there
+	if (!resolved) return strdup(path);
+
+	snprintf(key, sizeof(key), "%s/%s", resolved, base ? base + 1 : path);
+	free(resolved);
+
+	return strdup(key);
+}
+
+static int bfc_args_path_compare(const void *a, const void *b) {
+
+	return strcmp(((const bfc_args_path_t*) a)->key, ((const bfc_args_path_t*) b)->key);
+}
+
+// the jobs of a batch run at the same time, so none may write a file another one reads or writes
+static bfc_error_t bfc_args_check_outputs(const bfc_args_t *const cmd_args) {
+
+	bfc_error_t err = BFC_ERR_ALLOC;
+
+	const size_t per_input = cmd_args->profile_generate ? 3 : 2;
+	size_t length = 0;
+
+	bfc_args_path_t *paths = (bfc_args_path_t*) malloc(cmd_args->input_count * per_input * sizeof(bfc_args_path_t));
+	if (!paths) return BFC_ERR_ALLOC;
+
+	for (size_t i = 0; i < cmd_args->input_count; ++i) {
+		bfc_args_t job = *cmd_args;
+		job.input = job.inputs[i];
+
+		char path_buf[4096];
+		const char *output = job.do_assemble 
+			? bfc_get_output_path(&job, path_buf, sizeof(path_buf), ".s") 
+			: bfc_get_executable_path(&job, path_buf, sizeof(path_buf));
+
+		paths[length] = (bfc_args_path_t) { .path = job.input, .key = bfc_args_path_key(job.input), .input = job.input, .is_input = 1 };
+		if (!paths[length++].key) goto end;
+
+		paths[length] = (bfc_args_path_t) { .path = strdup(output), .key = bfc_args_path_key(output), .input = job.input };
+		if (!paths[length++].path || !paths[length - 1].key) goto end;
+
+		if (job.profile_generate) {
+			const char *profile = bfc_get_profile_path(&job, job.profile_generate, path_buf, sizeof(path_buf));
+
+			paths[length] = (bfc_args_path_t) { .path = strdup(profile), .key = bfc_args_path_key(profile), .input = job.input };
+			if (!paths[length++].path || !paths[length - 1].key) goto end;
+		}
+	}
+
+	qsort(paths, length, sizeof(bfc_args_path_t), bfc_args_path_compare);
+
+	err = BFC_ERR_OK;
+
+	for (size_t i = 1; i < length && err.code == ERR_OK; ++i) {
+		const bfc_args_path_t *first = &paths[i - 1];
+		const bfc_args_path_t *second = &paths[i];
+
+		// the same input twice shows up as two jobs writing the same output
+		if (strcmp(first->key, second->key) != 0 || (first->is_input && second->is_input)) continue;
+
+		char err_str[512];
+		if (first->is_input || second->is_input) {
+			snprintf(
+				err_str, sizeof(err_str), "Compiling '%s' would overwrite the input file '%s'!", 
+				first->is_input ? second->input : first->input, first->is_input ? first->path : second->path
+			);
+		} else {
+			snprintf(
+				err_str, sizeof(err_str), "'%s' and '%s' would both be written to '%s'!", 
+				first->input, second->input, first->path
+			);
+		}
+
+		err = bfc_make_error(ERR_ARGS, err_str);
+	}
+
+end:
+	for (size_t i = 0; i < length; ++i) {
+		if (!paths[i].is_input) free(paths[i].path);
+		free(paths[i].key);
+	}
+
+	free(paths);
+
+	return err;
 }
 
 bfc_error_t bfc_process_args(bfc_args_t *const cmd_args, int argc, char **argv) {
 
 	cmd_args->flags = 0;
+	cmd_args->jobs = 1;
 	cmd_args->input = "";
+	cmd_args->inputs = NULL;
+	cmd_args->input_count = 0;
+	cmd_args->input_capacity = 0;
+	cmd_args->profile_generate = NULL;
+	cmd_args->profile_use = NULL;
+	cmd_args->runtime_opts = (bfc_runtime_opts_t) { .eof = EOF_UNCHANGED, .tape_size = BFC_TAPE_SIZE, .cell_width = 1 };
+	cmd_args->target = BFC_HOST_ARCH;
+	cmd_args->passes = (bfc_pass_opts_t) { .level = BFC_PASS_DEFAULT_LEVEL };
 	
 	int i = 1;
 	uint8_t output_num = 0;
 	while (i < argc) {
 
+		// -f options take one dash like clang's, or two as the first of them were spelled
+		const char *flag = (argv[i][0] == '-' && argv[i][1] == '-') ? argv[i] + 1 : argv[i];
+
 		if (strcmp(argv[i], "-o") == 0) {
 			if (i == argc - 1) 
 				return bfc_make_error(ERR_ARGS, "Argument to '-o' is missing (expected 1 value)");
 
 			cmd_args->outputs[output_num] = argv[i + 1];
 			++output_num;
+			++i;
 		} else if (strcmp(argv[i], "-S") == 0) {
 			cmd_args->do_assemble = 0x1;
 		} else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
 			cmd_args->ask_help = 0x1;
 			
 			return BFC_ERR_OK;
-		} else if (strcmp(argv[i], "--fno-comments") == 0) {
+		} else if (strcmp(argv[i], "--interpret") == 0) {
+			cmd_args->do_interpret = 1;
+		} else if (strcmp(argv[i], "--run") == 0) {
+			cmd_args->do_run = 1;
+		} else if (strcmp(flag, "-fno-comments") == 0) {
 			cmd_args->f_no_comments = 1;
-		} else if (argv[i][0] == '-') {
+		} else if (strcmp(flag, "-fstaged-frontend") == 0) {
+			cmd_args->f_staged_frontend = 1;
+		} else if (strcmp(flag, "-ftime-report") == 0) {
+			cmd_args->f_time_report = 1;
+		} else if (strcmp(flag, "-fmem-report") == 0) {
+			cmd_args->f_mem_report = 1;
+		} else if (strcmp(flag, "-fpass-stats") == 0) {
+			cmd_args->passes.stats = 1;
+		} else if (strcmp(flag, "-fprofile-generate") == 0) {
+			cmd_args->profile_generate = "";
+		} else if (strncmp(flag, "-fprofile-generate=", 19) == 0) {
+			cmd_args->profile_generate = flag + 19;
+		} else if (strcmp(flag, "-fprofile-use") == 0) {
+			cmd_args->profile_use = "";
+		} else if (strncmp(flag, "-fprofile-use=", 14) == 0) {
+			cmd_args->profile_use = flag + 14;
+		} else if (flag[0] == '-' && flag[1] == 'O' && flag[2] >= '0' && flag[2] <= '0' + BFC_PASS_MAX_LEVEL && flag[3] == '\0') {
+			cmd_args->passes.level = (uint8_t) (flag[2] - '0');
+		} else if (strncmp(flag, "-fdump-ir-after=", 16) == 0) {
+			const char *name = flag + 16;
+			const int pass = bfc_pass_find(name);
+
+			if (strcmp(name, "all") == 0) {
+				cmd_args->passes.dump_after = UINT32_MAX;
+			} else if (pass >= 0) {
+				cmd_args->passes.dump_after |= (uint32_t) 1 << pass;
+			} else {
+				char err_str[512];
+				snprintf(err_str, sizeof(err_str), "Unknown pass: '%s'", name);
+
+				return bfc_make_error(ERR_ARGS, err_str);
+			}
+		} else if (strncmp(flag, "-fno-", 5) == 0 && bfc_pass_find(flag + 5) >= 0) {
+			const int pass = bfc_pass_find(flag + 5);
+
+			cmd_args->passes.disabled |= (uint32_t) 1 << pass;
+			cmd_args->passes.enabled &= ~((uint32_t) 1 << pass);
+		} else if (strncmp(flag, "-f", 2) == 0 && bfc_pass_find(flag + 2) >= 0) {
+			const int pass = bfc_pass_find(flag + 2);
+
+			cmd_args->passes.enabled |= (uint32_t) 1 << pass;
+			cmd_args->passes.disabled &= ~((uint32_t) 1 << pass);
+		} else if (strncmp(flag, "-feof=", 6) == 0) {
+			const char *mode = flag + 6;
+
+			if (strcmp(mode, "unchanged") == 0) {
+				cmd_args->runtime_opts.eof = EOF_UNCHANGED;
+			} else if (strcmp(mode, "zero") == 0) {
+				cmd_args->runtime_opts.eof = EOF_ZERO;
+			} else if (strcmp(mode, "minus-one") == 0) {
+				cmd_args->runtime_opts.eof = EOF_MINUS_ONE;
+			} else {
+				char err_str[512];
+				snprintf(err_str, sizeof(err_str), "Unknown EOF mode: '%s' (expected unchanged, zero or minus-one)", mode);
+
+				return bfc_make_error(ERR_ARGS, err_str);
+			}
+		} else if (strncmp(flag, "-ftape-size=", 12) == 0) {
+			const char *size = flag + 12;
+
+			char *end = NULL;
+			unsigned long long cells = (*size >= '0' && *size <= '9') ? strtoull(size, &end, 10) : 0;
+
+			if (cells == 0 || *end != '\0' || cells > BFC_TAPE_MAX_BYTES) {
+				char err_str[512];
+				snprintf(err_str, sizeof(err_str), "Invalid tape size: '%s' (expected 1 to %zu cells)", size, BFC_TAPE_MAX_BYTES);
+
+				return bfc_make_error(ERR_ARGS, err_str);
+			}
+
+			cmd_args->runtime_opts.tape_size = (size_t) cells;
+		} else if (strncmp(flag, "-fcell-width=", 13) == 0) {
+			const char *bits = flag + 13;
+
+			if (strcmp(bits, "8") == 0) {
+				cmd_args->runtime_opts.cell_width = 1;
+			} else if (strcmp(bits, "16") == 0) {
+				cmd_args->runtime_opts.cell_width = 2;
+			} else if (strcmp(bits, "32") == 0) {
+				cmd_args->runtime_opts.cell_width = 4;
+			} else {
+				char err_str[512];
+				snprintf(err_str, sizeof(err_str), "Unknown cell width: '%s' (expected 8, 16 or 32)", bits);
+
+				return bfc_make_error(ERR_ARGS, err_str);
+			}
+		} else if (strncmp(argv[i], "--target=", 9) == 0) {
+			const char *arch = argv[i] + 9;
+
+			if (strcmp(arch, "x86_64") == 0) {
+				cmd_args->target = ARCH_X86_64;
+			} else if (strcmp(arch, "aarch64") == 0 || strcmp(arch, "arm64") == 0) {
+				cmd_args->target = ARCH_aarch64;
+			} else {
+				char err_str[512];
+				snprintf(err_str, sizeof(err_str), "Unknown target: '%s' (expected x86_64 or aarch64)", arch);
+
+				return bfc_make_error(ERR_ARGS, err_str);
+			}
+		} else if (strncmp(argv[i], "-j", 2) == 0) {
+			const char *jobs = argv[i][2] != '\0' ? argv[i] + 2 : (i < argc - 1 ? argv[++i] : NULL);
+			if (!jobs) return bfc_make_error(ERR_ARGS, "Argument to '-j' is missing (expected 1 value)");
+
+			char *end = NULL;
+			unsigned long long count = (*jobs >= '0' && *jobs <= '9') ? strtoull(jobs, &end, 10) : 0;
+
+			if (count == 0 || *end != '\0' || count > BFC_BATCH_MAX_JOBS) {
+				char err_str[512];
+				snprintf(err_str, sizeof(err_str), "Invalid job count: '%s' (expected 1 to %d)", jobs, BFC_BATCH_MAX_JOBS);
+
+				return bfc_make_error(ERR_ARGS, err_str);
+			}
+
+			cmd_args->jobs = (size_t) count;
+		} else if (argv[i][0] == '-' && argv[i][1] != '\0') {
 			char err_str[512];
 			snprintf(err_str, sizeof(err_str), "Unknown argument: '%s'", argv[i]);
 
 			return bfc_make_error(ERR_ARGS, err_str);
+		} else if (argv[i][0] == '@' && argv[i][1] != '\0') {
+			bfc_error_t err = bfc_args_add_filelist(cmd_args, argv[i] + 1);
+			if (err.code != ERR_OK) return err;
 		} else {
-			if (strcmp(cmd_args->input, "") != 0) 
-				return bfc_make_error(ERR_ARGS, "Too many input file paths given!");
-
-			cmd_args->input = argv[i];
+			bfc_error_t err = bfc_args_add_input(cmd_args, argv[i], strlen(argv[i]));
+			if (err.code != ERR_OK) return err;
 		}
 
 		++i;
 	}
 
-	if (strcmp(cmd_args->input, "") == 0) return bfc_make_error(ERR_ARGS, "No input files!");
+	if (cmd_args->input_count == 0) return bfc_make_error(ERR_ARGS, "No input files!");
+
+	if (cmd_args->input_count > 1) {
+		if (cmd_args->do_run || cmd_args->do_interpret) 
+			return bfc_make_error(ERR_ARGS, "--run and --interpret take a single input file!");
+
+		if (cmd_args->outputs[0]) 
+			return bfc_make_error(ERR_ARGS, "-o can't be used with several input files!");
+
+		if ((cmd_args->profile_generate && cmd_args->profile_generate[0]) || (cmd_args->profile_use && cmd_args->profile_use[0])) 
+			return bfc_make_error(ERR_ARGS, "A profile can't be named with several input files; each one uses <input>" BFC_PROFILE_EXT "!");
+	}
+
+	cmd_args->input = cmd_args->inputs[0];
+
+	if (cmd_args->runtime_opts.tape_size > BFC_TAPE_MAX_BYTES / cmd_args->runtime_opts.cell_width) 
+		return bfc_make_error(ERR_ARGS, "The tape may take up at most 1 GiB!");
+
+	if (cmd_args->input_count > 1) return bfc_args_check_outputs(cmd_args);
 
 	return BFC_ERR_OK; 
 }
 
+void bfc_args_destroy(bfc_args_t *const cmd_args) {
+
+	for (size_t i = 0; i < cmd_args->input_count; ++i) free(cmd_args->inputs[i]);
+	free(cmd_args->inputs);
+
+	cmd_args->input = "";
+	cmd_args->inputs = NULL;
+	cmd_args->input_count = 0;
+	cmd_args->input_capacity = 0;
+}
+
+
+static const char *bfc_input_stem_path(const bfc_args_t *const cmd_args, char *path_buf, const size_t size, const char *ext) {
+
+	// a program read from stdin has no name to derive one from
+	if (strcmp(cmd_args->input, "-") == 0) {
+		snprintf(path_buf, size, "a%s", ext);
+
+		return path_buf;
+	}
+
+	const char *base = strrchr(cmd_args->input, '/');
+	base = base ? base + 1 : cmd_args->input;
+
+	const char *dot = strrchr(base, '.');
+	size_t stem_len = (dot && dot != base) ? (size_t)(dot - base) : strlen(base);
+
+	snprintf(path_buf, size, "%.*s%s", (int) stem_len, base, ext);
+
+	return path_buf;
+}
+
+const char *bfc_get_output_path(const bfc_args_t *const cmd_args, char *path_buf, const size_t size, const char *ext) {
+
+	if (cmd_args->outputs[0]) return cmd_args->outputs[0];
+
+	return bfc_input_stem_path(cmd_args, path_buf, size, ext);
+}
+
+const char *bfc_get_executable_path(const bfc_args_t *const cmd_args, char *path_buf, const size_t size) {
+
+	if (cmd_args->outputs[0]) return cmd_args->outputs[0];
+	if (cmd_args->input_count <= 1) return "a.out";
+
+	return bfc_input_stem_path(cmd_args, path_buf, size, "");
+}
+
+const char *bfc_get_profile_path(const bfc_args_t *const cmd_args, const char *path, char *path_buf, const size_t size) {
+
+	if (path && path[0] != '\0') return path;
+
+	return bfc_input_stem_path(cmd_args, path_buf, size, BFC_PROFILE_EXT);
+}
@@ -1,62 +1,462 @@
 #include "bfc_codegen.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+static size_t bfc_codegen_round_up(const size_t n, const size_t granule) {
+
+	return (n + granule - 1) / granule * granule;
+}
+
+static size_t bfc_codegen_magnitude(const ssize_t n) {
+
+	return n < 0 ? -(size_t) n : (size_t) n;
+}
+
+// largest pointer step and largest cell offset anywhere in the program
+static void bfc_codegen_reach(const bfc_ir_block_t *const ir_block, size_t *move, size_t *off) {
+
+	for (size_t i = 0; i < ir_block->length; ++i) {
+		const bfc_ir_instr_t *instr = &ir_block->instr[i];
+		size_t m = 0;
+		size_t o = bfc_codegen_magnitude(instr->off);
+
+		switch (instr->op) {
+			case IR_MOVE:
+			case IR_SCAN: {
+				m = bfc_codegen_magnitude(instr->val.imm);
+				o = 0;
+			} break;
+
+			case IR_MUL: {
+				size_t dst = bfc_codegen_magnitude((ssize_t) instr->off + instr->val.mul.off);
+				if (dst > o) o = dst;
+			} break;
+
+			case IR_LOOP: {
+				bfc_codegen_reach((const bfc_ir_block_t*) instr->val.body, move, off);
+			} break;
+
+			default: break;
+		}
+
+		if (m > *move) *move = m;
+		if (o > *off) *off = o;
+	}
+}
+
+size_t bfc_runtime_tape_bytes(const bfc_runtime_opts_t opts) {
+
+	return bfc_codegen_round_up(opts.tape_size * opts.cell_width, BFC_TAPE_GRANULE);
+}
+
+bfc_runtime_layout_t bfc_runtime_layout(const bfc_runtime_opts_t opts, const bfc_ir_block_t *const ir_block) {
+
+	size_t move = 0;
+	size_t off = 0;
+	if (ir_block) bfc_codegen_reach(ir_block, &move, &off);
+
+	/*
+	 * Between two accesses the pointer moves at most once, so an access
+	 * lands at most 2 * off + move cells past the last one that was in
+	 * bounds. Programs that jump further than the largest guard can still
+	 * escape it. Capping them at half the largest tape keeps every offset
+	 * into the mapping a 32-bit displacement.
+	 */
+	const size_t max_cells = (BFC_TAPE_MAX_BYTES / 2) / opts.cell_width;
+	if (move > max_cells) move = max_cells;
+	if (off > max_cells) off = max_cells;
+
+	size_t reach = move + 2 * off + 1;
+	if (reach > max_cells) reach = max_cells;
+
+	bfc_runtime_layout_t layout;
+	layout.tape_bytes = bfc_runtime_tape_bytes(opts);
+	layout.guard_bytes = bfc_codegen_round_up(reach * opts.cell_width, BFC_TAPE_GRANULE);
+	layout.output_offset = layout.tape_bytes + layout.guard_bytes;
+	layout.input_offset = layout.output_offset + BFC_IO_BUFFER_SIZE;
+	layout.counter_offset = layout.input_offset + BFC_IO_BUFFER_SIZE;
+	layout.counter_bytes = opts.profile ? bfc_profile_counter_count(opts.profile) * sizeof(uint64_t) : 0;
+	layout.map_size = layout.guard_bytes + layout.counter_offset + bfc_codegen_round_up(layout.counter_bytes, BFC_TAPE_GRANULE);
+
+	return layout;
+}
+
+static bfc_error_t bfc_asm_create(bfc_asm_t **asm_prog, const bfc_asm_format_t format, const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_runtime_opts_t opts) {
 
-bfc_error_t bfc_codegen(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block) {
 	*asm_prog = (bfc_asm_t*) malloc(sizeof(bfc_asm_t));
 	if (!(*asm_prog)) return BFC_ERR_ALLOC;
 
+	(*asm_prog)->format = format;
+	(*asm_prog)->label_id = 0;
+	(*asm_prog)->alloc_failed = 0;
+	(*asm_prog)->snapshot = snapshot;
+	(*asm_prog)->opts = opts;
+	(*asm_prog)->layout = bfc_runtime_layout(opts, ir_block);
+	(*asm_prog)->data_label = 0;
+	(*asm_prog)->runtime_label = 0;
+	(*asm_prog)->cold = 0;
+	(*asm_prog)->program = program;
+	(*asm_prog)->locs = NULL;
+	(*asm_prog)->loc_length = 0;
+	(*asm_prog)->loc_capacity = 0;
+	(*asm_prog)->loc_src = 0;
 	(*asm_prog)->buffer = NULL;
 	(*asm_prog)->length = 0;
 	(*asm_prog)->capacity = 4096;
 
+	(*asm_prog)->labels = NULL;
+	(*asm_prog)->label_capacity = 0;
+	(*asm_prog)->fixups = NULL;
+	(*asm_prog)->fixup_length = 0;
+	(*asm_prog)->fixup_capacity = 0;
+
 	(*asm_prog)->buffer = (char*) malloc((*asm_prog)->capacity * sizeof(char));
 	if (!(*asm_prog)->buffer) return BFC_ERR_ALLOC;
 
 	(*asm_prog)->buffer[0] = '\0';
 
+	return BFC_ERR_OK;
+}
+
+bfc_error_t bfc_codegen(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_arch_t target, const bfc_runtime_opts_t opts) {
+
+	bfc_error_t err = bfc_asm_create(asm_prog, ASM_FMT_TEXT, ir_block, snapshot, program, opts);
+	if (err.code != ERR_OK) return err;
+
+	switch (target) {
+		case ARCH_X86_64:  return bfc_codegen_x86_64(asm_prog, ir_block);
+		case ARCH_i386:    return bfc_codegen_i386(asm_prog, ir_block);
+		case ARCH_aarch64: return bfc_codegen_aarch64(asm_prog, ir_block);
+		case ARCH_arm32:   return bfc_codegen_arm32(asm_prog, ir_block);
+	}
+
+	return bfc_make_error(ERR_INTERNAL, "Unknown architecture!");
+}
+
+bfc_error_t bfc_codegen_binary(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_arch_t target, const bfc_runtime_opts_t opts) {
+
+	if (target != ARCH_X86_64) return bfc_make_error(ERR_ARGS, "Machine code can only be generated for x86_64! Use -S to emit assembly.");
+
+	bfc_error_t err = bfc_asm_create(asm_prog, ASM_FMT_EXEC, ir_block, snapshot, program, opts);
+	if (err.code != ERR_OK) return err;
+
+	return bfc_codegen_x86_64(asm_prog, ir_block);
+}
+
+bfc_error_t bfc_codegen_jit(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_runtime_opts_t opts) {
+
 #if defined(__x86_64__) || defined(_M_X64)
+	bfc_error_t err = bfc_asm_create(asm_prog, ASM_FMT_JIT, ir_block, snapshot, program, opts);
+	if (err.code != ERR_OK) return err;
+
 	return bfc_codegen_x86_64(asm_prog, ir_block);
-#elif defined(__i386__) || defined(_M_IX86)
-	return bfc_codegen_i386(asm_prog, ir_block);
-#elif defined(__aarch64__) || defined(_M_ARM64)
-	return bfc_codegen_aarch64(asm_prog, ir_block);
-#elif defined(__arm__) || defined(_M_ARM)
-	return bfc_codegen_arm32(asm_prog, ir_block);
 #else
-	return bfc_make_error(ERR_INTERNAL, "Unknown architectur!");
+	return bfc_make_error(ERR_INTERNAL, "JIT is only supported on x86_64 hosts!");
 #endif
 
 }
 
-bfc_error_t bfc_codegen_x86_64(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block)  {
-	(*asm_prog)->arch = ARCH_X86_64;
-
-	return bfc_make_error(ERR_INTERNAL, "x86_64 generation not supported yet!");
-}
-
 bfc_error_t bfc_codegen_i386(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block) {
 	(*asm_prog)->arch = ARCH_i386;
 	return bfc_make_error(ERR_INTERNAL, "i386 generation not supported yet!");
 }
 
-bfc_error_t bfc_codegen_aarch64(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block) {
-	(*asm_prog)->arch = ARCH_aarch64;
-
-	return BFC_ERR_OK;
-}
-
 bfc_error_t bfc_codegen_arm32(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block) {
 	(*asm_prog)->arch = ARCH_arm32;
 
 	return bfc_make_error(ERR_INTERNAL, "arm32 generation not supported yet!");
 }
 
+void bfc_codegen_emit_asm(bfc_asm_t **asm_prog, const char *asm_str) {
+
+	bfc_codegen_emit_bytes(asm_prog, asm_str, strlen(asm_str));
+	if ((*asm_prog)->alloc_failed) return;
+
+	(*asm_prog)->buffer[(*asm_prog)->length] = '\0';
+}
+
+void bfc_codegen_emit_bytes(bfc_asm_t **asm_prog, const void *bytes, const size_t n) {
+
+	bfc_asm_t *prog = *asm_prog;
+	if (prog->alloc_failed) return;
+
+	size_t len = n;
+
+	if (prog->length + len + 1 > prog->capacity) {
+		size_t capacity = prog->capacity;
+		while (prog->length + len + 1 > capacity) capacity *= 2;
+
+		char *tmp = (char*) realloc(prog->buffer, capacity * sizeof(char));
+		if (!tmp) {
+			prog->alloc_failed = 1;
+
+			return;
+		}
+
+		prog->buffer = tmp;
+		prog->capacity = capacity;
+	}
+
+	memcpy(prog->buffer + prog->length, bytes, len);
+	prog->length += len;
+}
+
+void bfc_codegen_emit_byte_rows(bfc_asm_t **asm_prog, const uint8_t *data, const size_t length) {
+
+	for (size_t i = 0; i < length; i += 16) {
+		char line[128];
+		size_t pos = (size_t) snprintf(line, sizeof(line), "\t.byte %u", data[i]);
+
+		for (size_t j = i + 1; j < length && j < i + 16; ++j) 
+			pos += (size_t) snprintf(line + pos, sizeof(line) - pos, ",%u", data[j]);
+
+		snprintf(line + pos, sizeof(line) - pos, "\n");
+		bfc_codegen_emit_asm(asm_prog, line);
+	}
+}
+
+void bfc_codegen_emit_label(bfc_asm_t **asm_prog, const char *label_str) {
+
+	char line[128];
+	snprintf(line, sizeof(line), "%s:\n", label_str);
+
+	bfc_codegen_emit_asm(asm_prog, line);
+}
+
+void bfc_codegen_mark_loc(bfc_asm_t **asm_prog, const uint32_t src) {
+
+	bfc_asm_t *prog = *asm_prog;
+	if (prog->alloc_failed || !prog->program) return;
+
+	// a location covers everything up to the next one
+	if (prog->loc_length > 0 && prog->loc_src == src) return;
+
+	if (prog->loc_length >= prog->loc_capacity) {
+		size_t capacity = prog->loc_capacity ? prog->loc_capacity * 2 : 64;
+
+		bfc_asm_loc_t *tmp = (bfc_asm_loc_t*) realloc(prog->locs, capacity * sizeof(bfc_asm_loc_t));
+		if (!tmp) {
+			prog->alloc_failed = 1;
+
+			return;
+		}
+
+		prog->locs = tmp;
+		prog->loc_capacity = capacity;
+	}
+
+	size_t line = 0;
+	size_t col = 0;
+	bfc_program_locate(prog->program, src, &line, &col);
+
+	size_t pc = prog->length;
+	if (prog->format == ASM_FMT_TEXT) {
+		char label[64];
+
+		pc = prog->label_id++;
+		snprintf(label, sizeof(label), ".L%zu", pc);
+		prog->backend.emit_label(prog, label);
+	}
+
+	prog->locs[prog->loc_length++] = (bfc_asm_loc_t) { .pc = pc, .line = (uint32_t) line, .col = (uint32_t) col };
+	prog->loc_src = src;
+}
+
+// PUTs from `start` on that can share one buffer check: up to the next instruction that may flush
+static size_t bfc_codegen_count_puts(const bfc_ir_block_t *const ir_block, const size_t start) {
+
+	size_t count = 0;
+
+	for (size_t i = start; i < ir_block->length && count < BFC_IO_BUFFER_SIZE; ++i) {
+		bfc_ir_token_type_t op = ir_block->instr[i].op;
+
+		if (op == IR_LOOP || op == IR_SCAN || op == IR_GET) break;
+		if (op == IR_PUT) ++count;
+	}
+
+	return count;
+}
+
+void bfc_codegen_emit_block(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block) {
+
+	const bfc_backend_t *backend = &(*asm_prog)->backend;
+
+	size_t reserved = 0;
+
+	for (size_t i = 0; i < ir_block->length; ++i) {
+		const bfc_ir_instr_t *instr = &ir_block->instr[i];
+
+		if (instr->op == IR_LOOP || instr->op == IR_SCAN || instr->op == IR_GET) reserved = 0;
+
+		if (instr->op == IR_PUT && reserved == 0) {
+			reserved = bfc_codegen_count_puts(ir_block, i);
+			backend->emit_output_reserve(*asm_prog, reserved);
+		}
+
+		if (instr->op != IR_MOVE && instr->op != IR_COUNT) bfc_codegen_mark_loc(asm_prog, instr->src);
+
+		switch (instr->op) {
+			case IR_ADD: {
+				backend->emit_op_add(*asm_prog, instr->off, instr->val.imm);
+			} break;
+
+			case IR_MOVE: {
+				backend->emit_op_move(*asm_prog, instr->val.imm);
+			} break;
+
+			case IR_PUT: {
+				backend->emit_op_put(*asm_prog, instr->off);
+				--reserved;
+			} break;
+
+			case IR_GET: {
+				backend->emit_op_get(*asm_prog, instr->off);
+			} break;
+
+			case IR_SET: {
+				backend->emit_op_set(*asm_prog, instr->off, instr->val.imm);
+			} break;
+
+			case IR_MUL: {
+				backend->emit_op_mul(*asm_prog, instr->off, instr->off + instr->val.mul.off, instr->val.mul.factor);
+			} break;
+
+			case IR_SCAN: {
+				backend->emit_op_scan(*asm_prog, instr->val.imm);
+			} break;
+
+			case IR_COUNT: {
+				backend->emit_op_count(*asm_prog, (size_t) instr->val.imm);
+			} break;
+
+			case IR_LOOP: {
+				char start_label[64];
+				char end_label[64];
+				snprintf(start_label, sizeof(start_label), ".L%zu", (*asm_prog)->label_id++);
+				snprintf(end_label, sizeof(end_label), ".L%zu", (*asm_prog)->label_id++);
+
+				const bfc_ir_block_t *body = (const bfc_ir_block_t*) instr->val.body;
+				const uint8_t cold = (*asm_prog)->cold;
+
+				if (instr->hints & IR_HINT_COLD) (*asm_prog)->cold = 1;
+
+				backend->emit_loop_test_z(*asm_prog, end_label);
+				if (instr->hints & IR_HINT_ALIGN) backend->emit_align(*asm_prog);
+				backend->emit_label(*asm_prog, start_label);
+
+				bfc_codegen_emit_block(asm_prog, body);
+
+				// two iterations per back edge, leaving from the middle if the first one was the last
+				if (instr->hints & IR_HINT_UNROLL) {
+					bfc_codegen_mark_loc(asm_prog, instr->src);
+					backend->emit_loop_test_z(*asm_prog, end_label);
+					bfc_codegen_emit_block(asm_prog, body);
+				}
+
+				bfc_codegen_mark_loc(asm_prog, instr->src);
+				backend->emit_loop_test_nz(*asm_prog, start_label);
+				backend->emit_label(*asm_prog, end_label);
+
+				(*asm_prog)->cold = cold;
+			} break;
+
+			case IR_LOOP_END: {
+				// only exists in the flat IR
+			} break;
+		}
+	}
+}
+
+static size_t bfc_codegen_label_index(const char *label_str) {
+
+	// local labels are always of the form ".L<n>"
+	return (size_t) strtoull(label_str + 2, NULL, 10);
+}
+
+void bfc_codegen_bind_label(bfc_asm_t **asm_prog, const char *label_str) {
+
+	bfc_asm_t *prog = *asm_prog;
+	if (prog->alloc_failed) return;
+
+	size_t index = bfc_codegen_label_index(label_str);
+
+	if (index >= prog->label_capacity) {
+		size_t capacity = prog->label_capacity ? prog->label_capacity : 64;
+		while (index >= capacity) capacity *= 2;
+
+		size_t *tmp = (size_t*) realloc(prog->labels, capacity * sizeof(size_t));
+		if (!tmp) {
+			prog->alloc_failed = 1;
+
+			return;
+		}
+
+		prog->labels = tmp;
+		prog->label_capacity = capacity;
+	}
+
+	prog->labels[index] = prog->length;
+}
+
+void bfc_codegen_emit_rel32(bfc_asm_t **asm_prog, const char *label_str) {
+
+	bfc_asm_t *prog = *asm_prog;
+	if (prog->alloc_failed) return;
+
+	if (prog->fixup_length >= prog->fixup_capacity) {
+		size_t capacity = prog->fixup_capacity ? prog->fixup_capacity * 2 : 64;
+
+		bfc_asm_fixup_t *tmp = (bfc_asm_fixup_t*) realloc(prog->fixups, capacity * sizeof(bfc_asm_fixup_t));
+		if (!tmp) {
+			prog->alloc_failed = 1;
+
+			return;
+		}
+
+		prog->fixups = tmp;
+		prog->fixup_capacity = capacity;
+	}
+
+	prog->fixups[prog->fixup_length++] = (bfc_asm_fixup_t) {
+		.offset = prog->length,
+		.label = bfc_codegen_label_index(label_str),
+	};
+
+	static const uint8_t placeholder[4] = {0};
+	bfc_codegen_emit_bytes(asm_prog, placeholder, sizeof(placeholder));
+}
+
+bfc_error_t bfc_codegen_resolve_fixups(bfc_asm_t **asm_prog) {
+
+	bfc_asm_t *prog = *asm_prog;
+	if (prog->alloc_failed) return BFC_ERR_ALLOC;
+
+	for (size_t i = 0; i < prog->fixup_length; ++i) {
+		const bfc_asm_fixup_t fixup = prog->fixups[i];
+		if (fixup.label >= prog->label_capacity) 
+			return bfc_make_error(ERR_INTERNAL, "Jump to an unbound label!");
+
+		int64_t rel = (int64_t) prog->labels[fixup.label] - (int64_t) (fixup.offset + 4);
+		if (rel < INT32_MIN || rel > INT32_MAX) 
+			return bfc_make_error(ERR_INTERNAL, "Jump displacement out of range!");
+
+		int32_t rel32 = (int32_t) rel;
+		memcpy(prog->buffer + fixup.offset, &rel32, sizeof(rel32));
+	}
+
+	return BFC_ERR_OK;
+}
+
 void bfc_asm_destroy(bfc_asm_t **pasm_prog) {
 
 	if (!pasm_prog || !*pasm_prog) return;
 
 	free((*pasm_prog)->buffer);
+	free((*pasm_prog)->labels);
+	free((*pasm_prog)->fixups);
+	free((*pasm_prog)->locs);
 	free(*pasm_prog);
 
 	*pasm_prog = NULL;
@@ -0,0 +1,767 @@
+#include "bfc_codegen.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * AArch64 Linux backend, GAS text only.
+ *
+ * Register assignment for the whole program:
+ *   x19  current tape pointer
+ *   x20  tape base
+ *   x21  bytes pending in the output buffer
+ *   x22  read position in the input buffer
+ *   x23  end of the valid input
+ *   x24  output buffer
+ *   x25  input buffer
+ *   x28  profile counters, in instrumented programs
+ *
+ * All of them are callee-saved and survive `svc`, which only returns in x0.
+ * w9-w12 and x10 are scratch; x10 also materializes offsets that do not fit
+ * an immediate. Like on x86_64, the program maps the runtime layout itself,
+ * the I/O buffers sit behind the upper guard and routines emitted after the
+ * program flush the output, fetch input and report tape overflows.
+ */
+
+// runtime labels, relative to `asm_prog->runtime_label`
+enum {
+	BFC_AARCH64_FLUSH,
+	BFC_AARCH64_GETC,
+	BFC_AARCH64_SEGV,
+	BFC_AARCH64_UTOA,
+	BFC_AARCH64_FAIL,
+	BFC_AARCH64_BASE,
+	BFC_AARCH64_LOCS,
+	BFC_AARCH64_MESSAGE,
+	BFC_AARCH64_PROFILE,
+	BFC_AARCH64_PROFILE_PATH,
+	BFC_AARCH64_RUNTIME_LABELS,
+};
+
+#define BFC_AARCH64_MESSAGE_TEXT "tape overflow at "
+
+static void bfc_aarch64_ins(struct bfc_asm_t *asm_prog, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void bfc_aarch64_ins(struct bfc_asm_t *asm_prog, const char *fmt, ...) {
+
+	char line[256];
+
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+
+	bfc_codegen_emit_asm(&asm_prog, line);
+}
+
+static void bfc_aarch64_emit_label(struct bfc_asm_t *asm_prog, const char *label) {
+
+	bfc_codegen_emit_label(&asm_prog, label);
+}
+
+static void bfc_aarch64_emit_align(struct bfc_asm_t *asm_prog) {
+
+	bfc_codegen_emit_asm(&asm_prog, "\t.p2align 4\n");
+}
+
+// loads any 64-bit constant into `reg`, one 16-bit chunk at a time
+static void bfc_aarch64_mov_imm(struct bfc_asm_t *asm_prog, const char *reg, const ssize_t value) {
+
+	if (value >= -65536 && value < 65536) {
+		bfc_aarch64_ins(asm_prog, "\tmov %s, #%zd\n", reg, value);
+
+		return;
+	}
+
+	const uint64_t bits = (uint64_t) value;
+
+	bfc_aarch64_ins(asm_prog, "\tmovz %s, #%u\n", reg, (unsigned) (bits & 0xFFFF));
+
+	for (unsigned shift = 16; shift < 64; shift += 16) {
+		unsigned chunk = (unsigned) ((bits >> shift) & 0xFFFF);
+
+		if (chunk != 0) bfc_aarch64_ins(asm_prog, "\tmovk %s, #%u, lsl #%u\n", reg, chunk, shift);
+	}
+}
+
+// loads a 32-bit constant into the w register `reg`
+static void bfc_aarch64_mov_imm32(struct bfc_asm_t *asm_prog, const char *reg, const uint32_t value) {
+
+	if (value <= 0xFFFF || value >= 0xFFFF0000u) {
+		bfc_aarch64_ins(asm_prog, "\tmov %s, #%d\n", reg, (int32_t) value);
+
+		return;
+	}
+
+	bfc_aarch64_ins(asm_prog, "\tmovz %s, #%u\n", reg, value & 0xFFFF);
+	bfc_aarch64_ins(asm_prog, "\tmovk %s, #%u, lsl #16\n", reg, value >> 16);
+}
+
+/*
+ * Load or store (`op` is "ld" or "st") of `reg` at `bytes(x19)`, `size`
+ * bytes wide. Offsets 0..4095 times the size use the scaled immediate
+ * form, -256..-1 the unscaled ldur/stur; anything else goes through x10.
+ */
+static void bfc_aarch64_access(struct bfc_asm_t *asm_prog, const char *op, const uint8_t size, const char *reg, const ssize_t bytes) {
+
+	const char *suffix = size == 1 ? "b" : size == 2 ? "h" : "";
+
+	if (bytes == 0) {
+		bfc_aarch64_ins(asm_prog, "\t%sr%s %s, [x19]\n", op, suffix, reg);
+	} else if (bytes > 0 && bytes <= 4095 * size) {
+		bfc_aarch64_ins(asm_prog, "\t%sr%s %s, [x19, #%zd]\n", op, suffix, reg, bytes);
+	} else if (bytes >= -256 && bytes < 0) {
+		bfc_aarch64_ins(asm_prog, "\t%sur%s %s, [x19, #%zd]\n", op, suffix, reg, bytes);
+	} else {
+		bfc_aarch64_mov_imm(asm_prog, "x10", bytes);
+		bfc_aarch64_ins(asm_prog, "\t%sr%s %s, [x19, x10]\n", op, suffix, reg);
+	}
+}
+
+// the cell at cell offset `off`
+static void bfc_aarch64_cell_access(struct bfc_asm_t *asm_prog, const char *op, const char *reg, const ssize_t off) {
+
+	const uint8_t width = asm_prog->opts.cell_width;
+
+	bfc_aarch64_access(asm_prog, op, width, reg, off * width);
+}
+
+// `dst = src + imm` on 64-bit registers
+static void bfc_aarch64_add_imm(struct bfc_asm_t *asm_prog, const char *dst, const char *src, const ssize_t imm) {
+
+	if (imm >= 0 && imm <= 4095) {
+		bfc_aarch64_ins(asm_prog, "\tadd %s, %s, #%zd\n", dst, src, imm);
+	} else if (imm < 0 && imm >= -4095) {
+		bfc_aarch64_ins(asm_prog, "\tsub %s, %s, #%zd\n", dst, src, -imm);
+	} else {
+		bfc_aarch64_mov_imm(asm_prog, "x10", imm);
+		bfc_aarch64_ins(asm_prog, "\tadd %s, %s, x10\n", dst, src);
+	}
+}
+
+static void bfc_aarch64_adr(struct bfc_asm_t *asm_prog, const char *reg, const char *symbol) {
+
+	bfc_aarch64_ins(asm_prog, "\tadrp %s, %s\n", reg, symbol);
+	bfc_aarch64_ins(asm_prog, "\tadd %s, %s, :lo12:%s\n", reg, reg, symbol);
+}
+
+/*
+ * A conditional branch to `label`, wherever it lies in the program: cbz,
+ * cbnz and b.cond only reach 1 MiB, so `inverse`, the opposite test up to
+ * its target, skips over a plain b, which reaches 128 MiB.
+ */
+static void bfc_aarch64_branch_far(struct bfc_asm_t *asm_prog, const char *inverse, const char *label) {
+
+	char skip_label[64];
+	snprintf(skip_label, sizeof(skip_label), ".L%zu", asm_prog->label_id++);
+
+	bfc_aarch64_ins(asm_prog, "\t%s %s\n", inverse, skip_label);
+	bfc_aarch64_ins(asm_prog, "\tb %s\n", label);
+	bfc_aarch64_emit_label(asm_prog, skip_label);
+}
+
+static void bfc_aarch64_call(struct bfc_asm_t *asm_prog, const size_t label_id) {
+
+	bfc_aarch64_ins(asm_prog, "\tbl .L%zu\n", label_id);
+}
+
+static void bfc_aarch64_emit_header(struct bfc_asm_t *asm_prog) {
+
+	bfc_aarch64_ins(asm_prog, "\t.text\n");
+}
+
+static void bfc_aarch64_emit_mprotect(struct bfc_asm_t *asm_prog, const size_t offset, const size_t length, const char *fail_label) {
+
+	// mprotect(x20 + offset, length, PROT_READ | PROT_WRITE)
+	bfc_aarch64_add_imm(asm_prog, "x0", "x20", (ssize_t) offset);
+	bfc_aarch64_mov_imm(asm_prog, "x1", (ssize_t) length);
+	bfc_aarch64_ins(asm_prog, "\tmov x2, #3\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #226\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+	bfc_aarch64_branch_far(asm_prog, "cbz x0,", fail_label);
+}
+
+static void bfc_aarch64_emit_symbol(struct bfc_asm_t *asm_prog) {
+
+	const bfc_runtime_layout_t *layout = &asm_prog->layout;
+
+	asm_prog->runtime_label = asm_prog->label_id;
+	asm_prog->label_id += BFC_AARCH64_RUNTIME_LABELS;
+
+	char label[64];
+	char fail_label[64];
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_BASE);
+	snprintf(fail_label, sizeof(fail_label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_FAIL);
+
+	bfc_aarch64_ins(asm_prog, "\t.globl _start\n");
+	bfc_aarch64_emit_label(asm_prog, "_start");
+	bfc_aarch64_emit_label(asm_prog, label);
+
+	// mmap(NULL, map_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+	bfc_aarch64_ins(asm_prog, "\tmov x0, xzr\n");
+	bfc_aarch64_mov_imm(asm_prog, "x1", (ssize_t) layout->map_size);
+	bfc_aarch64_ins(asm_prog, "\tmov x2, xzr\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x3, #0x4022\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x4, #-1\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x5, xzr\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #222\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x9, #-4096\n");
+	bfc_aarch64_ins(asm_prog, "\tcmp x0, x9\n");
+	bfc_aarch64_branch_far(asm_prog, "b.ls", fail_label);
+	bfc_aarch64_add_imm(asm_prog, "x20", "x0", (ssize_t) layout->guard_bytes);
+
+	bfc_aarch64_emit_mprotect(asm_prog, 0, layout->tape_bytes, fail_label);
+	bfc_aarch64_emit_mprotect(asm_prog, layout->output_offset, 2 * BFC_IO_BUFFER_SIZE + layout->counter_bytes, fail_label);
+
+	// rt_sigaction(SIGSEGV, &act, NULL, 8) with SA_SIGINFO; the handler never returns
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_SEGV);
+
+	bfc_aarch64_ins(asm_prog, "\tsub sp, sp, #32\n");
+	bfc_aarch64_adr(asm_prog, "x0", label);
+	bfc_aarch64_ins(asm_prog, "\tmov x1, #4\n");
+	bfc_aarch64_ins(asm_prog, "\tstp x0, x1, [sp]\n");
+	bfc_aarch64_ins(asm_prog, "\tstp xzr, xzr, [sp, #16]\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x0, #11\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x1, sp\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x2, xzr\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x3, #8\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #134\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+	bfc_aarch64_ins(asm_prog, "\tadd sp, sp, #32\n");
+
+	bfc_aarch64_ins(asm_prog, "\tmov x19, x20\n");
+	bfc_aarch64_add_imm(asm_prog, "x24", "x20", (ssize_t) layout->output_offset);
+	bfc_aarch64_add_imm(asm_prog, "x25", "x20", (ssize_t) layout->input_offset);
+	if (asm_prog->opts.profile) bfc_aarch64_add_imm(asm_prog, "x28", "x20", (ssize_t) layout->counter_offset);
+	bfc_aarch64_ins(asm_prog, "\tmov x21, xzr\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x22, xzr\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x23, xzr\n");
+}
+
+/*
+ * SIGSEGV handler: flushes pending output, finds the last location
+ * recorded at or before the faulting instruction, prints
+ * "tape overflow at <line>:<col>" to stderr and exits with status 1.
+ */
+static void bfc_aarch64_emit_fault_handler(struct bfc_asm_t *asm_prog) {
+
+	char label[64];
+	char search_label[64];
+	char upper_label[64];
+	char found_label[64];
+	char utoa_label[64];
+	snprintf(search_label, sizeof(search_label), ".L%zu", asm_prog->label_id++);
+	snprintf(upper_label, sizeof(upper_label), ".L%zu", asm_prog->label_id++);
+	snprintf(found_label, sizeof(found_label), ".L%zu", asm_prog->label_id++);
+	snprintf(utoa_label, sizeof(utoa_label), ".L%zu", asm_prog->label_id++);
+
+	// the faulting pc comes from ucontext->uc_mcontext.pc
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_SEGV);
+	bfc_aarch64_emit_label(asm_prog, label);
+	bfc_aarch64_ins(asm_prog, "\tldr x27, [x2, #440]\n");
+	bfc_aarch64_call(asm_prog, asm_prog->runtime_label + BFC_AARCH64_FLUSH);
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_BASE);
+	bfc_aarch64_adr(asm_prog, "x9", label);
+	bfc_aarch64_ins(asm_prog, "\tsub x27, x27, x9\n");
+
+	// binary search over {pc, line, col} entries of 12 bytes: the last one with pc <= w27
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_LOCS);
+	bfc_aarch64_adr(asm_prog, "x26", label);
+	bfc_aarch64_ins(asm_prog, "\tmov w12, wzr\n");
+	bfc_aarch64_mov_imm32(asm_prog, "w13", (uint32_t) asm_prog->loc_length);
+	bfc_aarch64_emit_label(asm_prog, search_label);
+	bfc_aarch64_ins(asm_prog, "\tsub w9, w13, w12\n");
+	bfc_aarch64_ins(asm_prog, "\tcmp w9, #1\n");
+	bfc_aarch64_ins(asm_prog, "\tb.ls %s\n", found_label);
+	bfc_aarch64_ins(asm_prog, "\tadd w9, w12, w13\n");
+	bfc_aarch64_ins(asm_prog, "\tlsr w9, w9, #1\n");
+	bfc_aarch64_ins(asm_prog, "\tadd w10, w9, w9, lsl #1\n");
+	bfc_aarch64_ins(asm_prog, "\tldr w11, [x26, w10, uxtw #2]\n");
+	bfc_aarch64_ins(asm_prog, "\tcmp w11, w27\n");
+	bfc_aarch64_ins(asm_prog, "\tb.hi %s\n", upper_label);
+	bfc_aarch64_ins(asm_prog, "\tmov w12, w9\n");
+	bfc_aarch64_ins(asm_prog, "\tb %s\n", search_label);
+	bfc_aarch64_emit_label(asm_prog, upper_label);
+	bfc_aarch64_ins(asm_prog, "\tmov w13, w9\n");
+	bfc_aarch64_ins(asm_prog, "\tb %s\n", search_label);
+	bfc_aarch64_emit_label(asm_prog, found_label);
+	bfc_aarch64_ins(asm_prog, "\tadd w10, w12, w12, lsl #1\n");
+	bfc_aarch64_ins(asm_prog, "\tadd x26, x26, w10, uxtw #2\n");
+
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_MESSAGE);
+	bfc_aarch64_ins(asm_prog, "\tmov x0, #2\n");
+	bfc_aarch64_adr(asm_prog, "x1", label);
+	bfc_aarch64_ins(asm_prog, "\tmov x2, #%zu\n", sizeof(BFC_AARCH64_MESSAGE_TEXT) - 1);
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #64\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+
+	// "<line>:<col>\n" is built backwards on the stack
+	bfc_aarch64_ins(asm_prog, "\tsub sp, sp, #64\n");
+	bfc_aarch64_ins(asm_prog, "\tadd x1, sp, #64\n");
+	bfc_aarch64_ins(asm_prog, "\tmov w9, #10\n");
+	bfc_aarch64_ins(asm_prog, "\tstrb w9, [x1, #-1]!\n");
+	bfc_aarch64_ins(asm_prog, "\tldr w0, [x26, #8]\n");
+	bfc_aarch64_call(asm_prog, asm_prog->runtime_label + BFC_AARCH64_UTOA);
+	bfc_aarch64_ins(asm_prog, "\tmov w9, #58\n");
+	bfc_aarch64_ins(asm_prog, "\tstrb w9, [x1, #-1]!\n");
+	bfc_aarch64_ins(asm_prog, "\tldr w0, [x26, #4]\n");
+	bfc_aarch64_call(asm_prog, asm_prog->runtime_label + BFC_AARCH64_UTOA);
+	bfc_aarch64_ins(asm_prog, "\tadd x2, sp, #64\n");
+	bfc_aarch64_ins(asm_prog, "\tsub x2, x2, x1\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x0, #2\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #64\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+
+	// exit_group(1), also the way out when the tape cannot be mapped
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_FAIL);
+	bfc_aarch64_emit_label(asm_prog, label);
+	bfc_aarch64_ins(asm_prog, "\tmov x0, #1\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #94\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+
+	// utoa: writes w0 in decimal in front of x1, moving x1 back
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_UTOA);
+	bfc_aarch64_emit_label(asm_prog, label);
+	bfc_aarch64_ins(asm_prog, "\tmov w9, #10\n");
+	bfc_aarch64_emit_label(asm_prog, utoa_label);
+	bfc_aarch64_ins(asm_prog, "\tudiv w10, w0, w9\n");
+	bfc_aarch64_ins(asm_prog, "\tmsub w11, w10, w9, w0\n");
+	bfc_aarch64_ins(asm_prog, "\tadd w11, w11, #48\n");
+	bfc_aarch64_ins(asm_prog, "\tstrb w11, [x1, #-1]!\n");
+	bfc_aarch64_ins(asm_prog, "\tmov w0, w10\n");
+	bfc_aarch64_ins(asm_prog, "\tcbnz w0, %s\n", utoa_label);
+	bfc_aarch64_ins(asm_prog, "\tret\n");
+}
+
+static void bfc_aarch64_emit_runtime(struct bfc_asm_t *asm_prog) {
+
+	char label[64];
+	char loop_label[64];
+	char done_label[64];
+	char eof_label[64];
+
+	// flush: write(1, output, x21) until everything is out or the write fails
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_FLUSH);
+	snprintf(loop_label, sizeof(loop_label), ".L%zu", asm_prog->label_id++);
+	snprintf(done_label, sizeof(done_label), ".L%zu", asm_prog->label_id++);
+
+	bfc_aarch64_emit_label(asm_prog, label);
+	bfc_aarch64_ins(asm_prog, "\tmov x1, x24\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x2, x21\n");
+	bfc_aarch64_emit_label(asm_prog, loop_label);
+	bfc_aarch64_ins(asm_prog, "\tcbz x2, %s\n", done_label);
+	bfc_aarch64_ins(asm_prog, "\tmov x0, #1\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #64\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+	bfc_aarch64_ins(asm_prog, "\tcmp x0, #0\n");
+	bfc_aarch64_ins(asm_prog, "\tb.le %s\n", done_label);
+	bfc_aarch64_ins(asm_prog, "\tadd x1, x1, x0\n");
+	bfc_aarch64_ins(asm_prog, "\tsub x2, x2, x0\n");
+	bfc_aarch64_ins(asm_prog, "\tb %s\n", loop_label);
+	bfc_aarch64_emit_label(asm_prog, done_label);
+	bfc_aarch64_ins(asm_prog, "\tmov x21, xzr\n");
+	bfc_aarch64_ins(asm_prog, "\tret\n");
+
+	// getc: next input byte in w0; pending output goes out before blocking on a read
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_GETC);
+	snprintf(loop_label, sizeof(loop_label), ".L%zu", asm_prog->label_id++);
+	snprintf(eof_label, sizeof(eof_label), ".L%zu", asm_prog->label_id++);
+
+	bfc_aarch64_emit_label(asm_prog, label);
+	bfc_aarch64_ins(asm_prog, "\tcmp x22, x23\n");
+	bfc_aarch64_ins(asm_prog, "\tb.lo %s\n", loop_label);
+	bfc_aarch64_ins(asm_prog, "\tstp x29, x30, [sp, #-16]!\n");
+	bfc_aarch64_call(asm_prog, asm_prog->runtime_label + BFC_AARCH64_FLUSH);
+	bfc_aarch64_ins(asm_prog, "\tldp x29, x30, [sp], #16\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x0, #0\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x1, x25\n");
+	bfc_aarch64_mov_imm(asm_prog, "x2", BFC_IO_BUFFER_SIZE);
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #63\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x22, xzr\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x23, xzr\n");
+	bfc_aarch64_ins(asm_prog, "\tcmp x0, #0\n");
+	bfc_aarch64_ins(asm_prog, "\tb.le %s\n", eof_label);
+	bfc_aarch64_ins(asm_prog, "\tmov x23, x0\n");
+	bfc_aarch64_emit_label(asm_prog, loop_label);
+	bfc_aarch64_ins(asm_prog, "\tldrb w0, [x25, x22]\n");
+	bfc_aarch64_ins(asm_prog, "\tadd x22, x22, #1\n");
+	bfc_aarch64_ins(asm_prog, "\tret\n");
+	bfc_aarch64_emit_label(asm_prog, eof_label);
+
+	switch (asm_prog->opts.eof) {
+		case EOF_UNCHANGED: {
+			bfc_aarch64_ins(asm_prog, "\tmov w0, #-1\n");
+		} break;
+
+		case EOF_ZERO: {
+			bfc_aarch64_ins(asm_prog, "\tmov w0, #0\n");
+		} break;
+
+		// all ones in whatever width the cell is stored with
+		case EOF_MINUS_ONE: {
+			bfc_aarch64_ins(asm_prog, "\tmov w0, #-1\n");
+		} break;
+	}
+
+	bfc_aarch64_ins(asm_prog, "\tret\n");
+
+	bfc_aarch64_emit_fault_handler(asm_prog);
+}
+
+// openat(AT_FDCWD, path, O_WRONLY | O_CREAT | O_TRUNC, 0644), then the header and the counters
+static void bfc_aarch64_emit_profile_write(struct bfc_asm_t *asm_prog) {
+
+	char label[64];
+	char done_label[64];
+	snprintf(done_label, sizeof(done_label), ".L%zu", asm_prog->label_id++);
+
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_PROFILE_PATH);
+	bfc_aarch64_ins(asm_prog, "\tmov x0, #-100\n");
+	bfc_aarch64_adr(asm_prog, "x1", label);
+	bfc_aarch64_ins(asm_prog, "\tmov x2, #0x241\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x3, #0644\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #56\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+	bfc_aarch64_ins(asm_prog, "\ttbnz x0, #63, %s\n", done_label);
+	bfc_aarch64_ins(asm_prog, "\tmov x26, x0\n");
+
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_PROFILE);
+	bfc_aarch64_adr(asm_prog, "x1", label);
+	bfc_aarch64_mov_imm(asm_prog, "x2", (ssize_t) bfc_profile_header_size(asm_prog->opts.profile));
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #64\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+
+	bfc_aarch64_ins(asm_prog, "\tmov x0, x26\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x1, x28\n");
+	bfc_aarch64_mov_imm(asm_prog, "x2", (ssize_t) asm_prog->layout.counter_bytes);
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #64\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+
+	bfc_aarch64_ins(asm_prog, "\tmov x0, x26\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #57\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+	bfc_aarch64_emit_label(asm_prog, done_label);
+}
+
+static void bfc_aarch64_emit_end(struct bfc_asm_t *asm_prog) {
+
+	bfc_aarch64_call(asm_prog, asm_prog->runtime_label + BFC_AARCH64_FLUSH);
+
+	if (asm_prog->opts.profile) bfc_aarch64_emit_profile_write(asm_prog);
+
+	bfc_aarch64_ins(asm_prog, "\tmov x0, #0\n");
+	bfc_aarch64_ins(asm_prog, "\tmov x8, #93\n");
+	bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+
+	bfc_aarch64_emit_runtime(asm_prog);
+}
+
+static void bfc_aarch64_emit_blob(struct bfc_asm_t *asm_prog, const size_t label_id, const uint8_t *data, const size_t length) {
+
+	if (length == 0) return;
+
+	char label[64];
+	snprintf(label, sizeof(label), ".L%zu", label_id);
+	bfc_aarch64_emit_label(asm_prog, label);
+
+	bfc_codegen_emit_byte_rows(&asm_prog, data, length);
+}
+
+static void bfc_aarch64_emit_data_section(struct bfc_asm_t *asm_prog) {
+
+	const bfc_snapshot_t *snapshot = asm_prog->snapshot;
+
+	bfc_aarch64_ins(asm_prog, "\n\t.section .rodata\n");
+
+	if (snapshot) {
+		bfc_aarch64_emit_blob(
+			asm_prog, asm_prog->data_label,
+			snapshot->tape + snapshot->tape_begin, snapshot->tape_end - snapshot->tape_begin
+		);
+		bfc_aarch64_emit_blob(asm_prog, asm_prog->data_label + 1, snapshot->output, snapshot->output_length);
+	}
+
+	char label[64];
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_LOCS);
+	bfc_aarch64_ins(asm_prog, "\t.p2align 2\n");
+	bfc_aarch64_emit_label(asm_prog, label);
+
+	for (size_t i = 0; i < asm_prog->loc_length; ++i) {
+		const bfc_asm_loc_t loc = asm_prog->locs[i];
+
+		bfc_aarch64_ins(
+			asm_prog, "\t.word .L%zu-.L%zu, %u, %u\n", 
+			loc.pc, asm_prog->runtime_label + BFC_AARCH64_BASE, loc.line, loc.col
+		);
+	}
+
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_AARCH64_MESSAGE);
+	bfc_aarch64_emit_label(asm_prog, label);
+	bfc_aarch64_ins(asm_prog, "\t.ascii \"" BFC_AARCH64_MESSAGE_TEXT "\"\n");
+
+	if (asm_prog->opts.profile) {
+		const bfc_profile_t *profile = asm_prog->opts.profile;
+		const size_t header_size = bfc_profile_header_size(profile);
+
+		uint8_t *header = (uint8_t*) malloc(header_size);
+		if (!header) {
+			asm_prog->alloc_failed = 1;
+		} else {
+			bfc_profile_encode_header(profile, header);
+			bfc_aarch64_emit_blob(asm_prog, asm_prog->runtime_label + BFC_AARCH64_PROFILE, header, header_size);
+			free(header);
+		}
+
+		bfc_aarch64_emit_blob(
+			asm_prog, asm_prog->runtime_label + BFC_AARCH64_PROFILE_PATH,
+			(const uint8_t*) profile->path, strlen(profile->path) + 1
+		);
+	}
+
+	bfc_aarch64_ins(asm_prog, "\n\t.section .note.GNU-stack,\"\",@progbits\n");
+}
+
+static void bfc_aarch64_emit_op_add(struct bfc_asm_t *asm_prog, ssize_t off, ssize_t imm) {
+
+	const uint32_t mask = BFC_CELL_MASK(asm_prog->opts.cell_width);
+	const uint32_t value = (uint32_t) imm & mask;
+	if (value == 0) return;
+
+	// the store truncates, so subtracting the negation is just as good
+	const uint32_t negated = -value & mask;
+
+	bfc_aarch64_cell_access(asm_prog, "ld", "w9", off);
+
+	if (value <= 4095) {
+		bfc_aarch64_ins(asm_prog, "\tadd w9, w9, #%u\n", value);
+	} else if (negated <= 4095) {
+		bfc_aarch64_ins(asm_prog, "\tsub w9, w9, #%u\n", negated);
+	} else {
+		bfc_aarch64_mov_imm32(asm_prog, "w12", value);
+		bfc_aarch64_ins(asm_prog, "\tadd w9, w9, w12\n");
+	}
+
+	bfc_aarch64_cell_access(asm_prog, "st", "w9", off);
+}
+
+static void bfc_aarch64_emit_op_move(struct bfc_asm_t *asm_prog, ssize_t cells) {
+
+	if (cells == 0) return;
+
+	bfc_aarch64_add_imm(asm_prog, "x19", "x19", cells * asm_prog->opts.cell_width);
+}
+
+static void bfc_aarch64_emit_snapshot(struct bfc_asm_t *asm_prog) {
+
+	const bfc_snapshot_t *snapshot = asm_prog->snapshot;
+
+	// labels for the tape image and the output blob in the data section
+	asm_prog->data_label = asm_prog->label_id;
+	asm_prog->label_id += 2;
+
+	char data_label[64];
+	char loop_label[64];
+	char done_label[64];
+
+	if (snapshot->tape_end > snapshot->tape_begin) {
+		snprintf(data_label, sizeof(data_label), ".L%zu", asm_prog->data_label);
+		snprintf(loop_label, sizeof(loop_label), ".L%zu", asm_prog->label_id++);
+
+		bfc_aarch64_adr(asm_prog, "x1", data_label);
+		bfc_aarch64_add_imm(asm_prog, "x2", "x20", (ssize_t) snapshot->tape_begin);
+		bfc_aarch64_mov_imm(asm_prog, "x3", (ssize_t) (snapshot->tape_end - snapshot->tape_begin));
+		bfc_aarch64_emit_label(asm_prog, loop_label);
+		bfc_aarch64_ins(asm_prog, "\tldrb w9, [x1], #1\n");
+		bfc_aarch64_ins(asm_prog, "\tstrb w9, [x2], #1\n");
+		bfc_aarch64_ins(asm_prog, "\tsubs x3, x3, #1\n");
+		bfc_aarch64_ins(asm_prog, "\tb.ne %s\n", loop_label);
+	}
+
+	if (snapshot->output_length > 0) {
+		snprintf(data_label, sizeof(data_label), ".L%zu", asm_prog->data_label + 1);
+		snprintf(loop_label, sizeof(loop_label), ".L%zu", asm_prog->label_id++);
+		snprintf(done_label, sizeof(done_label), ".L%zu", asm_prog->label_id++);
+
+		// write(1, output, length) until everything is out or the write fails
+		bfc_aarch64_adr(asm_prog, "x1", data_label);
+		bfc_aarch64_mov_imm(asm_prog, "x2", (ssize_t) snapshot->output_length);
+		bfc_aarch64_emit_label(asm_prog, loop_label);
+		bfc_aarch64_ins(asm_prog, "\tmov x0, #1\n");
+		bfc_aarch64_ins(asm_prog, "\tmov x8, #64\n");
+		bfc_aarch64_ins(asm_prog, "\tsvc #0\n");
+		bfc_aarch64_ins(asm_prog, "\tcmp x0, #0\n");
+		bfc_aarch64_ins(asm_prog, "\tb.le %s\n", done_label);
+		bfc_aarch64_ins(asm_prog, "\tadd x1, x1, x0\n");
+		bfc_aarch64_ins(asm_prog, "\tsubs x2, x2, x0\n");
+		bfc_aarch64_ins(asm_prog, "\tb.ne %s\n", loop_label);
+		bfc_aarch64_emit_label(asm_prog, done_label);
+	}
+
+	bfc_aarch64_emit_op_move(asm_prog, snapshot->ptr);
+}
+
+static void bfc_aarch64_emit_op_get(struct bfc_asm_t *asm_prog, ssize_t off) {
+
+	char label[64];
+
+	bfc_aarch64_call(asm_prog, asm_prog->runtime_label + BFC_AARCH64_GETC);
+
+	if (asm_prog->opts.eof == EOF_UNCHANGED) {
+		snprintf(label, sizeof(label), ".L%zu", asm_prog->label_id++);
+
+		bfc_aarch64_ins(asm_prog, "\ttbnz w0, #31, %s\n", label);
+	}
+
+	bfc_aarch64_cell_access(asm_prog, "st", "w0", off);
+
+	if (asm_prog->opts.eof == EOF_UNCHANGED) bfc_aarch64_emit_label(asm_prog, label);
+}
+
+static void bfc_aarch64_emit_output_reserve(struct bfc_asm_t *asm_prog, size_t count) {
+
+	char label[64];
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->label_id++);
+
+	bfc_aarch64_mov_imm(asm_prog, "x10", (ssize_t) (BFC_IO_BUFFER_SIZE - count));
+	bfc_aarch64_ins(asm_prog, "\tcmp x21, x10\n");
+	bfc_aarch64_ins(asm_prog, "\tb.ls %s\n", label);
+	bfc_aarch64_call(asm_prog, asm_prog->runtime_label + BFC_AARCH64_FLUSH);
+	bfc_aarch64_emit_label(asm_prog, label);
+}
+
+static void bfc_aarch64_emit_op_put(struct bfc_asm_t *asm_prog, ssize_t off) {
+
+	// room was made by the preceding output reserve; only the low byte of the cell goes out
+	bfc_aarch64_access(asm_prog, "ld", 1, "w9", off * asm_prog->opts.cell_width);
+	bfc_aarch64_ins(asm_prog, "\tstrb w9, [x24, x21]\n");
+	bfc_aarch64_ins(asm_prog, "\tadd x21, x21, #1\n");
+}
+
+static void bfc_aarch64_emit_op_set(struct bfc_asm_t *asm_prog, ssize_t off, ssize_t imm) {
+
+	const uint32_t value = (uint32_t) imm & BFC_CELL_MASK(asm_prog->opts.cell_width);
+
+	if (value == 0) {
+		bfc_aarch64_cell_access(asm_prog, "st", "wzr", off);
+
+		return;
+	}
+
+	bfc_aarch64_mov_imm32(asm_prog, "w9", value);
+	bfc_aarch64_cell_access(asm_prog, "st", "w9", off);
+}
+
+static void bfc_aarch64_emit_op_mul(struct bfc_asm_t *asm_prog, ssize_t off, ssize_t dst, ssize_t factor) {
+
+	const uint32_t mask = BFC_CELL_MASK(asm_prog->opts.cell_width);
+	const uint32_t value = (uint32_t) factor & mask;
+	if (value == 0) return;
+
+	bfc_aarch64_cell_access(asm_prog, "ld", "w9", off);
+
+	if (value != 1 && value != mask) {
+		bfc_aarch64_mov_imm32(asm_prog, "w12", value);
+		bfc_aarch64_ins(asm_prog, "\tmul w9, w9, w12\n");
+	}
+
+	// the multiply only matters modulo the cell width
+	bfc_aarch64_cell_access(asm_prog, "ld", "w11", dst);
+	bfc_aarch64_ins(asm_prog, "\t%s w11, w11, w9\n", value == mask ? "sub" : "add");
+	bfc_aarch64_cell_access(asm_prog, "st", "w11", dst);
+}
+
+static void bfc_aarch64_emit_op_scan(struct bfc_asm_t *asm_prog, ssize_t stride) {
+
+	char loop_label[64];
+	char test_label[64];
+	snprintf(loop_label, sizeof(loop_label), ".L%zu", asm_prog->label_id++);
+	snprintf(test_label, sizeof(test_label), ".L%zu", asm_prog->label_id++);
+
+	// rotated so that every step costs one load and one taken branch
+	bfc_aarch64_ins(asm_prog, "\tb %s\n", test_label);
+	bfc_aarch64_emit_label(asm_prog, loop_label);
+	bfc_aarch64_emit_op_move(asm_prog, stride);
+	bfc_aarch64_emit_label(asm_prog, test_label);
+	bfc_aarch64_cell_access(asm_prog, "ld", "w9", 0);
+	bfc_aarch64_ins(asm_prog, "\tcbnz w9, %s\n", loop_label);
+}
+
+static void bfc_aarch64_emit_op_count(struct bfc_asm_t *asm_prog, size_t counter) {
+
+	const size_t offset = counter * sizeof(uint64_t);
+
+	if (offset <= 4095 * sizeof(uint64_t)) {
+		bfc_aarch64_ins(asm_prog, "\tldr x9, [x28, #%zu]\n", offset);
+		bfc_aarch64_ins(asm_prog, "\tadd x9, x9, #1\n");
+		bfc_aarch64_ins(asm_prog, "\tstr x9, [x28, #%zu]\n", offset);
+	} else {
+		bfc_aarch64_mov_imm(asm_prog, "x10", (ssize_t) offset);
+		bfc_aarch64_ins(asm_prog, "\tldr x9, [x28, x10]\n");
+		bfc_aarch64_ins(asm_prog, "\tadd x9, x9, #1\n");
+		bfc_aarch64_ins(asm_prog, "\tstr x9, [x28, x10]\n");
+	}
+}
+
+static void bfc_aarch64_emit_loop_test_z(struct bfc_asm_t *asm_prog, const char *label) {
+
+	bfc_aarch64_cell_access(asm_prog, "ld", "w9", 0);
+	bfc_aarch64_branch_far(asm_prog, "cbnz w9,", label);
+}
+
+static void bfc_aarch64_emit_loop_test_nz(struct bfc_asm_t *asm_prog, const char *label) {
+
+	bfc_aarch64_cell_access(asm_prog, "ld", "w9", 0);
+	bfc_aarch64_branch_far(asm_prog, "cbz w9,", label);
+}
+
+static const bfc_backend_t bfc_backend_aarch64 = {
+	.emit_header       = bfc_aarch64_emit_header,
+	.emit_data_section = bfc_aarch64_emit_data_section,
+	.emit_symbol       = bfc_aarch64_emit_symbol,
+	.emit_end          = bfc_aarch64_emit_end,
+	.emit_label        = bfc_aarch64_emit_label,
+	.emit_align        = bfc_aarch64_emit_align,
+	.emit_snapshot     = bfc_aarch64_emit_snapshot,
+
+	.emit_output_reserve = bfc_aarch64_emit_output_reserve,
+
+	.emit_op_add       = bfc_aarch64_emit_op_add,
+	.emit_op_move      = bfc_aarch64_emit_op_move,
+	.emit_op_get       = bfc_aarch64_emit_op_get,
+	.emit_op_put       = bfc_aarch64_emit_op_put,
+	.emit_op_set       = bfc_aarch64_emit_op_set,
+	.emit_op_mul       = bfc_aarch64_emit_op_mul,
+	.emit_op_scan      = bfc_aarch64_emit_op_scan,
+	.emit_op_count     = bfc_aarch64_emit_op_count,
+	.emit_loop_test_z  = bfc_aarch64_emit_loop_test_z,
+	.emit_loop_test_nz = bfc_aarch64_emit_loop_test_nz,
+};
+
+bfc_error_t bfc_codegen_aarch64(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block) {
+
+	(*asm_prog)->arch = ARCH_aarch64;
+	(*asm_prog)->os = OS_LINUX;
+	(*asm_prog)->backend = bfc_backend_aarch64;
+
+	if ((*asm_prog)->format != ASM_FMT_TEXT) return bfc_make_error(ERR_INTERNAL, "The aarch64 backend only emits assembly text!");
+
+	const bfc_backend_t *backend = &(*asm_prog)->backend;
+
+	backend->emit_header(*asm_prog);
+	backend->emit_symbol(*asm_prog);
+
+	if ((*asm_prog)->snapshot) backend->emit_snapshot(*asm_prog);
+
+	bfc_codegen_emit_block(asm_prog, ir_block);
+
+	backend->emit_end(*asm_prog);
+	backend->emit_data_section(*asm_prog);
+
+	if ((*asm_prog)->alloc_failed) return BFC_ERR_ALLOC;
+
+	return BFC_ERR_OK;
+}
@@ -0,0 +1,1017 @@
+#include "bfc_codegen.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * x86_64 Linux backend.
+ *
+ * Every instruction is lowered once and carries both its GAS (AT&T) text and
+ * its machine encoding; ASM_FMT_TEXT keeps the former, ASM_FMT_JIT and
+ * ASM_FMT_EXEC the latter. That way `-S`, `--run` and executables can never
+ * disagree on what a program compiles to.
+ *
+ * Register assignment for the whole program:
+ *   %rbx  current tape pointer
+ *   %r12  tape base
+ *   %r13  bytes pending in the output buffer
+ *   %r14  read position in the input buffer
+ *   %r15  end of the valid input
+ *
+ * All of them are callee-saved and never touched by the syscall ABI, so
+ * they stay pinned across I/O. The I/O buffers sit behind the tape and are
+ * reached from %r12; two small routines emitted after the program flush
+ * the output and fetch the next input byte.
+ *
+ * Freestanding programs map the runtime layout themselves and install a
+ * SIGSEGV handler that looks the faulting instruction up in a table of
+ * source locations, so running off the tape into a guard page reports
+ * where it happened. Instrumented ones also write their loop counters to
+ * the profile before they exit.
+ */
+
+#define ENC(...)     (const uint8_t[]) { __VA_ARGS__ }, sizeof((const uint8_t[]) { __VA_ARGS__ })
+#define IMM32(v)     (uint8_t) (v), (uint8_t) ((v) >> 8), (uint8_t) ((v) >> 16), (uint8_t) ((v) >> 24)
+#define IMM64(v)     IMM32(v), IMM32((uint64_t) (v) >> 32)
+
+// routines and data emitted after the program, relative to `runtime_label`
+enum {
+	BFC_X86_64_FLUSH,
+	BFC_X86_64_GETC,
+	BFC_X86_64_SEGV,
+	BFC_X86_64_UTOA,
+	BFC_X86_64_FAIL,
+	BFC_X86_64_BASE,
+	BFC_X86_64_LOCS,
+	BFC_X86_64_MESSAGE,
+	BFC_X86_64_PROFILE,
+	BFC_X86_64_PROFILE_PATH,
+	BFC_X86_64_RUNTIME_LABELS,
+};
+
+#define BFC_X86_64_MESSAGE_TEXT "tape overflow at "
+
+static void bfc_x86_64_ins(struct bfc_asm_t *asm_prog, const uint8_t *enc, size_t enc_len, const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+
+static void bfc_x86_64_ins(struct bfc_asm_t *asm_prog, const uint8_t *enc, size_t enc_len, const char *fmt, ...) {
+
+	if (asm_prog->format != ASM_FMT_TEXT) {
+		bfc_codegen_emit_bytes(&asm_prog, enc, enc_len);
+
+		return;
+	}
+
+	char line[256];
+
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+
+	bfc_codegen_emit_asm(&asm_prog, line);
+}
+
+/*
+ * Encodes `opcode` followed by the ModRM byte (and displacement) for the
+ * memory operand `off(%rbx)`. In text mode its AT&T spelling goes to `mem`.
+ * Returns the number of bytes written to `enc`.
+ */
+static size_t bfc_x86_64_mem_operand(const struct bfc_asm_t *asm_prog, uint8_t *enc, char *mem, const size_t mem_size, const uint8_t *opcode, const size_t opcode_len, const uint8_t reg, const ssize_t off) {
+
+	if (asm_prog->format == ASM_FMT_TEXT) {
+		if (off == 0) {
+			snprintf(mem, mem_size, "(%%rbx)");
+		} else {
+			snprintf(mem, mem_size, "%zd(%%rbx)", off);
+		}
+	}
+
+	size_t length = 0;
+	for (size_t i = 0; i < opcode_len; ++i) enc[length++] = opcode[i];
+
+	if (off == 0) {
+		enc[length++] = (uint8_t) (0x03 | (reg << 3));
+	} else if (off >= INT8_MIN && off <= INT8_MAX) {
+		enc[length++] = (uint8_t) (0x43 | (reg << 3));
+		enc[length++] = (uint8_t) off;
+	} else {
+		const uint8_t disp[] = {IMM32(off)};
+
+		enc[length++] = (uint8_t) (0x83 | (reg << 3));
+		for (size_t i = 0; i < sizeof(disp); ++i) enc[length++] = disp[i];
+	}
+
+	return length;
+}
+
+static void bfc_x86_64_text(struct bfc_asm_t *asm_prog, const char *directive) {
+
+	if (asm_prog->format == ASM_FMT_TEXT) bfc_codegen_emit_asm(&asm_prog, directive);
+}
+
+static void bfc_x86_64_jcc(struct bfc_asm_t *asm_prog, uint8_t opcode, const char *mnemonic, const char *label) {
+
+	if (asm_prog->format == ASM_FMT_TEXT) {
+		char line[128];
+		snprintf(line, sizeof(line), "\t%s %s\n", mnemonic, label);
+		bfc_codegen_emit_asm(&asm_prog, line);
+
+		return;
+	}
+
+	const uint8_t enc[] = {0x0F, opcode};
+	bfc_codegen_emit_bytes(&asm_prog, enc, sizeof(enc));
+	bfc_codegen_emit_rel32(&asm_prog, label);
+}
+
+static void bfc_x86_64_jmp(struct bfc_asm_t *asm_prog, const char *label) {
+
+	if (asm_prog->format == ASM_FMT_TEXT) {
+		char line[128];
+		snprintf(line, sizeof(line), "\tjmp %s\n", label);
+		bfc_codegen_emit_asm(&asm_prog, line);
+
+		return;
+	}
+
+	const uint8_t enc[] = {0xE9};
+	bfc_codegen_emit_bytes(&asm_prog, enc, sizeof(enc));
+	bfc_codegen_emit_rel32(&asm_prog, label);
+}
+
+static void bfc_x86_64_emit_header(struct bfc_asm_t *asm_prog) {
+
+	bfc_x86_64_text(asm_prog, "\t.text\n");
+}
+
+static void bfc_x86_64_call(struct bfc_asm_t *asm_prog, const size_t label_id) {
+
+	char label[64];
+	snprintf(label, sizeof(label), ".L%zu", label_id);
+
+	if (asm_prog->format == ASM_FMT_TEXT) {
+		char line[128];
+		snprintf(line, sizeof(line), "\tcall %s\n", label);
+		bfc_codegen_emit_asm(&asm_prog, line);
+
+		return;
+	}
+
+	const uint8_t enc[] = {0xE8};
+	bfc_codegen_emit_bytes(&asm_prog, enc, sizeof(enc));
+	bfc_codegen_emit_rel32(&asm_prog, label);
+}
+
+static void bfc_x86_64_emit_label(struct bfc_asm_t *asm_prog, const char *label) {
+
+	if (asm_prog->format == ASM_FMT_TEXT) {
+		bfc_codegen_emit_label(&asm_prog, label);
+	} else {
+		bfc_codegen_bind_label(&asm_prog, label);
+	}
+}
+
+static void bfc_x86_64_emit_align(struct bfc_asm_t *asm_prog) {
+
+	if (asm_prog->format == ASM_FMT_TEXT) {
+		bfc_codegen_emit_asm(&asm_prog, "\t.p2align 4\n");
+		return;
+	}
+
+	// the longest nops that fit, so the padding decodes as few instructions as possible
+	static const uint8_t nops[9][9] = {
+		{0x90},
+		{0x66, 0x90},
+		{0x0F, 0x1F, 0x00},
+		{0x0F, 0x1F, 0x40, 0x00},
+		{0x0F, 0x1F, 0x44, 0x00, 0x00},
+		{0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00},
+		{0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00},
+		{0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+		{0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+	};
+
+	size_t padding = (16 - asm_prog->length % 16) % 16;
+
+	while (padding > 0) {
+		const size_t n = padding < 9 ? padding : 9;
+
+		bfc_codegen_emit_bytes(&asm_prog, nops[n - 1], n);
+		padding -= n;
+	}
+}
+
+static void bfc_x86_64_lea_rip(struct bfc_asm_t *asm_prog, const uint8_t modrm, const char *reg, const size_t label_id) {
+
+	char label[64];
+	snprintf(label, sizeof(label), ".L%zu", label_id);
+
+	if (asm_prog->format == ASM_FMT_TEXT) {
+		char line[128];
+		snprintf(line, sizeof(line), "\tleaq %s(%%rip), %s\n", label, reg);
+		bfc_codegen_emit_asm(&asm_prog, line);
+
+		return;
+	}
+
+	const uint8_t enc[] = {0x48, 0x8D, modrm};
+	bfc_codegen_emit_bytes(&asm_prog, enc, sizeof(enc));
+	bfc_codegen_emit_rel32(&asm_prog, label);
+}
+
+static void bfc_x86_64_emit_mprotect(struct bfc_asm_t *asm_prog, const size_t offset, const size_t length, const char *fail_label) {
+
+	// mprotect(%r12 + offset, length, PROT_READ | PROT_WRITE)
+	if (offset == 0) {
+		bfc_x86_64_ins(asm_prog, ENC(0x4C, 0x89, 0xE7), "\tmovq %%r12, %%rdi\n");
+	} else {
+		bfc_x86_64_ins(asm_prog, ENC(0x49, 0x8D, 0xBC, 0x24, IMM32(offset)), "\tleaq %zu(%%r12), %%rdi\n", offset);
+	}
+	bfc_x86_64_ins(asm_prog, ENC(0xBE, IMM32(length)), "\tmovl $%zu, %%esi\n", length);
+	bfc_x86_64_ins(asm_prog, ENC(0xBA, IMM32(3)), "\tmovl $3, %%edx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(10)), "\tmovl $10, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x85, 0xC0), "\ttestq %%rax, %%rax\n");
+	bfc_x86_64_jcc(asm_prog, 0x85, "jne", fail_label);
+}
+
+// maps the runtime layout with the guards left PROT_NONE and installs the SIGSEGV handler
+static void bfc_x86_64_emit_startup(struct bfc_asm_t *asm_prog) {
+
+	const bfc_runtime_layout_t *layout = &asm_prog->layout;
+
+	char label[64];
+	char fail_label[64];
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_X86_64_BASE);
+	snprintf(fail_label, sizeof(fail_label), ".L%zu", asm_prog->runtime_label + BFC_X86_64_FAIL);
+
+	bfc_x86_64_text(asm_prog, "\t.globl _start\n");
+	bfc_x86_64_text(asm_prog, "_start:\n");
+	bfc_x86_64_emit_label(asm_prog, label);
+
+	// mmap(NULL, map_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+	bfc_x86_64_ins(asm_prog, ENC(0x31, 0xFF), "\txorl %%edi, %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xBE, IMM32(layout->map_size)), "\tmovl $%zu, %%esi\n", layout->map_size);
+	bfc_x86_64_ins(asm_prog, ENC(0x31, 0xD2), "\txorl %%edx, %%edx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x41, 0xBA, IMM32(0x4022)), "\tmovl $0x4022, %%r10d\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0xC7, 0xC0, IMM32(-1)), "\tmovq $-1, %%r8\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x45, 0x31, 0xC9), "\txorl %%r9d, %%r9d\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(9)), "\tmovl $9, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x3D, IMM32(-4096)), "\tcmpq $-4096, %%rax\n");
+	bfc_x86_64_jcc(asm_prog, 0x87, "ja", fail_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x4C, 0x8D, 0xA0, IMM32(layout->guard_bytes)), "\tleaq %zu(%%rax), %%r12\n", layout->guard_bytes);
+
+	bfc_x86_64_emit_mprotect(asm_prog, 0, layout->tape_bytes, fail_label);
+	bfc_x86_64_emit_mprotect(asm_prog, layout->output_offset, 2 * BFC_IO_BUFFER_SIZE + layout->counter_bytes, fail_label);
+
+	// rt_sigaction(SIGSEGV, &act, NULL, 8) with SA_SIGINFO | SA_RESTORER; the handler never returns
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x83, 0xEC, 0x20), "\tsubq $32, %%rsp\n");
+	bfc_x86_64_lea_rip(asm_prog, 0x05, "%rax", asm_prog->runtime_label + BFC_X86_64_SEGV);
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x89, 0x04, 0x24), "\tmovq %%rax, (%%rsp)\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0xC7, 0x44, 0x24, 0x08, IMM32(0x4000004)), "\tmovq $0x4000004, 8(%%rsp)\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x89, 0x44, 0x24, 0x10), "\tmovq %%rax, 16(%%rsp)\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0xC7, 0x44, 0x24, 0x18, IMM32(0)), "\tmovq $0, 24(%%rsp)\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xBF, IMM32(11)), "\tmovl $11, %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x89, 0xE6), "\tmovq %%rsp, %%rsi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x31, 0xD2), "\txorl %%edx, %%edx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x41, 0xBA, IMM32(8)), "\tmovl $8, %%r10d\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(13)), "\tmovl $13, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x83, 0xC4, 0x20), "\taddq $32, %%rsp\n");
+}
+
+static void bfc_x86_64_emit_symbol(struct bfc_asm_t *asm_prog) {
+
+	asm_prog->runtime_label = asm_prog->label_id;
+	asm_prog->label_id += BFC_X86_64_RUNTIME_LABELS;
+
+	if (asm_prog->format == ASM_FMT_JIT) {
+		// void entry(uint8_t *tape)
+		bfc_x86_64_ins(asm_prog, ENC(0x53), "\tpushq %%rbx\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x41, 0x54), "\tpushq %%r12\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x41, 0x55), "\tpushq %%r13\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x41, 0x56), "\tpushq %%r14\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x41, 0x57), "\tpushq %%r15\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x49, 0x89, 0xFC), "\tmovq %%rdi, %%r12\n");
+	} else {
+		bfc_x86_64_emit_startup(asm_prog);
+	}
+
+	bfc_x86_64_ins(asm_prog, ENC(0x4C, 0x89, 0xE3), "\tmovq %%r12, %%rbx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x45, 0x31, 0xED), "\txorl %%r13d, %%r13d\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x45, 0x31, 0xF6), "\txorl %%r14d, %%r14d\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x45, 0x31, 0xFF), "\txorl %%r15d, %%r15d\n");
+}
+
+/*
+ * SIGSEGV handler for freestanding programs: flushes pending output, finds
+ * the last location recorded at or before the faulting instruction,
+ * prints "tape overflow at <line>:<col>" to stderr and exits with status 1.
+ */
+static void bfc_x86_64_emit_fault_handler(struct bfc_asm_t *asm_prog) {
+
+	char label[64];
+	char search_label[64];
+	char upper_label[64];
+	char found_label[64];
+	char utoa_label[64];
+	snprintf(search_label, sizeof(search_label), ".L%zu", asm_prog->label_id++);
+	snprintf(upper_label, sizeof(upper_label), ".L%zu", asm_prog->label_id++);
+	snprintf(found_label, sizeof(found_label), ".L%zu", asm_prog->label_id++);
+	snprintf(utoa_label, sizeof(utoa_label), ".L%zu", asm_prog->label_id++);
+
+	// the faulting pc comes from ucontext->uc_mcontext.gregs[REG_RIP]
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_X86_64_SEGV);
+	bfc_x86_64_emit_label(asm_prog, label);
+	bfc_x86_64_ins(asm_prog, ENC(0x4C, 0x8B, 0xBA, IMM32(168)), "\tmovq 168(%%rdx), %%r15\n");
+	bfc_x86_64_call(asm_prog, asm_prog->runtime_label + BFC_X86_64_FLUSH);
+	bfc_x86_64_lea_rip(asm_prog, 0x05, "%rax", asm_prog->runtime_label + BFC_X86_64_BASE);
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0x29, 0xC7), "\tsubq %%rax, %%r15\n");
+
+	// binary search over {pc, line, col} entries of 12 bytes: the last one with pc <= %r15d
+	bfc_x86_64_lea_rip(asm_prog, 0x35, "%rsi", asm_prog->runtime_label + BFC_X86_64_LOCS);
+	bfc_x86_64_ins(asm_prog, ENC(0x31, 0xC9), "\txorl %%ecx, %%ecx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xBA, IMM32(asm_prog->loc_length)), "\tmovl $%zu, %%edx\n", asm_prog->loc_length);
+	bfc_x86_64_emit_label(asm_prog, search_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x89, 0xD0), "\tmovl %%edx, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x29, 0xC8), "\tsubl %%ecx, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x83, 0xF8, 0x01), "\tcmpl $1, %%eax\n");
+	bfc_x86_64_jcc(asm_prog, 0x86, "jbe", found_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x8D, 0x04, 0x11), "\tleal (%%rcx,%%rdx), %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xD1, 0xE8), "\tshrl %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x8D, 0x3C, 0x40), "\tleal (%%rax,%%rax,2), %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x44, 0x39, 0x3C, 0xBE), "\tcmpl %%r15d, (%%rsi,%%rdi,4)\n");
+	bfc_x86_64_jcc(asm_prog, 0x87, "ja", upper_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x89, 0xC1), "\tmovl %%eax, %%ecx\n");
+	bfc_x86_64_jmp(asm_prog, search_label);
+	bfc_x86_64_emit_label(asm_prog, upper_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x89, 0xC2), "\tmovl %%eax, %%edx\n");
+	bfc_x86_64_jmp(asm_prog, search_label);
+	bfc_x86_64_emit_label(asm_prog, found_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x8D, 0x3C, 0x49), "\tleal (%%rcx,%%rcx,2), %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x4C, 0x8D, 0x34, 0xBE), "\tleaq (%%rsi,%%rdi,4), %%r14\n");
+
+	bfc_x86_64_ins(asm_prog, ENC(0xBF, IMM32(2)), "\tmovl $2, %%edi\n");
+	bfc_x86_64_lea_rip(asm_prog, 0x35, "%rsi", asm_prog->runtime_label + BFC_X86_64_MESSAGE);
+	bfc_x86_64_ins(asm_prog, ENC(0xBA, IMM32(sizeof(BFC_X86_64_MESSAGE_TEXT) - 1)), "\tmovl $%zu, %%edx\n", sizeof(BFC_X86_64_MESSAGE_TEXT) - 1);
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(1)), "\tmovl $1, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+
+	// "<line>:<col>\n" is built backwards below the stack pointer
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x83, 0xEC, 0x40), "\tsubq $64, %%rsp\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x8D, 0x7C, 0x24, 0x40), "\tleaq 64(%%rsp), %%rdi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0xFF, 0xCF), "\tdecq %%rdi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xC6, 0x07, 0x0A), "\tmovb $10, (%%rdi)\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x41, 0x8B, 0x46, 0x08), "\tmovl 8(%%r14), %%eax\n");
+	bfc_x86_64_call(asm_prog, asm_prog->runtime_label + BFC_X86_64_UTOA);
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0xFF, 0xCF), "\tdecq %%rdi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xC6, 0x07, 0x3A), "\tmovb $58, (%%rdi)\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x41, 0x8B, 0x46, 0x04), "\tmovl 4(%%r14), %%eax\n");
+	bfc_x86_64_call(asm_prog, asm_prog->runtime_label + BFC_X86_64_UTOA);
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x89, 0xFE), "\tmovq %%rdi, %%rsi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x8D, 0x54, 0x24, 0x40), "\tleaq 64(%%rsp), %%rdx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x29, 0xF2), "\tsubq %%rsi, %%rdx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xBF, IMM32(2)), "\tmovl $2, %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(1)), "\tmovl $1, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+
+	// exit_group(1), also the way out when the tape cannot be mapped
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_X86_64_FAIL);
+	bfc_x86_64_emit_label(asm_prog, label);
+	bfc_x86_64_ins(asm_prog, ENC(0xBF, IMM32(1)), "\tmovl $1, %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(231)), "\tmovl $231, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+
+	// utoa: writes %eax in decimal in front of %rdi, moving %rdi back
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_X86_64_UTOA);
+	bfc_x86_64_emit_label(asm_prog, label);
+	bfc_x86_64_ins(asm_prog, ENC(0xB9, IMM32(10)), "\tmovl $10, %%ecx\n");
+	bfc_x86_64_emit_label(asm_prog, utoa_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x31, 0xD2), "\txorl %%edx, %%edx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xF7, 0xF1), "\tdivl %%ecx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x80, 0xC2, 0x30), "\taddb $48, %%dl\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0xFF, 0xCF), "\tdecq %%rdi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x88, 0x17), "\tmovb %%dl, (%%rdi)\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x85, 0xC0), "\ttestl %%eax, %%eax\n");
+	bfc_x86_64_jcc(asm_prog, 0x85, "jne", utoa_label);
+	bfc_x86_64_ins(asm_prog, ENC(0xC3), "\tret\n");
+}
+
+static void bfc_x86_64_emit_runtime(struct bfc_asm_t *asm_prog) {
+
+	const bfc_runtime_layout_t *layout = &asm_prog->layout;
+
+	char label[64];
+	char loop_label[64];
+	char done_label[64];
+	char eof_label[64];
+
+	// flush: write(1, output, %r13) until everything is out or the write fails
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_X86_64_FLUSH);
+	snprintf(loop_label, sizeof(loop_label), ".L%zu", asm_prog->label_id++);
+	snprintf(done_label, sizeof(done_label), ".L%zu", asm_prog->label_id++);
+
+	bfc_x86_64_emit_label(asm_prog, label);
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0x8D, 0xB4, 0x24, IMM32(layout->output_offset)), "\tleaq %zu(%%r12), %%rsi\n", layout->output_offset);
+	bfc_x86_64_ins(asm_prog, ENC(0x4C, 0x89, 0xEA), "\tmovq %%r13, %%rdx\n");
+	bfc_x86_64_emit_label(asm_prog, loop_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x85, 0xD2), "\ttestq %%rdx, %%rdx\n");
+	bfc_x86_64_jcc(asm_prog, 0x84, "je", done_label);
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(1)), "\tmovl $1, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xBF, IMM32(1)), "\tmovl $1, %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x85, 0xC0), "\ttestq %%rax, %%rax\n");
+	bfc_x86_64_jcc(asm_prog, 0x8E, "jle", done_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x01, 0xC6), "\taddq %%rax, %%rsi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x29, 0xC2), "\tsubq %%rax, %%rdx\n");
+	bfc_x86_64_jmp(asm_prog, loop_label);
+	bfc_x86_64_emit_label(asm_prog, done_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x45, 0x31, 0xED), "\txorl %%r13d, %%r13d\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xC3), "\tret\n");
+
+	// getc: next input byte in %eax; pending output goes out before blocking on a read
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_X86_64_GETC);
+	snprintf(loop_label, sizeof(loop_label), ".L%zu", asm_prog->label_id++);
+	snprintf(eof_label, sizeof(eof_label), ".L%zu", asm_prog->label_id++);
+
+	bfc_x86_64_emit_label(asm_prog, label);
+	bfc_x86_64_ins(asm_prog, ENC(0x4D, 0x39, 0xFE), "\tcmpq %%r15, %%r14\n");
+	bfc_x86_64_jcc(asm_prog, 0x82, "jb", loop_label);
+	bfc_x86_64_call(asm_prog, asm_prog->runtime_label + BFC_X86_64_FLUSH);
+	bfc_x86_64_ins(asm_prog, ENC(0x31, 0xC0), "\txorl %%eax, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x31, 0xFF), "\txorl %%edi, %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0x8D, 0xB4, 0x24, IMM32(layout->input_offset)), "\tleaq %zu(%%r12), %%rsi\n", layout->input_offset);
+	bfc_x86_64_ins(asm_prog, ENC(0xBA, IMM32(BFC_IO_BUFFER_SIZE)), "\tmovl $%d, %%edx\n", BFC_IO_BUFFER_SIZE);
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x45, 0x31, 0xF6), "\txorl %%r14d, %%r14d\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x45, 0x31, 0xFF), "\txorl %%r15d, %%r15d\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x85, 0xC0), "\ttestq %%rax, %%rax\n");
+	bfc_x86_64_jcc(asm_prog, 0x8E, "jle", eof_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0x89, 0xC7), "\tmovq %%rax, %%r15\n");
+	bfc_x86_64_emit_label(asm_prog, loop_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x43, 0x0F, 0xB6, 0x84, 0x34, IMM32(layout->input_offset)), "\tmovzbl %zu(%%r12,%%r14), %%eax\n", layout->input_offset);
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0xFF, 0xC6), "\tincq %%r14\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xC3), "\tret\n");
+	bfc_x86_64_emit_label(asm_prog, eof_label);
+
+	switch (asm_prog->opts.eof) {
+		case EOF_UNCHANGED: {
+			bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(-1)), "\tmovl $-1, %%eax\n");
+		} break;
+
+		case EOF_ZERO: {
+			bfc_x86_64_ins(asm_prog, ENC(0x31, 0xC0), "\txorl %%eax, %%eax\n");
+		} break;
+
+		// all ones in whatever width the cell is stored with
+		case EOF_MINUS_ONE: {
+			bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(-1)), "\tmovl $-1, %%eax\n");
+		} break;
+	}
+
+	bfc_x86_64_ins(asm_prog, ENC(0xC3), "\tret\n");
+
+	if (asm_prog->format != ASM_FMT_JIT) bfc_x86_64_emit_fault_handler(asm_prog);
+}
+
+/*
+ * open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644), then the profile header
+ * from the data section and the counters straight from memory. Without
+ * libc there is nowhere to report a failure to, so the program just exits.
+ */
+static void bfc_x86_64_emit_profile_write(struct bfc_asm_t *asm_prog) {
+
+	const bfc_runtime_layout_t *layout = &asm_prog->layout;
+	const size_t header_size = bfc_profile_header_size(asm_prog->opts.profile);
+
+	char done_label[64];
+	snprintf(done_label, sizeof(done_label), ".L%zu", asm_prog->label_id++);
+
+	bfc_x86_64_lea_rip(asm_prog, 0x3D, "%rdi", asm_prog->runtime_label + BFC_X86_64_PROFILE_PATH);
+	bfc_x86_64_ins(asm_prog, ENC(0xBE, IMM32(0x241)), "\tmovl $0x241, %%esi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xBA, IMM32(0644)), "\tmovl $0644, %%edx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(2)), "\tmovl $2, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x85, 0xC0), "\ttestl %%eax, %%eax\n");
+	bfc_x86_64_jcc(asm_prog, 0x88, "js", done_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x41, 0x89, 0xC7), "\tmovl %%eax, %%r15d\n");
+
+	bfc_x86_64_ins(asm_prog, ENC(0x89, 0xC7), "\tmovl %%eax, %%edi\n");
+	bfc_x86_64_lea_rip(asm_prog, 0x35, "%rsi", asm_prog->runtime_label + BFC_X86_64_PROFILE);
+	bfc_x86_64_ins(asm_prog, ENC(0xBA, IMM32(header_size)), "\tmovl $%zu, %%edx\n", header_size);
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(1)), "\tmovl $1, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+
+	bfc_x86_64_ins(asm_prog, ENC(0x44, 0x89, 0xFF), "\tmovl %%r15d, %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0x8D, 0xB4, 0x24, IMM32(layout->counter_offset)), "\tleaq %zu(%%r12), %%rsi\n", layout->counter_offset);
+	bfc_x86_64_ins(asm_prog, ENC(0xBA, IMM32(layout->counter_bytes)), "\tmovl $%zu, %%edx\n", layout->counter_bytes);
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(1)), "\tmovl $1, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+
+	bfc_x86_64_ins(asm_prog, ENC(0x44, 0x89, 0xFF), "\tmovl %%r15d, %%edi\n");
+	bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(3)), "\tmovl $3, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+	bfc_x86_64_emit_label(asm_prog, done_label);
+}
+
+static void bfc_x86_64_emit_end(struct bfc_asm_t *asm_prog) {
+
+	bfc_x86_64_call(asm_prog, asm_prog->runtime_label + BFC_X86_64_FLUSH);
+
+	if (asm_prog->format == ASM_FMT_JIT) {
+		bfc_x86_64_ins(asm_prog, ENC(0x41, 0x5F), "\tpopq %%r15\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x41, 0x5E), "\tpopq %%r14\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x41, 0x5D), "\tpopq %%r13\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x41, 0x5C), "\tpopq %%r12\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x5B), "\tpopq %%rbx\n");
+		bfc_x86_64_ins(asm_prog, ENC(0xC3), "\tret\n");
+	} else {
+		if (asm_prog->opts.profile) bfc_x86_64_emit_profile_write(asm_prog);
+
+		bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(60)), "\tmovl $60, %%eax\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x31, 0xFF), "\txorl %%edi, %%edi\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+	}
+
+	bfc_x86_64_emit_runtime(asm_prog);
+}
+
+static void bfc_x86_64_emit_blob(struct bfc_asm_t *asm_prog, const size_t label_id, const uint8_t *data, const size_t length) {
+
+	if (length == 0) return;
+
+	char label[64];
+	snprintf(label, sizeof(label), ".L%zu", label_id);
+	bfc_x86_64_emit_label(asm_prog, label);
+
+	if (asm_prog->format != ASM_FMT_TEXT) {
+		bfc_codegen_emit_bytes(&asm_prog, data, length);
+
+		return;
+	}
+
+	bfc_codegen_emit_byte_rows(&asm_prog, data, length);
+}
+
+static void bfc_x86_64_emit_data_section(struct bfc_asm_t *asm_prog) {
+
+	const bfc_snapshot_t *snapshot = asm_prog->snapshot;
+
+	// in machine code the data simply follows the code it is addressed from
+	bfc_x86_64_text(asm_prog, "\n\t.section .rodata\n");
+
+	if (snapshot) {
+		bfc_x86_64_emit_blob(
+			asm_prog, asm_prog->data_label, 
+			snapshot->tape + snapshot->tape_begin, snapshot->tape_end - snapshot->tape_begin
+		);
+		bfc_x86_64_emit_blob(asm_prog, asm_prog->data_label + 1, snapshot->output, snapshot->output_length);
+	}
+
+	if (asm_prog->format != ASM_FMT_JIT) {
+		char label[64];
+		char line[128];
+
+		snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_X86_64_LOCS);
+		bfc_x86_64_emit_label(asm_prog, label);
+
+		for (size_t i = 0; i < asm_prog->loc_length; ++i) {
+			const bfc_asm_loc_t loc = asm_prog->locs[i];
+
+			if (asm_prog->format == ASM_FMT_TEXT) {
+				snprintf(
+					line, sizeof(line), "\t.long .L%zu-.L%zu, %u, %u\n", 
+					loc.pc, asm_prog->runtime_label + BFC_X86_64_BASE, loc.line, loc.col
+				);
+				bfc_codegen_emit_asm(&asm_prog, line);
+			} else {
+				const uint8_t entry[] = {IMM32(loc.pc), IMM32(loc.line), IMM32(loc.col)};
+				bfc_codegen_emit_bytes(&asm_prog, entry, sizeof(entry));
+			}
+		}
+
+		snprintf(label, sizeof(label), ".L%zu", asm_prog->runtime_label + BFC_X86_64_MESSAGE);
+		bfc_x86_64_emit_label(asm_prog, label);
+
+		if (asm_prog->format == ASM_FMT_TEXT) {
+			bfc_codegen_emit_asm(&asm_prog, "\t.ascii \"" BFC_X86_64_MESSAGE_TEXT "\"\n");
+		} else {
+			bfc_codegen_emit_bytes(&asm_prog, BFC_X86_64_MESSAGE_TEXT, sizeof(BFC_X86_64_MESSAGE_TEXT) - 1);
+		}
+
+		if (asm_prog->opts.profile) {
+			const bfc_profile_t *profile = asm_prog->opts.profile;
+			const size_t header_size = bfc_profile_header_size(profile);
+
+			uint8_t *header = (uint8_t*) malloc(header_size);
+			if (!header) {
+				asm_prog->alloc_failed = 1;
+			} else {
+				bfc_profile_encode_header(profile, header);
+				bfc_x86_64_emit_blob(asm_prog, asm_prog->runtime_label + BFC_X86_64_PROFILE, header, header_size);
+				free(header);
+			}
+
+			// with its terminating NUL; the bytes need no escaping that way
+			bfc_x86_64_emit_blob(
+				asm_prog, asm_prog->runtime_label + BFC_X86_64_PROFILE_PATH,
+				(const uint8_t*) profile->path, strlen(profile->path) + 1
+			);
+		}
+	}
+
+	bfc_x86_64_text(asm_prog, "\n\t.section .note.GNU-stack,\"\",@progbits\n");
+}
+
+static char bfc_x86_64_suffix(const struct bfc_asm_t *asm_prog) {
+
+	return asm_prog->opts.cell_width == 1 ? 'b' : asm_prog->opts.cell_width == 2 ? 'w' : 'l';
+}
+
+static int32_t bfc_x86_64_signed(const uint8_t width, const uint32_t value) {
+
+	return width == 1 ? (int8_t) value : width == 2 ? (int16_t) value : (int32_t) value;
+}
+
+static size_t bfc_x86_64_imm(uint8_t *enc, const uint32_t value, const uint8_t size) {
+
+	for (uint8_t i = 0; i < size; ++i) enc[i] = (uint8_t) (value >> (8 * i));
+
+	return size;
+}
+
+// like bfc_x86_64_mem_operand, but for the cell at cell offset `off`, with the operand-size prefix 16-bit cells need
+static size_t bfc_x86_64_cell_operand(const struct bfc_asm_t *asm_prog, uint8_t *enc, char *mem, const size_t mem_size, const uint8_t *opcode, const size_t opcode_len, const uint8_t reg, const ssize_t off) {
+
+	const uint8_t width = asm_prog->opts.cell_width;
+
+	size_t length = 0;
+	if (width == 2) enc[length++] = 0x66;
+
+	return length + bfc_x86_64_mem_operand(asm_prog, enc + length, mem, mem_size, opcode, opcode_len, reg, off * width);
+}
+
+static void bfc_x86_64_emit_op_add(struct bfc_asm_t *asm_prog, ssize_t off, ssize_t imm) {
+
+	const uint8_t width = asm_prog->opts.cell_width;
+	const uint32_t value = (uint32_t) imm & BFC_CELL_MASK(width);
+	if (value == 0) return;
+
+	uint8_t enc[16];
+	char mem[32];
+	size_t length;
+
+	if (width == 1) {
+		length = bfc_x86_64_cell_operand(asm_prog, enc, mem, sizeof(mem), ENC(0x80), 0, off);
+		enc[length++] = (uint8_t) value;
+
+		bfc_x86_64_ins(asm_prog, enc, length, "\taddb $%u, %s\n", value, mem);
+
+		return;
+	}
+
+	// like GAS, use the sign-extended 8-bit immediate whenever it fits
+	const int32_t simm = bfc_x86_64_signed(width, value);
+	const uint8_t is_imm8 = simm >= INT8_MIN && simm <= INT8_MAX;
+
+	length = bfc_x86_64_cell_operand(asm_prog, enc, mem, sizeof(mem), ENC(is_imm8 ? 0x83 : 0x81), 0, off);
+	length += bfc_x86_64_imm(enc + length, (uint32_t) simm, is_imm8 ? 1 : width);
+
+	bfc_x86_64_ins(asm_prog, enc, length, "\tadd%c $%d, %s\n", bfc_x86_64_suffix(asm_prog), simm, mem);
+}
+
+static void bfc_x86_64_emit_op_move(struct bfc_asm_t *asm_prog, ssize_t cells) {
+
+	if (cells == 0) return;
+
+	const ssize_t imm = cells * asm_prog->opts.cell_width;
+
+	if (imm >= INT8_MIN && imm <= INT8_MAX) {
+		bfc_x86_64_ins(asm_prog, ENC(0x48, 0x83, 0xC3, (uint8_t) imm), "\taddq $%zd, %%rbx\n", imm);
+	} else if (imm >= INT32_MIN && imm <= INT32_MAX) {
+		bfc_x86_64_ins(asm_prog, ENC(0x48, 0x81, 0xC3, IMM32(imm)), "\taddq $%zd, %%rbx\n", imm);
+	} else {
+		bfc_x86_64_ins(asm_prog, ENC(0x48, 0xB8, IMM64(imm)), "\tmovabsq $%zd, %%rax\n", imm);
+		bfc_x86_64_ins(asm_prog, ENC(0x48, 0x01, 0xC3), "\taddq %%rax, %%rbx\n");
+	}
+}
+
+static void bfc_x86_64_emit_snapshot(struct bfc_asm_t *asm_prog) {
+
+	const bfc_snapshot_t *snapshot = asm_prog->snapshot;
+
+	// labels for the tape image and the output blob in the data section
+	asm_prog->data_label = asm_prog->label_id;
+	asm_prog->label_id += 2;
+
+	if (snapshot->tape_end > snapshot->tape_begin) {
+		size_t begin = snapshot->tape_begin;
+		size_t length = snapshot->tape_end - snapshot->tape_begin;
+
+		bfc_x86_64_lea_rip(asm_prog, 0x35, "%rsi", asm_prog->data_label);
+		bfc_x86_64_ins(asm_prog, ENC(0x49, 0x8D, 0xBC, 0x24, IMM32(begin)), "\tleaq %zu(%%r12), %%rdi\n", begin);
+		bfc_x86_64_ins(asm_prog, ENC(0xB9, IMM32(length)), "\tmovl $%zu, %%ecx\n", length);
+		bfc_x86_64_ins(asm_prog, ENC(0xF3, 0xA4), "\trep movsb\n");
+	}
+
+	if (snapshot->output_length > 0) {
+		char loop_label[64];
+		char done_label[64];
+		snprintf(loop_label, sizeof(loop_label), ".L%zu", asm_prog->label_id++);
+		snprintf(done_label, sizeof(done_label), ".L%zu", asm_prog->label_id++);
+
+		// write(1, output, length) until everything is out or the write fails
+		bfc_x86_64_lea_rip(asm_prog, 0x35, "%rsi", asm_prog->data_label + 1);
+		bfc_x86_64_ins(asm_prog, ENC(0xBA, IMM32(snapshot->output_length)), "\tmovl $%zu, %%edx\n", snapshot->output_length);
+		bfc_x86_64_emit_label(asm_prog, loop_label);
+		bfc_x86_64_ins(asm_prog, ENC(0xB8, IMM32(1)), "\tmovl $1, %%eax\n");
+		bfc_x86_64_ins(asm_prog, ENC(0xBF, IMM32(1)), "\tmovl $1, %%edi\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x0F, 0x05), "\tsyscall\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x48, 0x85, 0xC0), "\ttestq %%rax, %%rax\n");
+		bfc_x86_64_jcc(asm_prog, 0x8E, "jle", done_label);
+		bfc_x86_64_ins(asm_prog, ENC(0x48, 0x01, 0xC6), "\taddq %%rax, %%rsi\n");
+		bfc_x86_64_ins(asm_prog, ENC(0x48, 0x29, 0xC2), "\tsubq %%rax, %%rdx\n");
+		bfc_x86_64_jcc(asm_prog, 0x85, "jne", loop_label);
+		bfc_x86_64_emit_label(asm_prog, done_label);
+	}
+
+	bfc_x86_64_emit_op_move(asm_prog, snapshot->ptr);
+}
+
+static void bfc_x86_64_emit_op_get(struct bfc_asm_t *asm_prog, ssize_t off) {
+
+	uint8_t enc[16];
+	char mem[32];
+	char label[64];
+
+	bfc_x86_64_call(asm_prog, asm_prog->runtime_label + BFC_X86_64_GETC);
+
+	if (asm_prog->opts.eof == EOF_UNCHANGED) {
+		snprintf(label, sizeof(label), ".L%zu", asm_prog->label_id++);
+
+		bfc_x86_64_ins(asm_prog, ENC(0x85, 0xC0), "\ttestl %%eax, %%eax\n");
+		bfc_x86_64_jcc(asm_prog, 0x88, "js", label);
+	}
+
+	const uint8_t width = asm_prog->opts.cell_width;
+	const char *reg = width == 1 ? "%al" : width == 2 ? "%ax" : "%eax";
+
+	size_t length = bfc_x86_64_cell_operand(asm_prog, enc, mem, sizeof(mem), ENC(width == 1 ? 0x88 : 0x89), 0, off);
+	bfc_x86_64_ins(asm_prog, enc, length, "\tmov%c %s, %s\n", bfc_x86_64_suffix(asm_prog), reg, mem);
+
+	if (asm_prog->opts.eof == EOF_UNCHANGED) bfc_x86_64_emit_label(asm_prog, label);
+}
+
+static void bfc_x86_64_emit_output_reserve(struct bfc_asm_t *asm_prog, size_t count) {
+
+	char label[64];
+	snprintf(label, sizeof(label), ".L%zu", asm_prog->label_id++);
+
+	const int32_t limit = (int32_t) (BFC_IO_BUFFER_SIZE - count);
+
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0x81, 0xFD, IMM32(limit)), "\tcmpq $%d, %%r13\n", limit);
+	bfc_x86_64_jcc(asm_prog, 0x86, "jbe", label);
+	bfc_x86_64_call(asm_prog, asm_prog->runtime_label + BFC_X86_64_FLUSH);
+	bfc_x86_64_emit_label(asm_prog, label);
+}
+
+static void bfc_x86_64_emit_op_put(struct bfc_asm_t *asm_prog, ssize_t off) {
+
+	uint8_t enc[16];
+	char mem[32];
+	// the low byte of the cell is what gets written
+	size_t length = bfc_x86_64_mem_operand(asm_prog, enc, mem, sizeof(mem), ENC(0x0F, 0xB6), 0, off * asm_prog->opts.cell_width);
+
+	// room was made by the preceding output reserve
+	bfc_x86_64_ins(asm_prog, enc, length, "\tmovzbl %s, %%eax\n", mem);
+	bfc_x86_64_ins(asm_prog, ENC(0x43, 0x88, 0x84, 0x2C, IMM32(asm_prog->layout.output_offset)), "\tmovb %%al, %zu(%%r12,%%r13)\n", asm_prog->layout.output_offset);
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0xFF, 0xC5), "\tincq %%r13\n");
+}
+
+static void bfc_x86_64_emit_op_set(struct bfc_asm_t *asm_prog, ssize_t off, ssize_t imm) {
+
+	const uint8_t width = asm_prog->opts.cell_width;
+	const uint32_t value = (uint32_t) imm & BFC_CELL_MASK(width);
+
+	uint8_t enc[16];
+	char mem[32];
+	size_t length = bfc_x86_64_cell_operand(asm_prog, enc, mem, sizeof(mem), ENC(width == 1 ? 0xC6 : 0xC7), 0, off);
+	length += bfc_x86_64_imm(enc + length, value, width);
+
+	bfc_x86_64_ins(asm_prog, enc, length, "\tmov%c $%u, %s\n", bfc_x86_64_suffix(asm_prog), value, mem);
+}
+
+static void bfc_x86_64_emit_op_mul(struct bfc_asm_t *asm_prog, ssize_t off, ssize_t dst, ssize_t factor) {
+
+	const uint8_t width = asm_prog->opts.cell_width;
+	const uint32_t mask = BFC_CELL_MASK(width);
+	const uint32_t value = (uint32_t) factor & mask;
+	if (value == 0) return;
+
+	const char suffix = bfc_x86_64_suffix(asm_prog);
+	const char *reg = width == 1 ? "%al" : width == 2 ? "%ax" : "%eax";
+
+	uint8_t enc[16];
+	char mem[32];
+	size_t length;
+
+	if (value == 1 || value == mask) {
+		length = bfc_x86_64_cell_operand(asm_prog, enc, mem, sizeof(mem), ENC(width == 1 ? 0x8A : 0x8B), 0, off);
+		bfc_x86_64_ins(asm_prog, enc, length, "\tmov%c %s, %s\n", suffix, mem, reg);
+	} else {
+		const int32_t simm = bfc_x86_64_signed(width, value);
+
+		if (width == 4) {
+			length = bfc_x86_64_cell_operand(asm_prog, enc, mem, sizeof(mem), ENC(0x8B), 0, off);
+			bfc_x86_64_ins(asm_prog, enc, length, "\tmovl %s, %%eax\n", mem);
+		} else {
+			// movzbl/movzwl take no operand-size prefix
+			length = bfc_x86_64_mem_operand(asm_prog, enc, mem, sizeof(mem), ENC(0x0F, width == 1 ? 0xB6 : 0xB7), 0, off * width);
+			bfc_x86_64_ins(asm_prog, enc, length, "\tmovz%cl %s, %%eax\n", suffix, mem);
+		}
+
+		if (simm >= INT8_MIN && simm <= INT8_MAX) {
+			bfc_x86_64_ins(asm_prog, ENC(0x6B, 0xC0, (uint8_t) simm), "\timull $%d, %%eax, %%eax\n", simm);
+		} else {
+			bfc_x86_64_ins(asm_prog, ENC(0x69, 0xC0, IMM32(simm)), "\timull $%d, %%eax, %%eax\n", simm);
+		}
+	}
+
+	// add/sub the low bits of the product to dst; the multiply only matters modulo the cell size
+	const uint8_t is_sub = value == mask;
+	const uint8_t opcode = (uint8_t) ((is_sub ? 0x28 : 0x00) | (width == 1 ? 0x00 : 0x01));
+
+	length = bfc_x86_64_cell_operand(asm_prog, enc, mem, sizeof(mem), ENC(opcode), 0, dst);
+	bfc_x86_64_ins(asm_prog, enc, length, "\t%s%c %s, %s\n", is_sub ? "sub" : "add", suffix, reg, mem);
+}
+
+// cmp{b,w,l} $0, (%rbx)
+static void bfc_x86_64_emit_test(struct bfc_asm_t *asm_prog) {
+
+	switch (asm_prog->opts.cell_width) {
+		case 1: bfc_x86_64_ins(asm_prog, ENC(0x80, 0x3B, 0x00), "\tcmpb $0, (%%rbx)\n"); break;
+		case 2: bfc_x86_64_ins(asm_prog, ENC(0x66, 0x83, 0x3B, 0x00), "\tcmpw $0, (%%rbx)\n"); break;
+		default: bfc_x86_64_ins(asm_prog, ENC(0x83, 0x3B, 0x00), "\tcmpl $0, (%%rbx)\n"); break;
+	}
+}
+
+static void bfc_x86_64_emit_op_scan(struct bfc_asm_t *asm_prog, ssize_t stride) {
+
+	char loop_label[64];
+	char done_label[64];
+	snprintf(loop_label, sizeof(loop_label), ".L%zu", asm_prog->label_id++);
+	snprintf(done_label, sizeof(done_label), ".L%zu", asm_prog->label_id++);
+
+	ssize_t abs_stride = stride < 0 ? -stride : stride;
+
+	if (asm_prog->cold || asm_prog->opts.cell_width != 1 || (abs_stride != 1 && abs_stride != 2 && abs_stride != 4 && abs_stride != 8)) {
+		bfc_x86_64_emit_label(asm_prog, loop_label);
+		bfc_x86_64_emit_test(asm_prog);
+		bfc_x86_64_jcc(asm_prog, 0x84, "je", done_label);
+		bfc_x86_64_emit_op_move(asm_prog, stride);
+		bfc_x86_64_jmp(asm_prog, loop_label);
+		bfc_x86_64_emit_label(asm_prog, done_label);
+
+		return;
+	}
+
+	/*
+	 * Compare the aligned 16-cell block holding the current cell against
+	 * zero and keep only the lanes the stride visits from there on. Aligned
+	 * loads never straddle a page, so the scan can't fault on a guard page
+	 * it would not have reached one cell at a time. Moving right the lowest
+	 * hit wins, moving left the highest. The block size is a multiple of
+	 * every stride handled here, so after the first block the lanes keep
+	 * the phase of the current cell, c mod stride.
+	 */
+	uint32_t mask;
+	if (stride > 0) {
+		mask = abs_stride == 1 ? 0xFFFF : abs_stride == 2 ? 0x5555 : abs_stride == 4 ? 0x1111 : 0x0101;
+	} else {
+		mask = abs_stride == 1 ? 0xFFFF : abs_stride == 2 ? 0xAAAA : abs_stride == 4 ? 0x8888 : 0x8080;
+	}
+
+	// %ecx: how far the current lane is from lane 0 (right) or lane 15 (left)
+	bfc_x86_64_ins(asm_prog, ENC(0x89, 0xD9), "\tmovl %%ebx, %%ecx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x83, 0xE1, 0x0F), "\tandl $15, %%ecx\n");
+	if (stride < 0) bfc_x86_64_ins(asm_prog, ENC(0x83, 0xF1, 0x0F), "\txorl $15, %%ecx\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x83, 0xE3, 0xF0), "\tandq $-16, %%rbx\n");
+
+	// %edx: lanes to test in the first block, %esi: in every later one
+	bfc_x86_64_ins(asm_prog, ENC(0xBA, IMM32(mask)), "\tmovl $0x%x, %%edx\n", mask);
+
+	if (stride > 0) {
+		bfc_x86_64_ins(asm_prog, ENC(0xD3, 0xE2), "\tshll %%cl, %%edx\n");
+	} else {
+		bfc_x86_64_ins(asm_prog, ENC(0xD3, 0xEA), "\tshrl %%cl, %%edx\n");
+	}
+
+	bfc_x86_64_ins(asm_prog, ENC(0xBE, IMM32(mask)), "\tmovl $0x%x, %%esi\n", mask);
+
+	if (abs_stride > 1) {
+		bfc_x86_64_ins(asm_prog, ENC(0x83, 0xE1, (uint8_t) (abs_stride - 1)), "\tandl $%zd, %%ecx\n", abs_stride - 1);
+
+		if (stride > 0) {
+			bfc_x86_64_ins(asm_prog, ENC(0xD3, 0xE6), "\tshll %%cl, %%esi\n");
+		} else {
+			bfc_x86_64_ins(asm_prog, ENC(0xD3, 0xEE), "\tshrl %%cl, %%esi\n");
+		}
+	}
+
+	bfc_x86_64_ins(asm_prog, ENC(0x66, 0x0F, 0xEF, 0xC9), "\tpxor %%xmm1, %%xmm1\n");
+	bfc_x86_64_emit_label(asm_prog, loop_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x66, 0x0F, 0x6F, 0x03), "\tmovdqa (%%rbx), %%xmm0\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x66, 0x0F, 0x74, 0xC1), "\tpcmpeqb %%xmm1, %%xmm0\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x66, 0x0F, 0xD7, 0xC0), "\tpmovmskb %%xmm0, %%eax\n");
+	bfc_x86_64_ins(asm_prog, ENC(0x21, 0xD0), "\tandl %%edx, %%eax\n");
+	bfc_x86_64_jcc(asm_prog, 0x85, "jne", done_label);
+	bfc_x86_64_ins(asm_prog, ENC(0x89, 0xF2), "\tmovl %%esi, %%edx\n");
+
+	if (stride > 0) {
+		bfc_x86_64_ins(asm_prog, ENC(0x48, 0x83, 0xC3, 0x10), "\taddq $16, %%rbx\n");
+	} else {
+		bfc_x86_64_ins(asm_prog, ENC(0x48, 0x83, 0xEB, 0x10), "\tsubq $16, %%rbx\n");
+	}
+
+	bfc_x86_64_jmp(asm_prog, loop_label);
+	bfc_x86_64_emit_label(asm_prog, done_label);
+
+	if (stride > 0) {
+		bfc_x86_64_ins(asm_prog, ENC(0x0F, 0xBC, 0xC0), "\tbsfl %%eax, %%eax\n");
+	} else {
+		bfc_x86_64_ins(asm_prog, ENC(0x0F, 0xBD, 0xC0), "\tbsrl %%eax, %%eax\n");
+	}
+
+	bfc_x86_64_ins(asm_prog, ENC(0x48, 0x01, 0xC3), "\taddq %%rax, %%rbx\n");
+}
+
+// addq $1, counter(%r12)
+static void bfc_x86_64_emit_op_count(struct bfc_asm_t *asm_prog, size_t counter) {
+
+	const size_t offset = asm_prog->layout.counter_offset + counter * sizeof(uint64_t);
+
+	bfc_x86_64_ins(asm_prog, ENC(0x49, 0x83, 0x84, 0x24, IMM32(offset), 0x01), "\taddq $1, %zu(%%r12)\n", offset);
+}
+
+static void bfc_x86_64_emit_loop_test_z(struct bfc_asm_t *asm_prog, const char *label) {
+
+	bfc_x86_64_emit_test(asm_prog);
+	bfc_x86_64_jcc(asm_prog, 0x84, "je", label);
+}
+
+static void bfc_x86_64_emit_loop_test_nz(struct bfc_asm_t *asm_prog, const char *label) {
+
+	bfc_x86_64_emit_test(asm_prog);
+	bfc_x86_64_jcc(asm_prog, 0x85, "jne", label);
+}
+
+static const bfc_backend_t bfc_backend_x86_64 = {
+	.emit_header       = bfc_x86_64_emit_header,
+	.emit_data_section = bfc_x86_64_emit_data_section,
+	.emit_symbol       = bfc_x86_64_emit_symbol,
+	.emit_end          = bfc_x86_64_emit_end,
+	.emit_label        = bfc_x86_64_emit_label,
+	.emit_align        = bfc_x86_64_emit_align,
+	.emit_snapshot     = bfc_x86_64_emit_snapshot,
+
+	.emit_output_reserve = bfc_x86_64_emit_output_reserve,
+
+	.emit_op_add       = bfc_x86_64_emit_op_add,
+	.emit_op_move      = bfc_x86_64_emit_op_move,
+	.emit_op_get       = bfc_x86_64_emit_op_get,
+	.emit_op_put       = bfc_x86_64_emit_op_put,
+	.emit_op_set       = bfc_x86_64_emit_op_set,
+	.emit_op_mul       = bfc_x86_64_emit_op_mul,
+	.emit_op_scan      = bfc_x86_64_emit_op_scan,
+	.emit_op_count     = bfc_x86_64_emit_op_count,
+	.emit_loop_test_z  = bfc_x86_64_emit_loop_test_z,
+	.emit_loop_test_nz = bfc_x86_64_emit_loop_test_nz,
+};
+
+bfc_error_t bfc_codegen_x86_64(bfc_asm_t **asm_prog, const bfc_ir_block_t *const ir_block) {
+
+	(*asm_prog)->arch = ARCH_X86_64;
+	(*asm_prog)->os = OS_LINUX;
+	(*asm_prog)->backend = bfc_backend_x86_64;
+
+	const bfc_backend_t *backend = &(*asm_prog)->backend;
+
+	backend->emit_header(*asm_prog);
+	backend->emit_symbol(*asm_prog);
+
+	if ((*asm_prog)->snapshot) backend->emit_snapshot(*asm_prog);
+
+	bfc_codegen_emit_block(asm_prog, ir_block);
+
+	backend->emit_end(*asm_prog);
+	backend->emit_data_section(*asm_prog);
+
+	if ((*asm_prog)->alloc_failed) return BFC_ERR_ALLOC;
+
+	if ((*asm_prog)->format != ASM_FMT_TEXT) return bfc_codegen_resolve_fixups(asm_prog);
+
+	return BFC_ERR_OK;
+}
@@ -0,0 +1,125 @@
+#include "bfc_driver.h"
+
+#include "bfc_elf.h"
+#include "bfc_jumptable.h"
+#include "bfc_parser.h"
+
+#include <stdlib.h>
+
+size_t bfc_driver_report_ir(const bfc_driver_t *const driver) {
+
+	return (bfc_report_enabled(&driver->report) && driver->root_block) ? bfc_ir_count(driver->root_block) : 0;
+}
+
+bfc_error_t bfc_driver_frontend(bfc_driver_t *const driver, const bfc_args_t *const cmd_args, FILE *diag) {
+
+	bfc_report_t *const report = &driver->report;
+
+	driver->runtime = cmd_args->runtime_opts;
+
+	bfc_report_begin(report, "load", 0, NULL);
+	bfc_error_t err = bfc_program_create(&driver->program, cmd_args->input);
+	bfc_report_end(report, driver->program ? driver->program->file_size : 0, "bytes");
+	if (err.code != ERR_OK) return err;
+
+	err = bfc_arena_create(&driver->arena);
+	if (err.code != ERR_OK) return err;
+
+	report->arena = driver->arena;
+
+	bfc_program_t *const program = driver->program;
+
+	if (cmd_args->f_staged_frontend) {
+		bfc_report_begin(report, "lex", program->file_size, "bytes");
+		err = bfc_lex(&driver->tok_stream, program, *cmd_args);
+		bfc_report_end(report, driver->tok_stream ? driver->tok_stream->length : 0, "tokens");
+		if (err.code != ERR_OK) return err;
+
+		bfc_report_begin(report, "jump table", driver->tok_stream->length, "tokens");
+		err = bfc_parse_jump_table(&driver->jump_table, driver->tok_stream);
+		bfc_report_end(report, driver->tok_stream->length, "tokens");
+		if (err.code != ERR_OK) return err;
+
+		bfc_report_begin(report, "ir create", driver->tok_stream->length, "tokens");
+		err = bfc_ir_create(&driver->root_block, driver->tok_stream, driver->arena);
+		bfc_report_end(report, bfc_driver_report_ir(driver), "instrs");
+		if (err.code != ERR_OK) return err;
+
+		bfc_report_begin(report, "rep", bfc_driver_report_ir(driver), "instrs");
+		err = bfc_ir_optimize_rep(&driver->root_block);
+		bfc_report_end(report, bfc_driver_report_ir(driver), "instrs");
+		if (err.code != ERR_OK) return err;
+	} else {
+		bfc_report_begin(report, "parse", program->file_size, "bytes");
+		err = bfc_parse(&driver->root_block, program, *cmd_args, driver->arena);
+		bfc_report_end(report, bfc_driver_report_ir(driver), "instrs");
+		if (err.code != ERR_OK) return err;
+	}
+
+	driver->pass_ctx.arena = driver->arena;
+	driver->pass_ctx.runtime = driver->runtime;
+	driver->pass_ctx.report = report;
+	driver->pass_ctx.diag = diag;
+
+	err = bfc_pass_run(&driver->root_block, &driver->pass_ctx, cmd_args->passes);
+	driver->snapshot = driver->pass_ctx.snapshot;
+	if (err.code != ERR_OK) return err;
+
+	if (cmd_args->passes.stats) bfc_pass_print_stats(&driver->pass_ctx, diag);
+
+	if (cmd_args->profile_use) {
+		bfc_report_begin(report, "profile use", bfc_driver_report_ir(driver), "instrs");
+		err = bfc_profile_read(
+			&driver->profile_in,
+			bfc_get_profile_path(cmd_args, cmd_args->profile_use, driver->profile_in_path, sizeof(driver->profile_in_path)),
+			driver->arena
+		);
+		if (err.code == ERR_OK) err = bfc_profile_apply(driver->profile_in, driver->root_block);
+		bfc_report_end(report, driver->profile_in ? driver->profile_in->length : 0, "loops");
+		if (err.code != ERR_OK) return err;
+	}
+
+	// counters go in after the passes, so they count the loops that are actually left
+	if (cmd_args->profile_generate) {
+		bfc_report_begin(report, "instrument", bfc_driver_report_ir(driver), "instrs");
+		err = bfc_profile_instrument(
+			&driver->profile, &driver->root_block, program,
+			bfc_get_profile_path(cmd_args, cmd_args->profile_generate, driver->profile_path, sizeof(driver->profile_path)),
+			driver->arena
+		);
+		bfc_report_end(report, bfc_driver_report_ir(driver), "instrs");
+		if (err.code != ERR_OK) return err;
+
+		driver->runtime.profile = driver->profile;
+	}
+
+	return BFC_ERR_OK;
+}
+
+bfc_error_t bfc_driver_executable(bfc_driver_t *const driver, const bfc_args_t *const cmd_args, bfc_asm_t **asm_prog, char **image, size_t *length) {
+
+	bfc_report_t *const report = &driver->report;
+
+	bfc_report_begin(report, "codegen", bfc_driver_report_ir(driver), "instrs");
+	bfc_error_t err = bfc_codegen_binary(asm_prog, driver->root_block, driver->snapshot, driver->program, cmd_args->target, driver->runtime);
+	bfc_report_end(report, *asm_prog ? (*asm_prog)->length : 0, "bytes");
+	if (err.code != ERR_OK) return err;
+
+	bfc_report_begin(report, "elf", (*asm_prog)->length, "bytes");
+	err = bfc_elf_create(image, length, *asm_prog);
+	bfc_report_end(report, *length, "bytes");
+
+	return err;
+}
+
+void bfc_driver_destroy(bfc_driver_t *const driver) {
+
+	if (driver->program)    bfc_program_destroy(&driver->program);
+	if (driver->tok_stream) bfc_token_stream_destroy(&driver->tok_stream);
+	if (driver->jump_table) bfc_jump_table_destroy(&driver->jump_table);
+	if (driver->arena)      bfc_arena_destroy(&driver->arena);
+
+	driver->report.arena = NULL;
+	driver->root_block = NULL;
+	driver->snapshot = NULL;
+}
@@ -0,0 +1,73 @@
+#include "bfc_elf.h"
+
+#include <elf.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Image layout, all in one file-backed read+exec segment:
+ *
+ *   ELF header | program headers | program code | program data
+ *
+ * The program is freestanding machine code starting at its first byte; it
+ * maps its own tape at start-up, so nothing but the code needs loading.
+ */
+
+#define BFC_ELF_BASE_ADDRESS 0x400000
+#define BFC_ELF_PAGE_SIZE    0x1000
+#define BFC_ELF_PHDR_COUNT   2
+
+#define BFC_ELF_CODE_OFFSET  (sizeof(Elf64_Ehdr) + BFC_ELF_PHDR_COUNT * sizeof(Elf64_Phdr))
+
+bfc_error_t bfc_elf_create(char **image, size_t *length, const bfc_asm_t *const asm_prog) {
+
+	*image = NULL;
+	*length = 0;
+
+	if (asm_prog->arch != ARCH_X86_64 || asm_prog->format != ASM_FMT_EXEC) 
+		return bfc_make_error(ERR_INTERNAL, "Executables can only be written for x86_64 machine code!");
+
+	const size_t file_size = BFC_ELF_CODE_OFFSET + asm_prog->length;
+
+	char *buffer = (char*) calloc(file_size, sizeof(char));
+	if (!buffer) return BFC_ERR_ALLOC;
+
+	Elf64_Ehdr ehdr = {
+		.e_ident     = { ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS64, ELFDATA2LSB, EV_CURRENT, ELFOSABI_SYSV },
+		.e_type      = ET_EXEC,
+		.e_machine   = EM_X86_64,
+		.e_version   = EV_CURRENT,
+		.e_entry     = BFC_ELF_BASE_ADDRESS + BFC_ELF_CODE_OFFSET,
+		.e_phoff     = sizeof(Elf64_Ehdr),
+		.e_ehsize    = sizeof(Elf64_Ehdr),
+		.e_phentsize = sizeof(Elf64_Phdr),
+		.e_phnum     = BFC_ELF_PHDR_COUNT,
+	};
+
+	const Elf64_Phdr phdrs[BFC_ELF_PHDR_COUNT] = {
+		{
+			.p_type   = PT_LOAD,
+			.p_flags  = PF_R | PF_X,
+			.p_offset = 0,
+			.p_vaddr  = BFC_ELF_BASE_ADDRESS,
+			.p_paddr  = BFC_ELF_BASE_ADDRESS,
+			.p_filesz = file_size,
+			.p_memsz  = file_size,
+			.p_align  = BFC_ELF_PAGE_SIZE,
+		},
+		{
+			.p_type   = PT_GNU_STACK,
+			.p_flags  = PF_R | PF_W,
+		},
+	};
+
+	memcpy(buffer, &ehdr, sizeof(ehdr));
+	memcpy(buffer + sizeof(ehdr), phdrs, sizeof(phdrs));
+	memcpy(buffer + BFC_ELF_CODE_OFFSET, asm_prog->buffer, asm_prog->length);
+
+	*image = buffer;
+	*length = file_size;
+
+	return BFC_ERR_OK;
+}
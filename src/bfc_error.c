@@ -49,27 +49,39 @@ const char *bfc_get_error_code(const bfc_err_code_t error_code) {
 		case ERR_MISSING_BRACKET: {
 			return "ERROR_MISSING_BRACKET";
 		} break;
+		case ERR_INTERNAL: {
+			return "ERROR_INTERNAL";
+		} break;
+		case ERR_RUNTIME: {
+			return "ERROR_RUNTIME";
+		} break;
 		default: {
 			return "Unknown error";
 		} break;
 	}
 }
 
-void bfc_log_error(const bfc_error_t err, const struct bfc_program_t *const program) {
+void bfc_log_error(const bfc_error_t err, const struct bfc_program_t *const program, FILE *out) {
+
+	size_t line = 0;
+	size_t col = 0;
 
-	if (err.code == ERR_MISSING_BRACKET || err.code == ERR_MISMATCHED_BRACKET) {
+	if (
+		(err.code == ERR_MISSING_BRACKET || err.code == ERR_MISMATCHED_BRACKET) && 
+		bfc_program_locate((bfc_program_t*) program, err.token.offset, &line, &col)
+	) {
 		fprintf(
-			stderr, COL_INFO "%s[%lu, %lu]: " COL_ERROR "%s" COL_OFF COL_INFO ": %s\n" COL_OFF, 
-			bfc_program_getname((bfc_program_t*) program), err.token.line, err.token.col, bfc_get_error_code(err.code), err.msg
+			out, COL_INFO "%s[%lu, %lu]: " COL_ERROR "%s" COL_OFF COL_INFO ": %s at line %lu.\n" COL_OFF, 
+			bfc_program_getname((bfc_program_t*) program), line, col, bfc_get_error_code(err.code), err.msg, line
 		);
 
 	
-		char *line_buf = bfc_program_getline((bfc_program_t*) program, (size_t)err.token.line);
+		char *line_buf = bfc_program_getline((bfc_program_t*) program, line);
 
-		int line_num_width = (err.token.line > 0) ? (int)log10(err.token.line) + 1 : 1;
+		int line_num_width = (line > 0) ? (int)log10(line) + 1 : 1;
 
-		fprintf(stderr, "   %lu | %s\n", (size_t) err.token.line, line_buf);
-		fprintf(stderr, "   %*s | %*c\n", line_num_width, "", (int)err.token.col, '^');
+		fprintf(out, "   %lu | %s\n", line, line_buf ? line_buf : "");
+		fprintf(out, "   %*s | %*c\n", line_num_width, "", (int)col, '^');
 		
 		free(line_buf);
 
@@ -77,7 +89,7 @@ void bfc_log_error(const bfc_error_t err, const struct bfc_program_t *const prog
 	}
 
 	fprintf(
-		stderr, COL_INFO "bfc: " COL_ERROR "%s" COL_OFF COL_INFO ": %s\n" COL_OFF, 
+		out, COL_INFO "bfc: " COL_ERROR "%s" COL_OFF COL_INFO ": %s\n" COL_OFF, 
 		bfc_get_error_code(err.code), err.msg
 	);
 }
@@ -0,0 +1,246 @@
+#include "bfc_eval.h"
+
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Compile-time evaluation of the top-level instructions that run before
+ * the first read. An instruction (a whole loop included) is only taken
+ * into the snapshot if it completes without reading input, leaving the
+ * tape or exceeding the step budget; otherwise its effects are undone and
+ * the program resumes with it at run time. Only the start of large tapes
+ * is simulated; leaving it counts as leaving the tape.
+ */
+
+#define BFC_EVAL_TAPE_BYTES (1024 * 1024)
+
+typedef enum {
+	EVAL_DONE,
+	EVAL_STOP,
+	EVAL_ALLOC,
+} bfc_eval_status_t;
+
+typedef struct {
+	uint8_t *tape;
+	ssize_t ptr;
+
+	size_t tape_bytes;
+	uint8_t width;
+
+	size_t steps;
+	size_t step_budget;
+
+	uint8_t *output;
+	size_t output_length;
+	size_t output_capacity;
+
+	// cells written by the top-level instruction being evaluated
+	size_t dirty_begin;
+	size_t dirty_end;
+
+	bfc_arena_t *arena;
+} bfc_eval_t;
+
+static uint8_t *bfc_eval_cell(bfc_eval_t *eval, const ssize_t off) {
+
+	ssize_t cell = eval->ptr + off;
+	if (cell < 0 || cell >= (ssize_t) (eval->tape_bytes / eval->width)) return NULL;
+
+	return &eval->tape[(size_t) cell * eval->width];
+}
+
+static uint8_t *bfc_eval_store(bfc_eval_t *eval, const ssize_t off) {
+
+	uint8_t *cell = bfc_eval_cell(eval, off);
+	if (!cell) return NULL;
+
+	size_t index = (size_t) (cell - eval->tape);
+	if (index < eval->dirty_begin) eval->dirty_begin = index;
+	if (index + eval->width > eval->dirty_end) eval->dirty_end = index + eval->width;
+
+	return cell;
+}
+
+static uint32_t bfc_eval_load(const bfc_eval_t *eval, const uint8_t *cell) {
+
+	uint32_t value = 0;
+	for (uint8_t i = eval->width; i-- > 0;) value = (value << 8) | cell[i];
+
+	return value;
+}
+
+static void bfc_eval_write(const bfc_eval_t *eval, uint8_t *cell, const uint32_t value) {
+
+	for (uint8_t i = 0; i < eval->width; ++i) cell[i] = (uint8_t) (value >> (8 * i));
+}
+
+static bfc_eval_status_t bfc_eval_put(bfc_eval_t *eval, const uint8_t byte) {
+
+	if (eval->output_length >= eval->output_capacity) {
+		size_t capacity = eval->output_capacity ? eval->output_capacity * 2 : 4096;
+
+		uint8_t *tmp = (uint8_t*) bfc_arena_grow(eval->arena, eval->output, eval->output_capacity, capacity);
+		if (!tmp) return EVAL_ALLOC;
+
+		eval->output = tmp;
+		eval->output_capacity = capacity;
+	}
+
+	eval->output[eval->output_length++] = byte;
+
+	return EVAL_DONE;
+}
+
+static bfc_eval_status_t bfc_eval_instrs(bfc_eval_t *eval, const bfc_ir_instr_t *const instrs, const size_t length) {
+
+	for (size_t i = 0; i < length; ++i) {
+		const bfc_ir_instr_t *instr = &instrs[i];
+		uint8_t *cell = NULL;
+
+		if (++eval->steps > eval->step_budget) return EVAL_STOP;
+
+		switch (instr->op) {
+			case IR_ADD: {
+				if (!(cell = bfc_eval_store(eval, instr->off))) return EVAL_STOP;
+				bfc_eval_write(eval, cell, bfc_eval_load(eval, cell) + (uint32_t) instr->val.imm);
+			} break;
+
+			case IR_SET: {
+				if (!(cell = bfc_eval_store(eval, instr->off))) return EVAL_STOP;
+				bfc_eval_write(eval, cell, (uint32_t) instr->val.imm);
+			} break;
+
+			case IR_MOVE: {
+				eval->ptr += instr->val.imm;
+			} break;
+
+			case IR_PUT: {
+				if (!(cell = bfc_eval_cell(eval, instr->off))) return EVAL_STOP;
+
+				bfc_eval_status_t status = bfc_eval_put(eval, *cell);
+				if (status != EVAL_DONE) return status;
+			} break;
+
+			case IR_GET:
+				return EVAL_STOP;
+
+			case IR_MUL: {
+				uint8_t *src = bfc_eval_cell(eval, instr->off);
+				if (!src || !(cell = bfc_eval_store(eval, instr->off + instr->val.mul.off))) return EVAL_STOP;
+
+				const uint32_t product = bfc_eval_load(eval, src) * (uint32_t) instr->val.mul.factor;
+				bfc_eval_write(eval, cell, bfc_eval_load(eval, cell) + product);
+			} break;
+
+			case IR_SCAN: {
+				for (;;) {
+					if (!(cell = bfc_eval_cell(eval, 0))) return EVAL_STOP;
+					if (bfc_eval_load(eval, cell) == 0) break;
+					if (++eval->steps > eval->step_budget) return EVAL_STOP;
+
+					eval->ptr += instr->val.imm;
+				}
+			} break;
+
+			case IR_LOOP: {
+				const bfc_ir_block_t *body = (const bfc_ir_block_t*) instr->val.body;
+
+				for (;;) {
+					if (!(cell = bfc_eval_cell(eval, 0))) return EVAL_STOP;
+					if (bfc_eval_load(eval, cell) == 0) break;
+					if (++eval->steps > eval->step_budget) return EVAL_STOP;
+
+					bfc_eval_status_t status = bfc_eval_instrs(eval, body->instr, body->length);
+					if (status != EVAL_DONE) return status;
+				}
+			} break;
+
+			case IR_LOOP_END:
+			case IR_COUNT:
+				break;
+		}
+	}
+
+	return EVAL_DONE;
+}
+
+bfc_error_t bfc_eval_prefix(bfc_snapshot_t **snapshot, bfc_ir_block_t **ir_block, const size_t step_budget, const size_t tape_bytes, const uint8_t cell_width, bfc_arena_t *const arena) {
+
+	bfc_error_t err = BFC_ERR_ALLOC;
+	bfc_ir_block_t *block = *ir_block;
+	*snapshot = NULL;
+
+	bfc_eval_t eval = {
+		.ptr = 0,
+		.tape_bytes = tape_bytes < BFC_EVAL_TAPE_BYTES ? tape_bytes : BFC_EVAL_TAPE_BYTES,
+		.width = cell_width,
+		.steps = 0,
+		.step_budget = step_budget,
+		.arena = arena,
+	};
+
+	bfc_snapshot_t *snap = (bfc_snapshot_t*) bfc_arena_alloc(arena, sizeof(bfc_snapshot_t));
+	if (!snap) goto end;
+
+	// the snapshot keeps the committed tape, `eval` works on a scratch copy
+	snap->tape = (uint8_t*) bfc_arena_alloc(arena, eval.tape_bytes);
+	if (!snap->tape) goto end;
+
+	memset(snap->tape, 0, eval.tape_bytes);
+	snap->tape_begin = eval.tape_bytes;
+	snap->tape_end = 0;
+
+	eval.tape = (uint8_t*) calloc(eval.tape_bytes, sizeof(uint8_t));
+	if (!eval.tape) goto end;
+
+	size_t resume = 0;
+	while (resume < block->length) {
+		ssize_t ptr = eval.ptr;
+		size_t output_length = eval.output_length;
+
+		eval.dirty_begin = eval.tape_bytes;
+		eval.dirty_end = 0;
+
+		bfc_eval_status_t status = bfc_eval_instrs(&eval, &block->instr[resume], 1);
+		if (status == EVAL_ALLOC) goto end;
+
+		size_t dirty = eval.dirty_end > eval.dirty_begin ? eval.dirty_end - eval.dirty_begin : 0;
+
+		if (status == EVAL_STOP) {
+			memcpy(eval.tape + eval.dirty_begin, snap->tape + eval.dirty_begin, dirty);
+			eval.ptr = ptr;
+			eval.output_length = output_length;
+
+			break;
+		}
+
+		memcpy(snap->tape + eval.dirty_begin, eval.tape + eval.dirty_begin, dirty);
+
+		if (dirty > 0) {
+			if (eval.dirty_begin < snap->tape_begin) snap->tape_begin = eval.dirty_begin;
+			if (eval.dirty_end > snap->tape_end) snap->tape_end = eval.dirty_end;
+		}
+
+		++resume;
+	}
+
+	if (snap->tape_end == 0) snap->tape_begin = 0;
+
+	snap->output = eval.output;
+	snap->output_length = eval.output_length;
+	snap->ptr = eval.ptr;
+
+	// the rest of the program picks up right after the evaluated prefix
+	block->instr += resume;
+	block->length -= resume;
+	block->capacity -= resume;
+
+	*snapshot = snap;
+	err = BFC_ERR_OK;
+
+end:
+	free(eval.tape);
+
+	return err;
+}
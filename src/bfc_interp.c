@@ -0,0 +1,329 @@
+#include "bfc_interp.h"
+
+#include "bfc_codegen.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Portable execution engine for hosts without a native backend, and the
+ * reference semantics the native engines are checked against.
+ *
+ * It runs the flat IR: loop ops already carry the index of their partner,
+ * so dispatch never touches `val.body`. With GNU C the ops are
+ * direct-threaded (each op stores the address of its handler), otherwise a
+ * plain switch loop is used.
+ */
+
+typedef enum {
+	OP_ADD,
+	OP_MOVE,
+	OP_PUT,
+	OP_GET,
+	OP_SET,
+	OP_MUL,
+	OP_SCAN,
+	OP_COUNT,
+	OP_JZ,
+	OP_JNZ,
+	OP_END,
+} bfc_interp_opcode_t;
+
+typedef struct {
+	const void *handler;
+	bfc_interp_opcode_t op;
+	int32_t off;
+	int32_t imm;
+	int32_t dst;
+	uint32_t src;
+} bfc_interp_op_t;
+
+typedef struct {
+	bfc_interp_op_t *ops;
+	size_t length;
+} bfc_interp_code_t;
+
+static void bfc_interp_translate(bfc_interp_code_t *code, const bfc_ir_code_t *const ir_code) {
+
+	for (size_t i = 0; i < ir_code->length; ++i) {
+		const bfc_ir_flat_instr_t instr = ir_code->instr[i];
+		bfc_interp_op_t *op = &code->ops[code->length++];
+
+		switch (instr.op) {
+			case IR_ADD:      *op = (bfc_interp_op_t) { .op = OP_ADD,  .off = instr.off, .imm = instr.imm, .src = instr.src }; break;
+			case IR_MOVE:     *op = (bfc_interp_op_t) { .op = OP_MOVE, .imm = instr.imm, .src = instr.src }; break;
+			case IR_PUT:      *op = (bfc_interp_op_t) { .op = OP_PUT,  .off = instr.off, .src = instr.src }; break;
+			case IR_GET:      *op = (bfc_interp_op_t) { .op = OP_GET,  .off = instr.off, .src = instr.src }; break;
+			case IR_SET:      *op = (bfc_interp_op_t) { .op = OP_SET,  .off = instr.off, .imm = instr.imm, .src = instr.src }; break;
+			case IR_MUL:      *op = (bfc_interp_op_t) { .op = OP_MUL,  .off = instr.off, .imm = instr.imm, .dst = instr.dst, .src = instr.src }; break;
+			case IR_SCAN:     *op = (bfc_interp_op_t) { .op = OP_SCAN, .imm = instr.imm, .src = instr.src }; break;
+			case IR_COUNT:    *op = (bfc_interp_op_t) { .op = OP_COUNT, .imm = instr.imm, .src = instr.src }; break;
+
+			// both jumps land on the op after their partner
+			case IR_LOOP:     *op = (bfc_interp_op_t) { .op = OP_JZ,   .imm = instr.imm + 1, .src = instr.src }; break;
+			case IR_LOOP_END: *op = (bfc_interp_op_t) { .op = OP_JNZ,  .imm = instr.imm + 1, .src = instr.src }; break;
+		}
+	}
+
+	code->ops[code->length++] = (bfc_interp_op_t) { .op = OP_END };
+}
+
+// the cell the scan stops on, or -1 if it reads past either end of the tape first
+static ssize_t bfc_interp_scan(ssize_t pos, const ssize_t stride, const uint32_t *const tape, const size_t cells) {
+
+	while ((size_t) pos < cells) {
+		if (tape[pos] == 0) return pos;
+
+		pos += stride;
+	}
+
+	return -1;
+}
+
+/*
+ * The tape pointer is kept as an index, `pos`, which moves freely; like the
+ * guard pages of the native engines, only touching a cell outside the tape
+ * is an error.
+ */
+#define BFC_INTERP_CELL(off) ((size_t) (pos + (off)) < cells)
+
+/*
+ * Cells are kept 32 bits wide and reduced to the configured width with
+ * `mask` whenever they are written. `eof` is what a read stores at end of
+ * input, or -1 to leave the cell alone. `counters` is only touched by
+ * the OP_COUNTs of a profiling build. On a tape overflow `fault` is left
+ * on the op that touched the cell.
+ */
+static bfc_error_t bfc_interp_exec(bfc_interp_code_t *code, uint32_t *tape, const size_t cells, ssize_t pos, const uint32_t mask, const int64_t eof, uint64_t *counters, FILE *in, FILE *out, const bfc_interp_op_t **fault) {
+
+	const bfc_interp_op_t *ip = code->ops;
+	const bfc_interp_op_t *const base = code->ops;
+
+#if defined(__GNUC__) && !defined(BFC_INTERP_NO_THREADING)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+	static const void *const handlers[] = {
+		[OP_ADD]   = &&op_add,
+		[OP_MOVE]  = &&op_move,
+		[OP_PUT]   = &&op_put,
+		[OP_GET]   = &&op_get,
+		[OP_SET]   = &&op_set,
+		[OP_MUL]   = &&op_mul,
+		[OP_SCAN]  = &&op_scan,
+		[OP_COUNT] = &&op_count,
+		[OP_JZ]    = &&op_jz,
+		[OP_JNZ]   = &&op_jnz,
+		[OP_END]   = &&op_end,
+	};
+
+	for (size_t i = 0; i < code->length; ++i) code->ops[i].handler = handlers[code->ops[i].op];
+
+#define DISPATCH() goto *ip->handler
+#define NEXT()     do { ++ip; DISPATCH(); } while (0)
+
+	DISPATCH();
+
+op_add:
+	if (!BFC_INTERP_CELL(ip->off)) goto out_of_bounds;
+	tape[pos + ip->off] = (tape[pos + ip->off] + (uint32_t) ip->imm) & mask;
+	NEXT();
+
+op_move:
+	pos += ip->imm;
+	NEXT();
+
+op_put:
+	if (!BFC_INTERP_CELL(ip->off)) goto out_of_bounds;
+	putc((uint8_t) tape[pos + ip->off], out);
+	NEXT();
+
+op_get: {
+		if (!BFC_INTERP_CELL(ip->off)) goto out_of_bounds;
+		int64_t c = getc(in);
+		if (c == EOF) c = eof;
+		if (c >= 0) tape[pos + ip->off] = (uint32_t) c;
+	}
+	NEXT();
+
+op_set:
+	if (!BFC_INTERP_CELL(ip->off)) goto out_of_bounds;
+	tape[pos + ip->off] = (uint32_t) ip->imm & mask;
+	NEXT();
+
+op_mul:
+	if (!BFC_INTERP_CELL(ip->off) || !BFC_INTERP_CELL(ip->dst)) goto out_of_bounds;
+	tape[pos + ip->dst] = (tape[pos + ip->dst] + tape[pos + ip->off] * (uint32_t) ip->imm) & mask;
+	NEXT();
+
+op_scan:
+	pos = bfc_interp_scan(pos, ip->imm, tape, cells);
+	if (pos < 0) goto out_of_bounds;
+	NEXT();
+
+op_count:
+	++counters[ip->imm];
+	NEXT();
+
+op_jz:
+	if (!BFC_INTERP_CELL(0)) goto out_of_bounds;
+	if (tape[pos] == 0) {
+		ip = base + ip->imm;
+		DISPATCH();
+	}
+	NEXT();
+
+op_jnz:
+	if (!BFC_INTERP_CELL(0)) goto out_of_bounds;
+	if (tape[pos] != 0) {
+		ip = base + ip->imm;
+		DISPATCH();
+	}
+	NEXT();
+
+op_end:
+	return BFC_ERR_OK;
+
+#undef NEXT
+#undef DISPATCH
+
+#pragma GCC diagnostic pop
+#else
+	for (;;) {
+		switch (ip->op) {
+			case OP_ADD: {
+				if (!BFC_INTERP_CELL(ip->off)) goto out_of_bounds;
+				tape[pos + ip->off] = (tape[pos + ip->off] + (uint32_t) ip->imm) & mask;
+			} break;
+
+			case OP_MOVE: {
+				pos += ip->imm;
+			} break;
+
+			case OP_PUT: {
+				if (!BFC_INTERP_CELL(ip->off)) goto out_of_bounds;
+				putc((uint8_t) tape[pos + ip->off], out);
+			} break;
+
+			case OP_GET: {
+				if (!BFC_INTERP_CELL(ip->off)) goto out_of_bounds;
+				int64_t c = getc(in);
+				if (c == EOF) c = eof;
+				if (c >= 0) tape[pos + ip->off] = (uint32_t) c;
+			} break;
+
+			case OP_SET: {
+				if (!BFC_INTERP_CELL(ip->off)) goto out_of_bounds;
+				tape[pos + ip->off] = (uint32_t) ip->imm & mask;
+			} break;
+
+			case OP_MUL: {
+				if (!BFC_INTERP_CELL(ip->off) || !BFC_INTERP_CELL(ip->dst)) goto out_of_bounds;
+				tape[pos + ip->dst] = (tape[pos + ip->dst] + tape[pos + ip->off] * (uint32_t) ip->imm) & mask;
+			} break;
+
+			case OP_SCAN: {
+				pos = bfc_interp_scan(pos, ip->imm, tape, cells);
+				if (pos < 0) goto out_of_bounds;
+			} break;
+
+			case OP_COUNT: {
+				++counters[ip->imm];
+			} break;
+
+			case OP_JZ: {
+				if (!BFC_INTERP_CELL(0)) goto out_of_bounds;
+				if (tape[pos] == 0) {
+					ip = base + ip->imm;
+					continue;
+				}
+			} break;
+
+			case OP_JNZ: {
+				if (!BFC_INTERP_CELL(0)) goto out_of_bounds;
+				if (tape[pos] != 0) {
+					ip = base + ip->imm;
+					continue;
+				}
+			} break;
+
+			case OP_END: {
+				return BFC_ERR_OK;
+			} break;
+		}
+
+		++ip;
+	}
+#endif
+
+out_of_bounds:
+	*fault = ip;
+
+	return bfc_make_error(ERR_RUNTIME, "tape overflow");
+}
+
+#undef BFC_INTERP_CELL
+
+bfc_error_t bfc_interp_run(const bfc_ir_code_t *const ir_code, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_runtime_opts_t opts, FILE *in, FILE *out) {
+
+	bfc_error_t err = BFC_ERR_ALLOC;
+
+	uint32_t *tape = NULL;
+	uint64_t *counters = NULL;
+	bfc_interp_code_t code = {0};
+
+	code.ops = (bfc_interp_op_t*) malloc((ir_code->length + 1) * sizeof(bfc_interp_op_t));
+	if (!code.ops) goto end;
+
+	bfc_interp_translate(&code, ir_code);
+
+	const uint8_t width = opts.cell_width;
+	const uint32_t mask = BFC_CELL_MASK(width);
+
+	// exactly the cells asked for; the native engines can only catch overflow at their guard pages
+	const size_t cells = opts.tape_size;
+
+	tape = (uint32_t*) calloc(cells, sizeof(uint32_t));
+	if (!tape) goto end;
+
+	if (opts.profile) {
+		counters = (uint64_t*) calloc(bfc_profile_counter_count(opts.profile) + 1, sizeof(uint64_t));
+		if (!counters) goto end;
+	}
+
+	ssize_t pos = 0;
+
+	if (snapshot) {
+		fwrite(snapshot->output, sizeof(uint8_t), snapshot->output_length, out);
+
+		for (size_t i = snapshot->tape_begin; i < snapshot->tape_end; ++i) 
+			tape[i / width] |= (uint32_t) snapshot->tape[i] << (8 * (i % width));
+
+		pos = snapshot->ptr;
+	}
+
+	int64_t eof = -1;
+	if (opts.eof == EOF_ZERO) eof = 0;
+	if (opts.eof == EOF_MINUS_ONE) eof = mask;
+
+	const bfc_interp_op_t *fault = NULL;
+	err = bfc_interp_exec(&code, tape, cells, pos, mask, eof, counters, in, out, &fault);
+
+	fflush(out);
+
+	// the same diagnostic the native engines print from their fault handlers
+	size_t line = 0;
+	size_t col = 0;
+
+	if (fault && program && bfc_program_locate(program, fault->src, &line, &col)) 
+		snprintf(err.msg, sizeof(err.msg), "tape overflow at %zu:%zu", line, col);
+
+	if (err.code == ERR_OK && opts.profile) err = bfc_profile_write(opts.profile, counters);
+
+end:
+	free(tape);
+	free(counters);
+	free(code.ops);
+
+	return err;
+}
@@ -1,161 +1,298 @@
 #include "bfc_io.h"
 
-#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-bfc_error_t bfc_program_create(bfc_program_t **program, const char *file_path) {
+#define BFC_IO_READ_CHUNK (64 * 1024)
 
-	FILE *file_handle;
+static bfc_error_t bfc_program_read_stream(bfc_program_t *const prog, const int fd) {
 
-	if((file_handle = fopen(file_path, "rb"))) {
-		bfc_program_t *prog = (bfc_program_t*) malloc(sizeof(bfc_program_t));
-		if (!prog) {
-			fclose(file_handle);
+	size_t capacity = 0;
+	char *buffer = NULL;
 
-			return BFC_ERR_ALLOC;
-		}
+	for (;;) {
+		if (prog->file_size == capacity) {
+			capacity = capacity ? 2 * capacity : BFC_IO_READ_CHUNK;
+
+			char *tmp = (char*) realloc(buffer, capacity);
+			if (!tmp) {
+				free(buffer);
 
-		int seek_status = fseek(file_handle, 0, SEEK_END);
-		if (seek_status != 0) {
-			free(prog);
-			fclose(file_handle);
+				return BFC_ERR_ALLOC;
+			}
 
-			return bfc_make_error(ERR_IO, "Unable to seek the end of file!");
+			buffer = tmp;
 		}
 
-		long file_size = ftell(file_handle);
-		if (file_size == -1L) {
-			free(prog);
-			fclose(file_handle);
+		ssize_t count = read(fd, buffer + prog->file_size, capacity - prog->file_size);
+		if (count == 0) break;
 
-			return bfc_make_error(ERR_IO, "Unable to perform ftell on file!");
-		}
+		if (count < 0) {
+			if (errno == EINTR) continue;
 
-		seek_status = fseek(file_handle, 0, SEEK_SET);
-		if (seek_status != 0) {
-			free(prog);
-			fclose(file_handle);
+			free(buffer);
 
-			return bfc_make_error(ERR_IO, "Unable to seek the start of file!");
-		}
-		
-		if (file_size < 0 || file_size > (LONG_MAX - 1)) {
-			free(prog);
-			fclose(file_handle);
+			char err_str[512];
+			snprintf(err_str, sizeof(err_str), "Unable to read from file '%s'!", prog->path);
 
-			return bfc_make_error(ERR_IO, "Invalid file size!");
+			return bfc_make_error(ERR_IO, err_str);
 		}
 
-		prog->buffer = (char*) malloc((file_size + 1) * sizeof(char));
-		if (!prog->buffer) {
-			free(prog);
-			fclose(file_handle);
+		prog->file_size += (size_t) count;
+	}
 
-			return BFC_ERR_ALLOC;
-		}
+	prog->buffer = buffer;
+
+	return BFC_ERR_OK;
+}
 
-		prog->file_size = file_size;
+bfc_error_t bfc_program_create(bfc_program_t **program, const char *file_path) {
 
-		prog->path = malloc(strlen(file_path) + 1);
-		if (!prog->path) { 
-			free(prog->buffer); 
-			free(prog); 
-			fclose(file_handle); 
+	bfc_error_t err = BFC_ERR_ALLOC;
+	char err_str[512];
 
-			return BFC_ERR_ALLOC; 
-		}
+	*program = NULL;
 
-		strcpy(prog->path, file_path);
+	const int is_stdin = strcmp(file_path, "-") == 0;
+	int fd = is_stdin ? STDIN_FILENO : -1;
 
-		size_t end = fread(prog->buffer, sizeof(char), prog->file_size, file_handle);
-		if (ferror(file_handle) != 0 || end != (size_t) prog->file_size) {
-			free(prog->path);
-			free(prog->buffer);
-			free(prog);
-			fclose(file_handle);
+	bfc_program_t *prog = (bfc_program_t*) calloc(1, sizeof(bfc_program_t));
+	if (!prog) goto end;
 
-			char err_str[512];
-			snprintf(err_str, sizeof(err_str), "Unable to read from file '%s'!", file_path);
+	prog->path = strdup(is_stdin ? "<stdin>" : file_path);
+	if (!prog->path) goto end;
 
-			return bfc_make_error(ERR_IO, err_str);
+	if (!is_stdin) {
+		fd = open(file_path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			if (errno == ENOENT) {
+				snprintf(err_str, sizeof(err_str), "No such file or directory: '%s'", file_path);
+			} else {
+				snprintf(err_str, sizeof(err_str), "Unable to open file '%s'!", file_path);
+			}
+
+			err = bfc_make_error(ERR_IO, err_str);
+			goto end;
 		}
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		snprintf(err_str, sizeof(err_str), "Unable to stat file '%s'!", prog->path);
 
-		prog->buffer[end] = '\0';
+		err = bfc_make_error(ERR_IO, err_str);
+		goto end;
+	}
 
-		fclose(file_handle);
+	// regular files are mapped as they are; pipes, terminals and the like are read to the end
+	if (S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-		prog->line_count = 0;
-		size_t i = 0;
-		while (prog->buffer[i] != '\0') {
-			if (prog->buffer[i] == '\n') ++prog->line_count;
-			++i;
+		if (map != MAP_FAILED) {
+			madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+			prog->buffer = (const char*) map;
+			prog->file_size = (size_t) st.st_size;
+			prog->is_mapped = 1;
 		}
-		
-		*program = prog;
-		return BFC_ERR_OK;
 	}
 
+	if (!prog->is_mapped) {
+		err = bfc_program_read_stream(prog, fd);
+		if (err.code != ERR_OK) goto end;
+	}
 
-	char err_str[512];
-	snprintf(err_str, sizeof(err_str), "No such file or directory: '%s'", file_path);
-	return bfc_make_error(ERR_IO, err_str);
+	*program = prog;
+	prog = NULL;
+
+	err = BFC_ERR_OK;
+
+end:
+	if (fd >= 0 && !is_stdin) close(fd);
+	bfc_program_destroy(&prog);
+
+	return err;
 }
 
 void bfc_program_destroy(bfc_program_t **pprogram) {
 
 	if (!pprogram || !*pprogram) return;
 
-	free((*pprogram)->path);
-	free((*pprogram)->buffer);
-	free(*pprogram);
+	bfc_program_t *prog = *pprogram;
+
+	if (prog->is_mapped) {
+		munmap((void*) prog->buffer, prog->file_size);
+	} else {
+		free((void*) prog->buffer);
+	}
+
+	free(prog->line_starts);
+	free(prog->path);
+	free(prog);
 
 	*pprogram = NULL;
 }
 
 const char *bfc_program_getname(const bfc_program_t *const program) {
 
-	const char *start = program->path;
-	const char *end = program->path;
-	while (end != NULL) {
-		end = strchr(start, '/');
-	}
+	const char *slash = strrchr(program->path, '/');
 
-	return start;
+	return slash ? slash + 1 : program->path;
 }
 
-char *bfc_program_getline(const bfc_program_t *const program, const size_t n) {
+// the line index is only needed for diagnostics, so it is built on first use
+static int bfc_program_index_lines(bfc_program_t *const program) {
+
+	if (program->line_starts) return 1;
 
-	if (n > program->line_count) return NULL;
+	size_t capacity = 64;
+	size_t *starts = (size_t*) malloc(capacity * sizeof(size_t));
+	if (!starts) return 0;
 
-	size_t current_line = 1;
-	const char *start = program->buffer;
-	const char *end = program->buffer;
+	size_t count = 0;
+	starts[count++] = 0;
 
-	while (current_line < n) {
-		end = strchr(start, '\n');
-		if (end == NULL) return NULL;
+	const char *pos = program->buffer;
+	const char *const end = program->buffer + program->file_size;
 
-		start = end + 1;
-		++current_line;
+	while (pos < end && (pos = memchr(pos, '\n', (size_t) (end - pos))) != NULL) {
+		++pos;
+
+		if (count == capacity) {
+			capacity *= 2;
+
+			size_t *tmp = (size_t*) realloc(starts, capacity * sizeof(size_t));
+			if (!tmp) {
+				free(starts);
+
+				return 0;
+			}
+
+			starts = tmp;
+		}
+
+		starts[count++] = (size_t) (pos - program->buffer);
 	}
 
-	end = strchr(start, '\n');
+	program->line_starts = starts;
+	program->line_count = count;
 
-	size_t line_len;
-	if (end == NULL) {
-        	line_len = strlen(start);
-	} else {
-		line_len = end - start;
+	return 1;
+}
+
+int bfc_program_locate(bfc_program_t *const program, const size_t offset, size_t *const line, size_t *const col) {
+
+	if (offset > program->file_size || !bfc_program_index_lines(program)) return 0;
+
+	// last line starting at or before offset
+	size_t lo = 0;
+	size_t hi = program->line_count;
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (program->line_starts[mid] <= offset) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
 	}
 
+	*line = lo + 1;
+	*col = offset - program->line_starts[lo] + 1;
+
+	return 1;
+}
+
+char *bfc_program_getline(bfc_program_t *const program, const size_t n) {
+
+	if (n == 0 || !bfc_program_index_lines(program) || n > program->line_count) return NULL;
+
+	const char *start = program->buffer + program->line_starts[n - 1];
+	const char *end = program->buffer + ((n < program->line_count) ? program->line_starts[n] - 1 : program->file_size);
+
+	size_t line_len = (size_t) (end - start);
 	if (line_len > 4096) return NULL;
 
-	char *line_buf = (char*) malloc(4096 * sizeof(char));
+	char *line_buf = (char*) malloc((line_len + 1) * sizeof(char));
+	if (!line_buf) return NULL;
 
-	strncpy(line_buf, start, line_len);
+	memcpy(line_buf, start, line_len);
 	line_buf[line_len] = '\0';
 
 	return line_buf;
 }
+
+static bfc_error_t bfc_write_handle(FILE *file_handle, const char *file_path, const char *buffer, const size_t length) {
+
+	char err_str[512];
+
+	size_t written = fwrite(buffer, sizeof(char), length, file_handle);
+	int close_status = fclose(file_handle);
+
+	if (written != length || close_status != 0) {
+		snprintf(err_str, sizeof(err_str), "Unable to write to file '%s'!", file_path);
+
+		return bfc_make_error(ERR_IO, err_str);
+	}
+
+	return BFC_ERR_OK;
+}
+
+bfc_error_t bfc_write_file(const char *file_path, const char *buffer, const size_t length) {
+
+	char err_str[512];
+
+	if (strcmp(file_path, "-") == 0) {
+		if (fwrite(buffer, sizeof(char), length, stdout) != length || fflush(stdout) != 0) 
+			return bfc_make_error(ERR_IO, "Unable to write to stdout!");
+
+		return BFC_ERR_OK;
+	}
+
+	FILE *file_handle = fopen(file_path, "wb");
+	if (!file_handle) {
+		snprintf(err_str, sizeof(err_str), "Unable to open output file '%s'!", file_path);
+
+		return bfc_make_error(ERR_IO, err_str);
+	}
+
+	return bfc_write_handle(file_handle, file_path, buffer, length);
+}
+
+bfc_error_t bfc_write_executable(const char *file_path, const char *buffer, const size_t length) {
+
+	char err_str[512];
+
+	if (strcmp(file_path, "-") == 0) return bfc_write_file(file_path, buffer, length);
+
+	// like a linker, replace an ordinary file instead of truncating it so that it gets fresh permissions;
+	// devices, pipes and the like are written through as they are
+	struct stat st;
+	if (lstat(file_path, &st) == 0 && (S_ISREG(st.st_mode) || S_ISLNK(st.st_mode)) 
+		&& unlink(file_path) != 0 && errno != ENOENT) {
+		snprintf(err_str, sizeof(err_str), "Unable to replace output file '%s'!", file_path);
+
+		return bfc_make_error(ERR_IO, err_str);
+	}
+
+	FILE *file_handle = NULL;
+
+	int fd = open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0777);
+	if (fd >= 0) file_handle = fdopen(fd, "wb");
+
+	if (!file_handle) {
+		if (fd >= 0) close(fd);
+
+		snprintf(err_str, sizeof(err_str), "Unable to open output file '%s'!", file_path);
+
+		return bfc_make_error(ERR_IO, err_str);
+	}
+
+	return bfc_write_handle(file_handle, file_path, buffer, length);
+}
@@ -1,5 +1,9 @@
 #include "bfc_ir.h"
 
+#include "bfc_jumptable.h"
+
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 bfc_ir_instr_t bfc_ir_make_imm_instr(const bfc_ir_token_type_t ir_token_type, const ssize_t imm) {
@@ -17,7 +21,29 @@ bfc_ir_instr_t bfc_ir_make_zero_instr(const bfc_ir_token_type_t ir_token_type) {
 	};
 }
 
-bfc_error_t bfc_ir_create(bfc_ir_block_t **root_block, const bfc_token_stream_t *const tok_stream) {
+static bfc_ir_block_t *bfc_ir_make_block(bfc_arena_t *const arena) {
+
+	bfc_ir_block_t *block = (bfc_ir_block_t*) bfc_arena_alloc(arena, sizeof(bfc_ir_block_t));
+	if (!block) return NULL;
+
+	block->capacity = 10;
+	block->length = 0;
+	block->writes = NULL;
+	block->instr = (bfc_ir_instr_t*) bfc_arena_alloc(arena, block->capacity * sizeof(bfc_ir_instr_t));
+	if (!block->instr) return NULL;
+
+	return block;
+}
+
+bfc_ir_instr_t bfc_ir_make_mul_instr(const ssize_t off, const ssize_t factor) {
+
+	return (bfc_ir_instr_t) {
+		.op = IR_MUL,
+		.val = { .mul = { .off = (int32_t) off, .factor = (int32_t) (uint32_t) factor } },
+	};
+}
+
+bfc_error_t bfc_ir_create(bfc_ir_block_t **root_block, const bfc_token_stream_t *const tok_stream, bfc_arena_t *const arena) {
 
 	bfc_error_t err = BFC_ERR_ALLOC;
 	*root_block = NULL;
@@ -30,18 +56,13 @@ bfc_error_t bfc_ir_create(bfc_ir_block_t **root_block, const bfc_token_stream_t
 	stack.blocks = (bfc_ir_block_t**) malloc(stack.capacity * sizeof(bfc_ir_block_t*));
 	if (!stack.blocks) goto end;
 
-	stack.blocks[stack.length] = (bfc_ir_block_t*) malloc(sizeof(bfc_ir_block_t));
+	stack.blocks[stack.length] = bfc_ir_make_block(arena);
 	if (!stack.blocks[stack.length]) goto end;
 
 	bfc_ir_block_t *current_block = stack.blocks[stack.length++];
-	current_block->instr = NULL;
-	current_block->capacity = 10;
-	current_block->length = 0;
-
-	current_block->instr = (bfc_ir_instr_t*) malloc(current_block->capacity * sizeof(bfc_ir_instr_t));
-	if (!current_block->instr) goto end;
 
 	size_t i = 0;
+	uint32_t repeat = 0;
 	while (i < tok_stream->length) {
 		if (stack.length >= stack.capacity) {
 			stack.capacity *= 2;
@@ -57,33 +78,37 @@ bfc_error_t bfc_ir_create(bfc_ir_block_t **root_block, const bfc_token_stream_t
 		}
 
 		if (current_block->length >= current_block->capacity) {
-			current_block->capacity *= 2;
-
-			bfc_ir_instr_t *tmp = (bfc_ir_instr_t*) realloc(
+			bfc_ir_instr_t *tmp = (bfc_ir_instr_t*) bfc_arena_grow(
+				arena,
 				current_block->instr, 
-				current_block->capacity * sizeof(bfc_ir_instr_t)
+				current_block->capacity * sizeof(bfc_ir_instr_t),
+				current_block->capacity * 2 * sizeof(bfc_ir_instr_t)
 			);
 			
 			if (!tmp) goto end;
 
 			current_block->instr = tmp;
+			current_block->capacity *= 2;
 		}
 
-		switch (tok_stream->tokens[i].type) {
+		const bfc_token_type_t type = (bfc_token_type_t) tok_stream->types[i];
+		const ssize_t count = (ssize_t) tok_stream->counts[i];
+
+		switch (type) {
 			case TT_INC: {
-				current_block->instr[current_block->length++] = bfc_ir_make_imm_instr(IR_ADD, 1);
+				current_block->instr[current_block->length++] = bfc_ir_make_imm_instr(IR_ADD, count);
 			} break;
 
 			case TT_DEC: {
-				current_block->instr[current_block->length++] = bfc_ir_make_imm_instr(IR_ADD, -1);
+				current_block->instr[current_block->length++] = bfc_ir_make_imm_instr(IR_ADD, -count);
 			} break;
 
 			case TT_PTR_LEFT: {
-				current_block->instr[current_block->length++] = bfc_ir_make_imm_instr(IR_MOVE, -1);
+				current_block->instr[current_block->length++] = bfc_ir_make_imm_instr(IR_MOVE, -count);
 			} break;
 
 			case TT_PTR_RIGHT: {
-				current_block->instr[current_block->length++] = bfc_ir_make_imm_instr(IR_MOVE, 1);
+				current_block->instr[current_block->length++] = bfc_ir_make_imm_instr(IR_MOVE, count);
 			} break;
 
 			case TT_INPUT: {
@@ -98,25 +123,19 @@ bfc_error_t bfc_ir_create(bfc_ir_block_t **root_block, const bfc_token_stream_t
 				bfc_ir_instr_t loop_instr = (bfc_ir_instr_t) {
 					.op = IR_LOOP,
 					.val = { 
-						.body = (struct bfc_ir_block_t*) malloc(sizeof(bfc_ir_block_t)) 
+						.body = (struct bfc_ir_block_t*) bfc_ir_make_block(arena)
 					},
 				};
 
 				if (!loop_instr.val.body) goto end;
 
+				loop_instr.src = tok_stream->offsets[i];
+
 				current_block->instr[current_block->length++] = loop_instr;
 
 				stack.blocks[stack.length] = (bfc_ir_block_t*) loop_instr.val.body;
 
 				current_block = stack.blocks[stack.length++];
-				current_block->capacity = 10;
-				current_block->length = 0;
-
-				current_block->instr = (bfc_ir_instr_t*) malloc(
-					current_block->capacity * sizeof(bfc_ir_instr_t)
-				);
-
-				if (!current_block->instr) goto end;
 			} break;
 
 			case TT_LOOP_END: {
@@ -125,6 +144,13 @@ bfc_error_t bfc_ir_create(bfc_ir_block_t **root_block, const bfc_token_stream_t
 			} break;
 		}
 
+		if (type != TT_LOOP_START && type != TT_LOOP_END) 
+			current_block->instr[current_block->length - 1].src = tok_stream->offsets[i];
+
+		// I/O runs expand to one instruction per repetition
+		if ((type == TT_INPUT || type == TT_OUTPUT) && ++repeat < tok_stream->counts[i]) continue;
+
+		repeat = 0;
 		++i;
 	}
 
@@ -140,74 +166,1007 @@ end:
 }
 
 bfc_error_t bfc_ir_optimize_rep(bfc_ir_block_t **ir_block) {
-	
-	if ((*ir_block)->length == 0) return BFC_ERR_OK;
 
-	bfc_error_t err = BFC_ERR_ALLOC;
+	bfc_ir_block_t *block = *ir_block;
 
-	bfc_ir_block_t *optimized_block = (bfc_ir_block_t*) malloc(sizeof(bfc_ir_block_t));
-	if (!optimized_block) goto end;
-	optimized_block->instr = NULL;
-	optimized_block->capacity = (*ir_block)->capacity;
-	optimized_block->length = 0;
+	// runs only ever shrink, so the block is compacted in place
+	size_t length = 0;
+	size_t i = 0;
+	while (i < block->length) {
+		bfc_ir_instr_t instr = block->instr[i];
 
-	optimized_block->instr = (bfc_ir_instr_t*) malloc(optimized_block->capacity * sizeof(bfc_ir_instr_t));
-	if (!optimized_block->instr) goto end;
+		if (instr.op == IR_ADD || instr.op == IR_MOVE) {
+			ssize_t instr_delta = 0;
 
-	bfc_ir_instr_t prev_instr = (*ir_block)->instr[0];
-	ssize_t instr_delta = 0;
-	size_t i = 0;
-	while (i < (*ir_block)->length) {
-		if ((*ir_block)->instr[i].op == IR_ADD || (*ir_block)->instr[i].op == IR_MOVE) {
 			do {
-				instr_delta += (*ir_block)->instr[i].val.imm;
-				prev_instr = (*ir_block)->instr[i++];
-			} while(i < (*ir_block)->length && (*ir_block)->instr[i].op == prev_instr.op);
+				instr_delta += block->instr[i++].val.imm;
+			} while (i < block->length && block->instr[i].op == instr.op);
 
-			if (instr_delta != 0)
-				optimized_block->instr[optimized_block->length++] = bfc_ir_make_imm_instr(prev_instr.op, instr_delta);
-			
-			instr_delta = 0;
+			if (instr_delta != 0) {
+				block->instr[length] = bfc_ir_make_imm_instr(instr.op, instr_delta);
+				block->instr[length++].src = instr.src;
+			}
 		} else {
-			if ((*ir_block)->instr[i].op == IR_LOOP) {
-				err = bfc_ir_optimize_rep((bfc_ir_block_t**) &(*ir_block)->instr[i].val.body);
+			if (instr.op == IR_LOOP) {
+				bfc_error_t err = bfc_ir_optimize_rep((bfc_ir_block_t**) &instr.val.body);
 
-				if (err.code != ERR_OK) goto end;
+				if (err.code != ERR_OK) return err;
 			}
 			
-			optimized_block->instr[optimized_block->length++] = (*ir_block)->instr[i];
-			prev_instr = (*ir_block)->instr[i++];
+			block->instr[length++] = instr;
+			++i;
 		}
 	}
-	
-	free((*ir_block)->instr);
-	free(*ir_block);
 
-	*ir_block = optimized_block;
-	optimized_block = NULL; 
+	block->length = length;
 
-	err = BFC_ERR_OK;
+	return BFC_ERR_OK;
+}
 
-end:
-	if (optimized_block) {
-		free(optimized_block->instr);
-		free(optimized_block);
+static uint8_t bfc_ir_is_clear_loop(const bfc_ir_instr_t *const instr) {
+
+	if (instr->op != IR_LOOP) return 0;
+
+	const bfc_ir_block_t *body = (const bfc_ir_block_t*) instr->val.body;
+
+	// an odd step is coprime with the cell modulus, so the cell always reaches zero
+	return body->length == 1 && body->instr[0].op == IR_ADD && body->instr[0].off == 0 && (body->instr[0].val.imm & 1);
+}
+
+bfc_error_t bfc_ir_optimize_clear(bfc_ir_block_t **ir_block) {
+
+	bfc_ir_block_t *block = *ir_block;
+
+	size_t length = 0;
+	for (size_t i = 0; i < block->length; ++i) {
+		bfc_ir_instr_t instr = block->instr[i];
+
+		if (bfc_ir_is_clear_loop(&instr)) {
+			const uint32_t src = instr.src;
+
+			instr = bfc_ir_make_imm_instr(IR_SET, 0);
+			instr.src = src;
+		} else if (instr.op == IR_LOOP) {
+			bfc_error_t err = bfc_ir_optimize_clear((bfc_ir_block_t**) &instr.val.body);
+
+			if (err.code != ERR_OK) return err;
+		}
+
+		bfc_ir_instr_t *prev = length > 0 ? &block->instr[length - 1] : NULL;
+
+		if (prev && prev->op == IR_SET && instr.op == IR_ADD && prev->off == instr.off) {
+			prev->val.imm += instr.val.imm;
+			continue;
+		}
+
+		if (prev && (prev->op == IR_SET || prev->op == IR_ADD) && instr.op == IR_SET && prev->off == instr.off) {
+			*prev = instr;
+			continue;
+		}
+
+		block->instr[length++] = instr;
 	}
 
-	return err;
+	block->length = length;
+
+	return BFC_ERR_OK;
+}
+
+#define BFC_IR_MUL_MAX_TARGETS 32
+
+typedef struct {
+	ssize_t off[BFC_IR_MUL_MAX_TARGETS];
+	ssize_t factor[BFC_IR_MUL_MAX_TARGETS];
+	size_t length;
+} bfc_ir_mul_targets_t;
+
+static uint8_t bfc_ir_analyze_mul_loop(const bfc_ir_instr_t *const instr, bfc_ir_mul_targets_t *targets) {
+
+	if (instr->op != IR_LOOP) return 0;
+
+	const bfc_ir_block_t *body = (const bfc_ir_block_t*) instr->val.body;
+
+	ssize_t ptr = 0;
+	ssize_t step = 0;
+	targets->length = 0;
+
+	for (size_t i = 0; i < body->length; ++i) {
+		const bfc_ir_instr_t *cur = &body->instr[i];
+
+		if (cur->op == IR_MOVE) {
+			ptr += cur->val.imm;
+		} else if (cur->op == IR_ADD) {
+			ssize_t cell = ptr + cur->off;
+
+			if (cell == 0) {
+				step += cur->val.imm;
+				continue;
+			}
+
+			size_t j = 0;
+			while (j < targets->length && targets->off[j] != cell) ++j;
+
+			if (j == targets->length) {
+				if (targets->length >= BFC_IR_MUL_MAX_TARGETS) return 0;
+
+				targets->off[j] = cell;
+				targets->factor[j] = 0;
+				++targets->length;
+			}
+
+			targets->factor[j] += cur->val.imm;
+		} else {
+			return 0;
+		}
+	}
+
+	// the loop has to be balanced and count the cell down (or up) by exactly one
+	if (ptr != 0 || (step != -1 && step != 1)) return 0;
+
+	for (size_t j = 0; j < targets->length; ++j) {
+		if (targets->off[j] < -BFC_IR_MAX_OFFSET || targets->off[j] > BFC_IR_MAX_OFFSET) return 0;
+
+		// counting up from v takes (-v mod 2^n) iterations
+		if (step == 1) targets->factor[j] = -targets->factor[j];
+	}
+
+	return 1;
+}
+
+bfc_error_t bfc_ir_optimize_mul(bfc_ir_block_t **ir_block, bfc_arena_t *const arena) {
+
+	bfc_ir_block_t *block = *ir_block;
+	bfc_ir_mul_targets_t targets;
+
+	size_t new_length = 0;
+	size_t mul_loops = 0;
+	for (size_t i = 0; i < block->length; ++i) {
+		bfc_ir_instr_t *instr = &block->instr[i];
+
+		if (bfc_ir_analyze_mul_loop(instr, &targets)) {
+			new_length += targets.length + 1;
+			++mul_loops;
+		} else {
+			if (instr->op == IR_LOOP) {
+				bfc_error_t err = bfc_ir_optimize_mul((bfc_ir_block_t**) &instr->val.body, arena);
+
+				if (err.code != ERR_OK) return err;
+			}
+
+			++new_length;
+		}
+	}
+
+	if (mul_loops == 0) return BFC_ERR_OK;
+
+	bfc_ir_instr_t *instr = (bfc_ir_instr_t*) bfc_arena_alloc(arena, new_length * sizeof(bfc_ir_instr_t));
+	if (!instr) return BFC_ERR_ALLOC;
+
+	size_t length = 0;
+	for (size_t i = 0; i < block->length; ++i) {
+		if (!bfc_ir_analyze_mul_loop(&block->instr[i], &targets)) {
+			instr[length++] = block->instr[i];
+			continue;
+		}
+
+		// the products and the clear all report the loop's '[' if they fault
+		for (size_t j = 0; j < targets.length; ++j) {
+			if (targets.factor[j] != 0) {
+				instr[length] = bfc_ir_make_mul_instr(targets.off[j], targets.factor[j]);
+				instr[length++].src = block->instr[i].src;
+			}
+		}
+
+		instr[length] = bfc_ir_make_imm_instr(IR_SET, 0);
+		instr[length++].src = block->instr[i].src;
+	}
+
+	block->instr = instr;
+	block->length = length;
+	block->capacity = new_length;
+
+	return BFC_ERR_OK;
+}
+
+bfc_error_t bfc_ir_optimize_scan(bfc_ir_block_t **ir_block) {
+
+	bfc_ir_block_t *block = *ir_block;
+
+	for (size_t i = 0; i < block->length; ++i) {
+		bfc_ir_instr_t *instr = &block->instr[i];
+		if (instr->op != IR_LOOP) continue;
+
+		const bfc_ir_block_t *body = (const bfc_ir_block_t*) instr->val.body;
+
+		// [>], [<<], [>>>>], ...: walk with a fixed stride until a zero cell
+		if (body->length == 1 && body->instr[0].op == IR_MOVE 
+			&& body->instr[0].val.imm >= INT32_MIN && body->instr[0].val.imm <= INT32_MAX) {
+			const uint32_t src = instr->src;
+
+			*instr = bfc_ir_make_imm_instr(IR_SCAN, body->instr[0].val.imm);
+			instr->src = src;
+			continue;
+		}
+
+		bfc_error_t err = bfc_ir_optimize_scan((bfc_ir_block_t**) &instr->val.body);
+		if (err.code != ERR_OK) return err;
+	}
+
+	return BFC_ERR_OK;
+}
+
+// how far back a store looks for an earlier write to the same cell
+#define BFC_IR_FUSE_WINDOW 32
+
+static uint8_t bfc_ir_touches_cell(const bfc_ir_instr_t *const instr, const int32_t off) {
+
+	switch (instr->op) {
+		case IR_ADD:
+		case IR_SET:
+		case IR_PUT:
+		case IR_GET:
+			return instr->off == off;
+
+		case IR_MUL:
+			return instr->off == off || (ssize_t) instr->off + instr->val.mul.off == off;
+
+		default:
+			return 1;
+	}
+}
+
+/*
+ * Folds an ADD/SET into the closest earlier ADD/SET of the same cell within
+ * the current straight-line run, provided nothing in between reads or writes
+ * that cell.
+ */
+static uint8_t bfc_ir_fuse_store(bfc_ir_block_t *block, const size_t run_start, size_t *length, const bfc_ir_instr_t instr, const uint32_t mask) {
+
+	size_t limit = *length - run_start > BFC_IR_FUSE_WINDOW ? *length - BFC_IR_FUSE_WINDOW : run_start;
+
+	for (size_t j = *length; j-- > limit;) {
+		bfc_ir_instr_t *prev = &block->instr[j];
+
+		if ((prev->op == IR_ADD || prev->op == IR_SET) && prev->off == instr.off) {
+			if (instr.op == IR_SET) {
+				*prev = instr;
+			} else {
+				prev->val.imm += instr.val.imm;
+			}
+
+			if (prev->op == IR_ADD && ((uint32_t) prev->val.imm & mask) == 0) {
+				for (size_t k = j + 1; k < *length; ++k) block->instr[k - 1] = block->instr[k];
+				--*length;
+			}
+
+			return 1;
+		}
+
+		if (bfc_ir_touches_cell(prev, instr.off)) return 0;
+	}
+
+	return 0;
+}
+
+bfc_error_t bfc_ir_optimize_offsets(bfc_ir_block_t **ir_block, const uint8_t cell_width) {
+
+	bfc_ir_block_t *block = *ir_block;
+
+	/*
+	 * `virt` is how far the real pointer lags behind the program's pointer.
+	 * It is only materialized before loops and scans, which test the current
+	 * cell, and at the end of the block. A flush is always preceded by at
+	 * least one swallowed MOVE, so the block can be compacted in place.
+	 */
+	ssize_t virt = 0;
+	size_t run_start = 0;
+	size_t length = 0;
+
+	for (size_t i = 0; i < block->length; ++i) {
+		bfc_ir_instr_t instr = block->instr[i];
+
+		if (instr.op == IR_MOVE) {
+			ssize_t next = virt + instr.val.imm;
+
+			if (next >= INT32_MIN && next <= INT32_MAX) {
+				virt = next;
+				continue;
+			}
+
+			block->instr[length++] = bfc_ir_make_imm_instr(IR_MOVE, virt);
+			run_start = length;
+			virt = instr.val.imm;
+			continue;
+		}
+
+		if (instr.op == IR_LOOP || instr.op == IR_SCAN) {
+			if (virt != 0) block->instr[length++] = bfc_ir_make_imm_instr(IR_MOVE, virt);
+			virt = 0;
+
+			if (instr.op == IR_LOOP) {
+				bfc_error_t err = bfc_ir_optimize_offsets((bfc_ir_block_t**) &instr.val.body, cell_width);
+
+				if (err.code != ERR_OK) return err;
+			}
+
+			block->instr[length++] = instr;
+			run_start = length;
+			continue;
+		}
+
+		ssize_t cell = instr.off + virt;
+		ssize_t target = instr.op == IR_MUL ? cell + instr.val.mul.off : cell;
+
+		if (cell < -BFC_IR_MAX_OFFSET || cell > BFC_IR_MAX_OFFSET || target < -BFC_IR_MAX_OFFSET || target > BFC_IR_MAX_OFFSET) {
+			block->instr[length++] = bfc_ir_make_imm_instr(IR_MOVE, virt);
+			run_start = length;
+			virt = 0;
+		}
+
+		instr.off += (int32_t) virt;
+
+		if ((instr.op == IR_ADD || instr.op == IR_SET) && bfc_ir_fuse_store(block, run_start, &length, instr, BFC_CELL_MASK(cell_width))) continue;
+
+		block->instr[length++] = instr;
+	}
+
+	if (virt != 0) block->instr[length++] = bfc_ir_make_imm_instr(IR_MOVE, virt);
+
+	block->length = length;
+
+	return BFC_ERR_OK;
+}
+
+#define BFC_IR_KNOWN_CELLS 32
+
+/*
+ * What the const pass knows about the tape, relative to the current
+ * pointer. Listed cells are either known (`is_known`) or explicitly
+ * unknown; cells that are not listed are zero while `rest_zero` holds
+ * (nothing has been written there since program start) and unknown
+ * otherwise. Values are reduced modulo the cell width through `mask`.
+ * While `pos_known` holds, the pointer is at cell `pos` of a tape of
+ * `cells` cells.
+ */
+typedef struct {
+	int32_t off[BFC_IR_KNOWN_CELLS];
+	uint32_t value[BFC_IR_KNOWN_CELLS];
+	uint8_t is_known[BFC_IR_KNOWN_CELLS];
+	size_t length;
+	uint8_t rest_zero;
+	uint32_t mask;
+	ssize_t pos;
+	uint8_t pos_known;
+	size_t cells;
+} bfc_ir_known_t;
+
+static uint8_t bfc_ir_known_get(const bfc_ir_known_t *const known, const ssize_t off, uint32_t *value) {
+
+	for (size_t i = 0; i < known->length; ++i) {
+		if (known->off[i] != off) continue;
+
+		*value = known->value[i];
+		return known->is_known[i];
+	}
+
+	*value = 0;
+	return known->rest_zero;
+}
+
+/*
+ * Like bfc_ir_known_get, but only for cells that are known to be on the
+ * tape: listed ones, which the program has touched before, and those at a
+ * known position. Dropping an instruction drops its tape access, which is
+ * only sound for those, as any other access may be the one that faults.
+ */
+static uint8_t bfc_ir_known_get_on_tape(const bfc_ir_known_t *const known, const ssize_t off, uint32_t *value) {
+
+	for (size_t i = 0; i < known->length; ++i) {
+		if (known->off[i] != off) continue;
+
+		*value = known->value[i];
+		return known->is_known[i];
+	}
+
+	*value = 0;
+	return known->rest_zero && known->pos_known && (size_t) (known->pos + off) < known->cells;
+}
+
+static void bfc_ir_known_put(bfc_ir_known_t *known, const ssize_t off, const uint32_t value, const uint8_t is_known) {
+
+	size_t i = 0;
+	while (i < known->length && known->off[i] != off) ++i;
+
+	if (i == known->length) {
+		// an unknown cell only needs an entry while absent cells mean zero
+		if (!is_known && !known->rest_zero) return;
+		if (off < INT32_MIN || off > INT32_MAX) {
+			known->rest_zero = 0;
+			return;
+		}
+
+		if (known->length >= BFC_IR_KNOWN_CELLS) {
+			// evicting a cell is only sound once absent cells are unknown
+			known->rest_zero = 0;
+			i = 0;
+		} else {
+			++known->length;
+		}
+	}
+
+	known->off[i] = (int32_t) off;
+	known->value[i] = value;
+	known->is_known[i] = is_known;
+}
+
+static void bfc_ir_known_move(bfc_ir_known_t *known, const ssize_t delta) {
+
+	known->pos += delta;
+
+	size_t length = 0;
+	for (size_t i = 0; i < known->length; ++i) {
+		ssize_t off = known->off[i] - delta;
+
+		if (off < INT32_MIN || off > INT32_MAX) {
+			known->rest_zero = 0;
+			continue;
+		}
+
+		known->off[length] = (int32_t) off;
+		known->value[length] = known->value[i];
+		known->is_known[length] = known->is_known[i];
+		++length;
+	}
+
+	known->length = length;
+}
+
+static void bfc_ir_known_reset(bfc_ir_known_t *known) {
+
+	known->length = 0;
+	known->rest_zero = 0;
+	known->pos_known = 0;
+}
+
+/*
+ * Cells a block may write, relative to the cell it starts on, including
+ * those of the loops nested in it. Summarized bottom-up once per run of
+ * the const pass, so invalidating an outer loop does not walk its nested
+ * bodies again. A block writing more cells than are listed sets `all`.
+ */
+typedef struct bfc_ir_writes_t {
+	int32_t off[BFC_IR_KNOWN_CELLS];
+	size_t length;
+	uint8_t all;
+
+	// the block returns to the cell it started on
+	uint8_t balanced;
+} bfc_ir_writes_t;
+
+static void bfc_ir_writes_add(bfc_ir_writes_t *writes, const ssize_t off) {
+
+	if (writes->all) return;
+
+	for (size_t i = 0; i < writes->length; ++i) {
+		if (writes->off[i] == off) return;
+	}
+
+	if (writes->length == BFC_IR_KNOWN_CELLS || off < INT32_MIN || off > INT32_MAX) {
+		writes->all = 1;
+		return;
+	}
+
+	writes->off[writes->length++] = (int32_t) off;
+}
+
+static bfc_error_t bfc_ir_summarize_writes(bfc_ir_block_t *block, bfc_arena_t *const arena) {
+
+	if (!block->writes) {
+		block->writes = (bfc_ir_writes_t*) bfc_arena_alloc(arena, sizeof(bfc_ir_writes_t));
+		if (!block->writes) return BFC_ERR_ALLOC;
+	}
+
+	bfc_ir_writes_t *writes = block->writes;
+	writes->length = 0;
+	writes->all = 0;
+	writes->balanced = 1;
+
+	ssize_t ptr = 0;
+
+	for (size_t i = 0; i < block->length; ++i) {
+		const bfc_ir_instr_t *instr = &block->instr[i];
+
+		switch (instr->op) {
+			case IR_MOVE: {
+				ptr += instr->val.imm;
+			} break;
+
+			case IR_ADD:
+			case IR_SET:
+			case IR_GET: {
+				bfc_ir_writes_add(writes, ptr + instr->off);
+			} break;
+
+			case IR_MUL: {
+				bfc_ir_writes_add(writes, ptr + instr->off + instr->val.mul.off);
+			} break;
+
+			case IR_LOOP: {
+				bfc_ir_block_t *body = (bfc_ir_block_t*) instr->val.body;
+
+				bfc_error_t err = bfc_ir_summarize_writes(body, arena);
+				if (err.code != ERR_OK) return err;
+
+				bfc_ir_writes_add(writes, ptr);
+
+				if (!body->writes->balanced) writes->balanced = 0;
+				if (body->writes->all) writes->all = 1;
+
+				for (size_t j = 0; j < body->writes->length; ++j) bfc_ir_writes_add(writes, ptr + body->writes->off[j]);
+			} break;
+
+			case IR_SCAN: {
+				writes->balanced = 0;
+			} break;
+
+			default:
+				break;
+		}
+	}
+
+	if (ptr != 0) writes->balanced = 0;
+
+	return BFC_ERR_OK;
+}
+
+/*
+ * Forgets every cell a loop body may write. Returns 0 if the body does not
+ * return to the cell it started on, in which case nothing is known after it.
+ */
+static uint8_t bfc_ir_known_forget_writes(bfc_ir_known_t *known, const bfc_ir_block_t *const block) {
+
+	const bfc_ir_writes_t *writes = block->writes;
+
+	if (!writes->balanced) return 0;
+
+	// a balanced body leaves the pointer where it was, even if nothing else is known
+	if (writes->all) {
+		known->length = 0;
+		known->rest_zero = 0;
+		return 1;
+	}
+
+	for (size_t i = 0; i < writes->length; ++i) bfc_ir_known_put(known, writes->off[i], 0, 0);
+
+	return 1;
+}
+
+static void bfc_ir_emit_move(bfc_ir_block_t *block, size_t *length, const ssize_t imm) {
+
+	bfc_ir_instr_t *prev = *length > 0 ? &block->instr[*length - 1] : NULL;
+
+	if (prev && prev->op == IR_MOVE) {
+		prev->val.imm += imm;
+		if (prev->val.imm == 0) --*length;
+
+		return;
+	}
+
+	block->instr[(*length)++] = bfc_ir_make_imm_instr(IR_MOVE, imm);
+}
+
+static void bfc_ir_propagate_known(bfc_ir_block_t *block, bfc_ir_known_t *known) {
+
+	// instructions are only ever dropped or rewritten one for one
+	size_t length = 0;
+	uint32_t value;
+
+	for (size_t i = 0; i < block->length; ++i) {
+		bfc_ir_instr_t instr = block->instr[i];
+
+		switch (instr.op) {
+			case IR_MOVE: {
+				bfc_ir_known_move(known, instr.val.imm);
+				bfc_ir_emit_move(block, &length, instr.val.imm);
+			} continue;
+
+			case IR_ADD: {
+				if (!bfc_ir_known_get(known, instr.off, &value)) {
+					bfc_ir_known_put(known, instr.off, 0, 0);
+					break;
+				}
+
+				instr.op = IR_SET;
+				instr.val.imm = (value + (uint32_t) instr.val.imm) & known->mask;
+			} // fallthrough
+
+			case IR_SET: {
+				if (bfc_ir_known_get_on_tape(known, instr.off, &value) && value == ((uint32_t) instr.val.imm & known->mask)) continue;
+
+				bfc_ir_known_put(known, instr.off, (uint32_t) instr.val.imm & known->mask, 1);
+			} break;
+
+			case IR_GET: {
+				bfc_ir_known_put(known, instr.off, 0, 0);
+			} break;
+
+			case IR_PUT:
+				break;
+
+			case IR_MUL: {
+				ssize_t dst = instr.off + instr.val.mul.off;
+				uint32_t dst_value;
+
+				// the rewrites below no longer read the source cell
+				if (!bfc_ir_known_get_on_tape(known, instr.off, &value)) {
+					bfc_ir_known_put(known, dst, 0, 0);
+					break;
+				}
+
+				const uint32_t src = instr.src;
+				const uint32_t product = (value * (uint32_t) instr.val.mul.factor) & known->mask;
+				if (product == 0 && bfc_ir_known_get_on_tape(known, dst, &dst_value)) continue;
+
+				if (bfc_ir_known_get(known, dst, &dst_value)) {
+					instr = bfc_ir_make_imm_instr(IR_SET, (dst_value + product) & known->mask);
+					bfc_ir_known_put(known, dst, (dst_value + product) & known->mask, 1);
+				} else {
+					instr = bfc_ir_make_imm_instr(IR_ADD, product);
+				}
+
+				instr.off = (int32_t) dst;
+				instr.src = src;
+			} break;
+
+			case IR_SCAN: {
+				if (bfc_ir_known_get_on_tape(known, 0, &value) && value == 0) continue;
+
+				bfc_ir_known_reset(known);
+				bfc_ir_known_put(known, 0, 0, 1);
+			} break;
+
+			case IR_LOOP: {
+				// never entered: the whole loop is dead
+				if (bfc_ir_known_get_on_tape(known, 0, &value) && value == 0) continue;
+
+				/*
+				 * Cells a balanced body never writes hold the same value on
+				 * every iteration, so they stay known inside and after it.
+				 */
+				bfc_ir_known_t inner = *known;
+				bfc_ir_known_put(&inner, 0, 0, 0);
+
+				if (!bfc_ir_known_forget_writes(&inner, (const bfc_ir_block_t*) instr.val.body)) 
+					bfc_ir_known_reset(&inner);
+
+				*known = inner;
+
+				bfc_ir_propagate_known((bfc_ir_block_t*) instr.val.body, &inner);
+
+				bfc_ir_known_put(known, 0, 0, 1);
+			} break;
+
+			case IR_LOOP_END:
+			case IR_COUNT:
+				break;
+		}
+
+		block->instr[length++] = instr;
+	}
+
+	block->length = length;
+}
+
+#define BFC_IR_DEAD_CELLS 32
+
+/*
+ * Cells whose current value is never read again. With `all_dead` the
+ * listed cells are the live exceptions, otherwise they are the dead ones.
+ */
+typedef struct {
+	int32_t off[BFC_IR_DEAD_CELLS];
+	size_t length;
+	uint8_t all_dead;
+} bfc_ir_dead_t;
+
+static size_t bfc_ir_dead_find(const bfc_ir_dead_t *const dead, const ssize_t off) {
+
+	size_t i = 0;
+	while (i < dead->length && dead->off[i] != off) ++i;
+
+	return i;
+}
+
+static uint8_t bfc_ir_dead_is(const bfc_ir_dead_t *const dead, const ssize_t off) {
+
+	return (bfc_ir_dead_find(dead, off) < dead->length) != dead->all_dead;
+}
+
+static void bfc_ir_dead_mark(bfc_ir_dead_t *dead, const ssize_t off, const uint8_t is_dead) {
+
+	size_t i = bfc_ir_dead_find(dead, off);
+
+	// listed iff the cell differs from the default
+	if (is_dead != dead->all_dead) {
+		if (i < dead->length) return;
+
+		if (dead->length < BFC_IR_DEAD_CELLS && off >= INT32_MIN && off <= INT32_MAX) {
+			dead->off[dead->length++] = (int32_t) off;
+		} else if (dead->all_dead) {
+			// out of room for live cells: fall back to assuming all are live
+			dead->all_dead = 0;
+			dead->length = 0;
+		}
+	} else if (i < dead->length) {
+		dead->off[i] = dead->off[--dead->length];
+	}
 }
 
-void bfc_ir_destroy(bfc_ir_block_t **proot_block) {
+/*
+ * `at_end` is set for the top-level block, after which the program exits.
+ * Its last stores still stay: the cells they write are dead, but the store
+ * may be what runs off the tape, and that has to fault on every level.
+ */
+static void bfc_ir_remove_dead_stores(bfc_ir_block_t *block, const uint8_t at_end) {
+
+	bfc_ir_dead_t dead = { .length = 0, .all_dead = 0 };
+
+	// walk backwards, packing the kept instructions at the end of the block
+	size_t keep = block->length;
+
+	for (size_t i = block->length; i-- > 0;) {
+		bfc_ir_instr_t instr = block->instr[i];
+
+		switch (instr.op) {
+			case IR_MOVE: {
+				// nothing runs after it and moving alone never faults, so where the pointer ends up is moot
+				if (at_end && keep == block->length) continue;
+
+				for (size_t j = 0; j < dead.length; ++j) {
+					ssize_t off = dead.off[j] + instr.val.imm;
+
+					if (off < INT32_MIN || off > INT32_MAX) {
+						dead.all_dead = 0;
+						dead.length = 0;
+						break;
+					}
 
-	if (!proot_block || !*proot_block) return;
+					dead.off[j] = (int32_t) off;
+				}
+
+				if (keep < block->length && block->instr[keep].op == IR_MOVE) {
+					block->instr[keep].val.imm += instr.val.imm;
+					if (block->instr[keep].val.imm == 0) ++keep;
+
+					continue;
+				}
+			} break;
+
+			case IR_SET: {
+				if (bfc_ir_dead_is(&dead, instr.off)) continue;
+
+				bfc_ir_dead_mark(&dead, instr.off, 1);
+			} break;
+
+			case IR_ADD: {
+				if (bfc_ir_dead_is(&dead, instr.off)) continue;
+
+				bfc_ir_dead_mark(&dead, instr.off, 0);
+			} break;
+
+			case IR_MUL: {
+				if (bfc_ir_dead_is(&dead, instr.off + instr.val.mul.off)) continue;
+
+				bfc_ir_dead_mark(&dead, instr.off, 0);
+				bfc_ir_dead_mark(&dead, instr.off + instr.val.mul.off, 0);
+			} break;
+
+			// a GET at EOF leaves the cell as it was, so it reads it as well
+			case IR_PUT:
+			case IR_GET: {
+				bfc_ir_dead_mark(&dead, instr.off, 0);
+			} break;
+
+			case IR_LOOP: {
+				bfc_ir_remove_dead_stores((bfc_ir_block_t*) instr.val.body, 0);
+			} // fallthrough
+
+			default: {
+				dead.all_dead = 0;
+				dead.length = 0;
+			} break;
+		}
 
-	for (size_t i = 0; i < (*proot_block)->length; ++i) {
-		if ((*proot_block)->instr[i].op == IR_LOOP && (*proot_block)->instr[i].val.body)
-			bfc_ir_destroy((bfc_ir_block_t**) &(*proot_block)->instr[i].val.body);
+		block->instr[--keep] = instr;
 	}
 
-	free((*proot_block)->instr);
-	free(*proot_block);
+	size_t length = block->length - keep;
+	for (size_t i = 0; i < length; ++i) block->instr[i] = block->instr[keep + i];
 
-	*proot_block = NULL;
+	block->length = length;
+}
+
+bfc_error_t bfc_ir_optimize_const(bfc_ir_block_t **ir_block, const uint8_t cell_width, const size_t tape_size, bfc_arena_t *const arena) {
+
+	// the tape starts out all zero, with the pointer on its first cell
+	bfc_ir_known_t known = { 
+		.length = 0, 
+		.rest_zero = 1, 
+		.mask = BFC_CELL_MASK(cell_width), 
+		.pos = 0, 
+		.pos_known = 1, 
+		.cells = tape_size 
+	};
+
+	// earlier passes may have rewritten any body since the last run
+	bfc_error_t err = bfc_ir_summarize_writes(*ir_block, arena);
+	if (err.code != ERR_OK) return err;
+
+	bfc_ir_propagate_known(*ir_block, &known);
+	bfc_ir_remove_dead_stores(*ir_block, 1);
+
+	return BFC_ERR_OK;
+}
+
+size_t bfc_ir_count(const bfc_ir_block_t *const ir_block) {
+
+	size_t count = ir_block->length;
+
+	for (size_t i = 0; i < ir_block->length; ++i) {
+		if (ir_block->instr[i].op == IR_LOOP) 
+			count += bfc_ir_count((const bfc_ir_block_t*) ir_block->instr[i].val.body);
+	}
+
+	return count;
+}
+
+static void bfc_ir_dump_block(const bfc_ir_block_t *const ir_block, FILE *out, const size_t depth) {
+
+	for (size_t i = 0; i < ir_block->length; ++i) {
+		const bfc_ir_instr_t *instr = &ir_block->instr[i];
+
+		fprintf(out, "%*s", (int) (2 * depth), "");
+
+		switch (instr->op) {
+			case IR_ADD:  fprintf(out, "add   [%+d] %zd\n", instr->off, instr->val.imm); break;
+			case IR_SET:  fprintf(out, "set   [%+d] %zd\n", instr->off, instr->val.imm); break;
+			case IR_MOVE: fprintf(out, "move  %+zd\n", instr->val.imm); break;
+			case IR_PUT:  fprintf(out, "put   [%+d]\n", instr->off); break;
+			case IR_GET:  fprintf(out, "get   [%+d]\n", instr->off); break;
+			case IR_SCAN: fprintf(out, "scan  %+zd\n", instr->val.imm); break;
+			case IR_COUNT: fprintf(out, "count #%zd\n", instr->val.imm); break;
+
+			case IR_MUL: {
+				fprintf(out, "mul   [%+d] += [%+d] * %d\n", instr->off + instr->val.mul.off, instr->off, instr->val.mul.factor);
+			} break;
+
+			case IR_LOOP: {
+				fprintf(out, "loop\n");
+				bfc_ir_dump_block((const bfc_ir_block_t*) instr->val.body, out, depth + 1);
+				fprintf(out, "%*send\n", (int) (2 * depth), "");
+			} break;
+
+			default: fprintf(out, "op %d\n", (int) instr->op); break;
+		}
+	}
+}
+
+void bfc_ir_dump(const bfc_ir_block_t *const ir_block, FILE *out) {
+
+	bfc_ir_dump_block(ir_block, out, 0);
+}
+
+bfc_error_t bfc_ir_flatten(bfc_ir_code_t **code, const bfc_ir_block_t *const root_block, bfc_arena_t *const arena) {
+
+	bfc_error_t err = BFC_ERR_ALLOC;
+	*code = NULL;
+
+	typedef struct {
+		const bfc_ir_block_t *block;
+		size_t index;
+		uint32_t src;
+	} bfc_ir_frame_t;
+
+	size_t frame_capacity = 16;
+	size_t frame_length = 0;
+	bfc_ir_frame_t *frames = NULL;
+
+	size_t capacity = root_block->length + 16;
+
+	bfc_ir_code_t *flat = (bfc_ir_code_t*) bfc_arena_alloc(arena, sizeof(bfc_ir_code_t));
+	if (!flat) goto end;
+
+	flat->length = 0;
+	flat->instr = (bfc_ir_flat_instr_t*) bfc_arena_alloc(arena, capacity * sizeof(bfc_ir_flat_instr_t));
+	if (!flat->instr) goto end;
+
+	frames = (bfc_ir_frame_t*) malloc(frame_capacity * sizeof(bfc_ir_frame_t));
+	if (!frames) goto end;
+
+	frames[frame_length++] = (bfc_ir_frame_t) { .block = root_block, .index = 0 };
+
+	while (frame_length > 0) {
+		bfc_ir_frame_t *frame = &frames[frame_length - 1];
+
+		if (flat->length >= capacity) {
+			bfc_ir_flat_instr_t *tmp = (bfc_ir_flat_instr_t*) bfc_arena_grow(
+				arena,
+				flat->instr, 
+				capacity * sizeof(bfc_ir_flat_instr_t),
+				capacity * 2 * sizeof(bfc_ir_flat_instr_t)
+			);
+
+			if (!tmp) goto end;
+
+			flat->instr = tmp;
+			capacity *= 2;
+		}
+
+		if (frame->index >= frame->block->length) {
+			--frame_length;
+
+			if (frame_length > 0) 
+				flat->instr[flat->length++] = (bfc_ir_flat_instr_t) { .op = IR_LOOP_END, .src = frame->src };
+
+			continue;
+		}
+
+		const bfc_ir_instr_t *instr = &frame->block->instr[frame->index++];
+
+		if (instr->op == IR_LOOP) {
+			flat->instr[flat->length++] = (bfc_ir_flat_instr_t) { .op = IR_LOOP, .src = instr->src };
+
+			if (frame_length >= frame_capacity) {
+				frame_capacity *= 2;
+
+				bfc_ir_frame_t *tmp = (bfc_ir_frame_t*) realloc(frames, frame_capacity * sizeof(bfc_ir_frame_t));
+				if (!tmp) goto end;
+
+				frames = tmp;
+			}
+
+			frames[frame_length++] = (bfc_ir_frame_t) { 
+				.block = (const bfc_ir_block_t*) instr->val.body, 
+				.index = 0,
+				.src = instr->src
+			};
+
+			continue;
+		}
+
+		if (instr->op == IR_MUL) {
+			flat->instr[flat->length++] = (bfc_ir_flat_instr_t) { 
+				.op = IR_MUL, 
+				.off = (int32_t) instr->off,
+				.imm = (int32_t) instr->val.mul.factor,
+				.dst = (int32_t) (instr->off + instr->val.mul.off),
+				.src = instr->src
+			};
+
+			continue;
+		}
+
+		if (instr->op == IR_MOVE && (instr->val.imm < INT32_MIN || instr->val.imm > INT32_MAX)) {
+			err = bfc_make_error(ERR_INTERNAL, "Pointer move out of range for flat IR!");
+			goto end;
+		}
+
+		// cell arithmetic wraps, so truncating ADD/SET immediates is exact
+		flat->instr[flat->length++] = (bfc_ir_flat_instr_t) { 
+			.op = (uint8_t) instr->op, 
+			.off = (int32_t) instr->off,
+			.imm = (int32_t) instr->val.imm,
+			.src = instr->src
+		};
+	}
+
+	err = bfc_link_jump_table(flat);
+	if (err.code != ERR_OK) goto end;
+
+	*code = flat;
+
+end:
+	free(frames);
+
+	return err;
 }
@@ -0,0 +1,185 @@
+#define _GNU_SOURCE
+
+#include "bfc_jit.h"
+
+#include "bfc_codegen.h"
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+typedef void (*bfc_jit_entry_t)(uint8_t *tape);
+
+/*
+ * What the SIGSEGV handler needs to know about the running program. Signal
+ * handlers take no context argument, so it is published here for as long
+ * as the generated code runs.
+ */
+static struct {
+	const bfc_asm_t *asm_prog;
+	const uint8_t *code;
+	const uint8_t *map;
+} bfc_jit_active;
+
+static void bfc_jit_write_all(const int fd, const char *buffer, size_t length) {
+
+	while (length > 0) {
+		ssize_t written = write(fd, buffer, length);
+		if (written <= 0) return;
+
+		buffer += written;
+		length -= (size_t) written;
+	}
+}
+
+// decimal digits of `value` in front of `end`; returns where they start
+static char *bfc_jit_utoa(char *end, uint32_t value) {
+
+	do {
+		*--end = (char) ('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	return end;
+}
+
+static void bfc_jit_on_fault(int sig, siginfo_t *info, void *context) {
+
+	const bfc_asm_t *asm_prog = bfc_jit_active.asm_prog;
+	const uint8_t *addr = (const uint8_t*) info->si_addr;
+
+	// not a guard page: the default action kills the process once the fault repeats
+	if (addr < bfc_jit_active.map || addr >= bfc_jit_active.map + asm_prog->layout.map_size) {
+		signal(sig, SIG_DFL);
+
+		return;
+	}
+
+	const greg_t *gregs = ((const ucontext_t*) context)->uc_mcontext.gregs;
+	const size_t pc = (size_t) ((const uint8_t*) gregs[REG_RIP] - bfc_jit_active.code);
+
+	// whatever the program buffered still goes out: cell 0 is in %r12, the pending byte count in %r13
+	bfc_jit_write_all(STDOUT_FILENO, (const char*) gregs[REG_R12] + asm_prog->layout.output_offset, (size_t) gregs[REG_R13]);
+
+	size_t lo = 0;
+	size_t hi = asm_prog->loc_length;
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (asm_prog->locs[mid].pc <= pc) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	char line[64];
+	char *end = line + sizeof(line);
+	char *start = end;
+
+	*--start = '\n';
+
+	if (asm_prog->loc_length > 0) {
+		start = bfc_jit_utoa(start, asm_prog->locs[lo].col);
+		*--start = ':';
+		start = bfc_jit_utoa(start, asm_prog->locs[lo].line);
+	}
+
+	static const char prefix[] = "tape overflow at ";
+	bfc_jit_write_all(STDERR_FILENO, prefix, sizeof(prefix) - 1);
+	bfc_jit_write_all(STDERR_FILENO, start, (size_t) (end - start));
+
+	_exit(EXIT_FAILURE);
+}
+
+bfc_error_t bfc_jit_run(const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_runtime_opts_t opts) {
+
+	bfc_asm_t *asm_prog = NULL;
+	uint8_t *map = MAP_FAILED;
+	void *code = MAP_FAILED;
+
+	bfc_error_t err = bfc_codegen_jit(&asm_prog, ir_block, snapshot, program, opts);
+	if (err.code != ERR_OK) goto end;
+
+	const bfc_runtime_layout_t layout = asm_prog->layout;
+
+	err = BFC_ERR_ALLOC;
+
+	// the same layout freestanding programs map for themselves, guards left inaccessible
+	map = (uint8_t*) mmap(NULL, layout.map_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (map == MAP_FAILED) goto end;
+
+	uint8_t *const tape = map + layout.guard_bytes;
+
+	if (
+		mprotect(tape, layout.tape_bytes, PROT_READ | PROT_WRITE) != 0 ||
+		mprotect(tape + layout.output_offset, 2 * BFC_IO_BUFFER_SIZE + layout.counter_bytes, PROT_READ | PROT_WRITE) != 0
+	) goto end;
+
+	// W^X: the buffer is writable while the code is copied in, executable only afterwards
+	code = mmap(NULL, asm_prog->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (code == MAP_FAILED) goto end;
+
+	memcpy(code, asm_prog->buffer, asm_prog->length);
+
+	if (mprotect(code, asm_prog->length, PROT_READ | PROT_EXEC) != 0) {
+		err = bfc_make_error(ERR_INTERNAL, "Unable to make JIT code executable!");
+		goto end;
+	}
+
+	bfc_jit_active.asm_prog = asm_prog;
+	bfc_jit_active.code = (const uint8_t*) code;
+	bfc_jit_active.map = map;
+
+	struct sigaction action;
+	struct sigaction previous;
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = bfc_jit_on_fault;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+
+	if (sigaction(SIGSEGV, &action, &previous) != 0) {
+		err = bfc_make_error(ERR_INTERNAL, "Unable to install the tape overflow handler!");
+		goto end;
+	}
+
+	bfc_jit_entry_t entry;
+	*(void**) &entry = code;
+
+	entry(tape);
+
+	sigaction(SIGSEGV, &previous, NULL);
+
+	// the counters sit behind the input buffer, zeroed by the mapping
+	if (opts.profile) {
+		err = bfc_profile_write(opts.profile, (const uint64_t*) (tape + layout.counter_offset));
+		goto end;
+	}
+
+	err = BFC_ERR_OK;
+
+end:
+	if (code != MAP_FAILED) munmap(code, asm_prog->length);
+	if (map != MAP_FAILED) munmap(map, asm_prog->layout.map_size);
+	bfc_asm_destroy(&asm_prog);
+
+	return err;
+}
+
+#else
+
+bfc_error_t bfc_jit_run(const bfc_ir_block_t *const ir_block, const bfc_snapshot_t *const snapshot, bfc_program_t *const program, const bfc_runtime_opts_t opts) {
+
+	// the generated code and the fault handler's register layout are x86_64 only
+	bfc_asm_t *asm_prog = NULL;
+
+	return bfc_codegen_jit(&asm_prog, ir_block, snapshot, program, opts);
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "bfc_jumptable.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -15,7 +16,7 @@ bfc_error_t bfc_parse_jump_table(ssize_t **jump_table, const bfc_token_stream_t
 		return BFC_ERR_OK;
 	}
 
-	const bfc_token_t *toks = tok_stream->tokens;
+	const uint8_t *types = tok_stream->types;
 
 	ssize_t *jtable = malloc(n * sizeof(ssize_t));
 	if (!jtable) return BFC_ERR_ALLOC;
@@ -34,9 +35,9 @@ bfc_error_t bfc_parse_jump_table(ssize_t **jump_table, const bfc_token_stream_t
 	size_t i;
 	size_t j;
 	for (i = 0; i < n; ++i) {
-		if (toks[i].type == TT_LOOP_START) {
+		if (types[i] == TT_LOOP_START) {
 			stack[sp++] = i;
-		} else if (toks[i].type == TT_LOOP_END) {
+		} else if (types[i] == TT_LOOP_END) {
 			if (sp == 0) goto extra_closing_bracket;
 			j = stack[--sp];
 
@@ -53,9 +54,10 @@ bfc_error_t bfc_parse_jump_table(ssize_t **jump_table, const bfc_token_stream_t
 	return BFC_ERR_OK;
 
 extra_closing_bracket:
-	snprintf(err_str, sizeof(err_str), "Found an extra ']' at line %lu.", toks[i].line);
+	// the line is only known once the error is reported, see bfc_log_error
+	snprintf(err_str, sizeof(err_str), "Found an extra ']'");
 
-	err = bfc_make_error_with_token(ERR_MISMATCHED_BRACKET, err_str, toks[i]);
+	err = bfc_make_error_with_token(ERR_MISMATCHED_BRACKET, err_str, bfc_make_token(TT_LOOP_END, tok_stream->offsets[i]));
 
 	free(stack);
 	free(jtable);
@@ -63,13 +65,9 @@ extra_closing_bracket:
 	return err;
 
 missing_closing_bracket:
-	snprintf(
-		err_str, sizeof(err_str), 
-		"Missing a closing bracket ']' for opening bracket '[' at line %lu.", 
-		toks[stack[sp - 1]].line
-	);
+	snprintf(err_str, sizeof(err_str), "Missing a closing bracket ']' for opening bracket '['");
 	
-	err = bfc_make_error_with_token(ERR_MISSING_BRACKET, err_str, toks[stack[sp - 1]]);
+	err = bfc_make_error_with_token(ERR_MISSING_BRACKET, err_str, bfc_make_token(TT_LOOP_START, tok_stream->offsets[stack[sp - 1]]));
 
 	free(stack);
 	free(jtable);
@@ -77,6 +75,42 @@ missing_closing_bracket:
 	return err;
 }
 
+bfc_error_t bfc_link_jump_table(bfc_ir_code_t *const code) {
+
+	size_t n = code->length;
+	if (n == 0) return BFC_ERR_OK;
+
+	if (n > INT32_MAX) return bfc_make_error(ERR_INTERNAL, "Program too large for flat IR!");
+
+	size_t *stack = malloc(n * sizeof(size_t));
+	if (!stack) return BFC_ERR_ALLOC;
+
+	size_t sp = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+		if (code->instr[i].op == IR_LOOP) {
+			stack[sp++] = i;
+		} else if (code->instr[i].op == IR_LOOP_END) {
+			if (sp == 0) {
+				free(stack);
+
+				return bfc_make_error(ERR_INTERNAL, "Unbalanced loop in flat IR!");
+			}
+
+			size_t j = stack[--sp];
+
+			code->instr[j].imm = (int32_t) i;
+			code->instr[i].imm = (int32_t) j;
+		}
+	}
+
+	free(stack);
+
+	if (sp != 0) return bfc_make_error(ERR_INTERNAL, "Unbalanced loop in flat IR!");
+
+	return BFC_ERR_OK;
+}
+
 void bfc_jump_table_destroy(ssize_t **pjump_table) {
 
 	if (!pjump_table || !*pjump_table) return;
@@ -1,13 +1,20 @@
 #include "bfc_lexer.h"
 
 #include <stdlib.h>
+#include <string.h>
 
-bfc_token_t bfc_make_token(const bfc_token_type_t tok_type, const uint32_t line, const uint32_t col) {
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(BFC_LEX_NO_SIMD)
+#define BFC_LEX_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#define BFC_LEX_INITIAL_CAPACITY 4096
+
+bfc_token_t bfc_make_token(const bfc_token_type_t tok_type, const uint32_t offset) {
 
 	return (bfc_token_t) {
-		.type = tok_type, 
-		.line = line, 
-		.col = col
+		.type = tok_type,
+		.offset = offset
 	};
 }
 
@@ -15,113 +22,248 @@ void bfc_token_stream_destroy(bfc_token_stream_t **ptok_stream) {
 
 	if (!ptok_stream || !*ptok_stream) return;
 
-	free((*ptok_stream)->tokens);
+	free((*ptok_stream)->types);
+	free((*ptok_stream)->counts);
+	free((*ptok_stream)->offsets);
 	free(*ptok_stream);
 
 	*ptok_stream = NULL;
 }
 
+static uint8_t bfc_lex_is_relevant(const char c) {
+
+	switch (c) {
+		case '+': case '-': case '<': case '>':
+		case '[': case ']': case ',': case '.':
+		case ';':
+			return 1;
+
+		default:
+			return 0;
+	}
+}
+
+uint64_t bfc_lex_classify_tail(const char *block, const size_t length) {
+
+	uint64_t mask = 0;
+	for (size_t i = 0; i < length && i < BFC_LEX_BLOCK; ++i) 
+		mask |= (uint64_t) bfc_lex_is_relevant(block[i]) << i;
+
+	return mask;
+}
+
+#ifdef BFC_LEX_X86_SIMD
+
+// '+' ',' '-' '.' are the contiguous range 0x2B..0x2E, the rest is matched one by one
+static inline __m128i bfc_lex_match_sse2(const __m128i v) {
+
+	const __m128i rel = _mm_sub_epi8(v, _mm_set1_epi8(0x2B));
+	__m128i m = _mm_cmpeq_epi8(_mm_min_epu8(rel, _mm_set1_epi8(3)), rel);
+
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('[')));
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(']')));
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(';')));
+
+	return m;
+}
+
+static uint64_t bfc_lex_classify_sse2(const char *block) {
+
+	uint64_t mask = 0;
+	for (size_t i = 0; i < BFC_LEX_BLOCK; i += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i*) (block + i));
+
+		mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(bfc_lex_match_sse2(v)) << i;
+	}
+
+	return mask;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i bfc_lex_match_avx2(const __m256i v) {
+
+	const __m256i rel = _mm256_sub_epi8(v, _mm256_set1_epi8(0x2B));
+	__m256i m = _mm256_cmpeq_epi8(_mm256_min_epu8(rel, _mm256_set1_epi8(3)), rel);
+
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('<')));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('>')));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('[')));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(']')));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(';')));
+
+	return m;
+}
+
+__attribute__((target("avx2")))
+static uint64_t bfc_lex_classify_avx2(const char *block) {
+
+	const __m256i lo = _mm256_loadu_si256((const __m256i*) block);
+	const __m256i hi = _mm256_loadu_si256((const __m256i*) (block + 32));
+
+	const uint64_t lo_mask = (uint32_t) _mm256_movemask_epi8(bfc_lex_match_avx2(lo));
+	const uint64_t hi_mask = (uint32_t) _mm256_movemask_epi8(bfc_lex_match_avx2(hi));
+
+	return lo_mask | (hi_mask << 32);
+}
+
+#else
+
+static uint64_t bfc_lex_classify_scalar(const char *block) {
+
+	return bfc_lex_classify_tail(block, BFC_LEX_BLOCK);
+}
+
+#endif
+
+bfc_lex_classify_t bfc_lex_select_classifier(void) {
+
+#ifdef BFC_LEX_X86_SIMD
+	if (__builtin_cpu_supports("avx2")) return bfc_lex_classify_avx2;
+
+	return bfc_lex_classify_sse2;
+#else
+	return bfc_lex_classify_scalar;
+#endif
+}
+
+static uint8_t bfc_token_stream_reserve(bfc_token_stream_t *tok_stream, const size_t capacity) {
+
+	uint8_t *types = (uint8_t*) realloc(tok_stream->types, capacity * sizeof(uint8_t));
+	if (!types) return 0;
+	tok_stream->types = types;
+
+	uint32_t *counts = (uint32_t*) realloc(tok_stream->counts, capacity * sizeof(uint32_t));
+	if (!counts) return 0;
+	tok_stream->counts = counts;
+
+	uint32_t *offsets = (uint32_t*) realloc(tok_stream->offsets, capacity * sizeof(uint32_t));
+	if (!offsets) return 0;
+	tok_stream->offsets = offsets;
+
+	tok_stream->capacity = capacity;
+
+	return 1;
+}
+
+static uint8_t bfc_token_stream_push(bfc_token_stream_t *tok_stream, const bfc_token_type_t type, const uint32_t offset) {
+
+	size_t last = tok_stream->length - 1;
+
+	// brackets stay separate so that the jump table can pair them
+	if (
+		tok_stream->length > 0 && tok_stream->types[last] == type &&
+		type != TT_LOOP_START && type != TT_LOOP_END && tok_stream->counts[last] < UINT32_MAX
+	) {
+		++tok_stream->counts[last];
+
+		return 1;
+	}
+
+	if (tok_stream->length == tok_stream->capacity) {
+		if (!bfc_token_stream_reserve(tok_stream, 2 * tok_stream->capacity)) return 0;
+	}
+
+	tok_stream->types[tok_stream->length] = (uint8_t) type;
+	tok_stream->counts[tok_stream->length] = 1;
+	tok_stream->offsets[tok_stream->length] = offset;
+	++tok_stream->length;
+
+	return 1;
+}
+
 bfc_error_t bfc_lex(bfc_token_stream_t **token_stream, const bfc_program_t *const program, const bfc_args_t cmd_args) {
 
 	bfc_error_t err = BFC_ERR_OK;
 
 	*token_stream = NULL;
-	
+
 	bfc_token_stream_t *tok_stream = NULL;
 
-	if (program->file_size == 0) goto end;
+	if (program->file_size > UINT32_MAX) {
+		err = bfc_make_error(ERR_IO, "Source files larger than 4 GiB are not supported!");
+		goto end;
+	}
 
 	err = BFC_ERR_ALLOC;
 
-	tok_stream = (bfc_token_stream_t*) malloc(sizeof(bfc_token_stream_t));
+	tok_stream = (bfc_token_stream_t*) calloc(1, sizeof(bfc_token_stream_t));
 	if (!tok_stream) goto end;
 
-	tok_stream->tokens = NULL;
-	tok_stream->length = 0;
-
-	tok_stream->tokens = (bfc_token_t*) malloc(program->file_size * sizeof(bfc_token_t));
-	if (!tok_stream->tokens) goto end;
-
-	size_t token_list_size = 0;
-	size_t buffer_index = 0;
+	if (!bfc_token_stream_reserve(tok_stream, BFC_LEX_INITIAL_CAPACITY)) goto end;
 
-	uint32_t line = 1;
-	uint32_t col = 1;
-
-	uint8_t in_comment = 0;
+	const char *buffer = program->buffer;
+	const size_t size = program->file_size;
+	const bfc_lex_classify_t classify = bfc_lex_select_classifier();
 
 #define EMIT_TOKEN(toktype) \
     do { \
-	if (!in_comment) \
-		tok_stream->tokens[token_list_size++] = bfc_make_token((toktype), line, col); \
+	if (!bfc_token_stream_push(tok_stream, (toktype), (uint32_t) buffer_index)) \
+		goto end; \
     } while (0)
 
-	while (program->buffer[buffer_index] != '\0') {
-		switch (program->buffer[buffer_index]) {
-			case ';': {
-				if (cmd_args.f_no_comments) break;
-
-				in_comment = 1;
-			} break;
-			case '+': {
-				EMIT_TOKEN(TT_INC);
-			} break;
-
-			case '-': {
-				EMIT_TOKEN(TT_DEC);
-			} break;
-
-			case '<': {
-				EMIT_TOKEN(TT_PTR_LEFT);
-			} break;
-
-			case '>': {
-				EMIT_TOKEN(TT_PTR_RIGHT);
-			} break;
-
-			case '[': {
-				EMIT_TOKEN(TT_LOOP_START);
-			} break;
-
-			case ']': {
-				EMIT_TOKEN(TT_LOOP_END);
-			} break;
-
-			case ',': {
-				EMIT_TOKEN(TT_INPUT);
-			} break;
-
-			case '.': {
-				EMIT_TOKEN(TT_OUTPUT);
-			} break;
-
-			case '\n': {
-				++line;
-				col = 1;
-				++buffer_index;
-				in_comment = 0;
-				continue;
-			} break;
-
-			default: break;
+	// whole blocks of text and whitespace come back as an empty mask and cost nothing
+	size_t base = 0;
+	while (base < size) {
+		uint64_t mask = (size - base >= BFC_LEX_BLOCK) ? classify(buffer + base) : bfc_lex_classify_tail(buffer + base, size - base);
+		size_t next = base + BFC_LEX_BLOCK;
+
+		while (mask != 0) {
+			const size_t buffer_index = base + (size_t) __builtin_ctzll(mask);
+			mask &= mask - 1;
+
+			switch (buffer[buffer_index]) {
+				case ';': {
+					if (cmd_args.f_no_comments) break;
+
+					// the comment runs up to the end of the line, scanning resumes after it
+					const char *newline = memchr(buffer + buffer_index, '\n', size - buffer_index);
+
+					next = newline ? (size_t) (newline - buffer) + 1 : size;
+					mask = 0;
+				} break;
+				case '+': {
+					EMIT_TOKEN(TT_INC);
+				} break;
+
+				case '-': {
+					EMIT_TOKEN(TT_DEC);
+				} break;
+
+				case '<': {
+					EMIT_TOKEN(TT_PTR_LEFT);
+				} break;
+
+				case '>': {
+					EMIT_TOKEN(TT_PTR_RIGHT);
+				} break;
+
+				case '[': {
+					EMIT_TOKEN(TT_LOOP_START);
+				} break;
+
+				case ']': {
+					EMIT_TOKEN(TT_LOOP_END);
+				} break;
+
+				case ',': {
+					EMIT_TOKEN(TT_INPUT);
+				} break;
+
+				case '.': {
+					EMIT_TOKEN(TT_OUTPUT);
+				} break;
+
+				default: break;
+			}
 		}
 
-		++buffer_index;
-		++col;
+		base = next;
 	}
 
 #undef EMIT_TOKEN
 
-	if (token_list_size > 0) {
-		bfc_token_t *tmp = realloc(tok_stream->tokens, token_list_size * sizeof(bfc_token_t));
-		if (tmp) tok_stream->tokens = tmp;
-	} else {
-		free(tok_stream->tokens);
-		tok_stream->tokens = NULL;
-	}
-	
-	tok_stream->length = token_list_size;
-
 	*token_stream = tok_stream;
 
 	tok_stream = NULL;
@@ -129,10 +271,7 @@ bfc_error_t bfc_lex(bfc_token_stream_t **token_stream, const bfc_program_t *cons
 	err = BFC_ERR_OK;
 
 end:
-	if (tok_stream) {
-		free(tok_stream->tokens);
-		free(tok_stream);
-	}
+	bfc_token_stream_destroy(&tok_stream);
 
 	return err;
 }
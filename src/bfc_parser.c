@@ -0,0 +1,230 @@
+#include "bfc_parser.h"
+
+#include "bfc_lexer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Fused front end: the source buffer is turned into IR in a single pass.
+ * Runs of '+'/'-' and '<'/'>' are summed while scanning, which yields the
+ * same blocks as lexing, bracket matching, bfc_ir_create and
+ * bfc_ir_optimize_rep combined, without materializing tokens or a jump
+ * table. Open blocks live on one scratch stack of instructions and are
+ * copied into the arena at their final size when their ']' is seen. Bytes
+ * are visited through the lexer's block classifier, so text that contains
+ * no commands is skipped 64 bytes at a time.
+ */
+
+typedef struct {
+	// index of the block's first instruction in the scratch code, and of the IR_LOOP that owns it
+	size_t start;
+	size_t loop;
+
+	// source offset of the '[' that opened the block, for diagnostics
+	uint32_t offset;
+} bfc_parse_frame_t;
+
+typedef struct {
+	bfc_ir_instr_t *instr;
+	size_t length;
+	size_t capacity;
+} bfc_parse_code_t;
+
+static uint8_t bfc_parse_append(bfc_parse_code_t *code, const bfc_ir_instr_t instr) {
+
+	if (code->length == code->capacity) {
+		size_t capacity = code->capacity ? 2 * code->capacity : 1024;
+
+		bfc_ir_instr_t *tmp = (bfc_ir_instr_t*) realloc(code->instr, capacity * sizeof(bfc_ir_instr_t));
+		if (!tmp) return 0;
+
+		code->instr = tmp;
+		code->capacity = capacity;
+	}
+
+	code->instr[code->length++] = instr;
+
+	return 1;
+}
+
+static bfc_ir_instr_t bfc_parse_make_instr(const bfc_ir_token_type_t op, const ssize_t imm, const uint32_t src) {
+
+	bfc_ir_instr_t instr = bfc_ir_make_imm_instr(op, imm);
+	instr.src = src;
+
+	return instr;
+}
+
+// moves the innermost open block out of the scratch code into an exactly sized arena block
+static bfc_ir_block_t *bfc_parse_close_block(bfc_parse_code_t *code, const size_t start, bfc_arena_t *const arena) {
+
+	const size_t length = code->length - start;
+
+	bfc_ir_block_t *block = (bfc_ir_block_t*) bfc_arena_alloc(arena, sizeof(bfc_ir_block_t));
+	if (!block) return NULL;
+
+	block->length = length;
+	block->capacity = length ? length : 1;
+	block->writes = NULL;
+	block->instr = (bfc_ir_instr_t*) bfc_arena_alloc(arena, block->capacity * sizeof(bfc_ir_instr_t));
+	if (!block->instr) return NULL;
+
+	memcpy(block->instr, code->instr + start, length * sizeof(bfc_ir_instr_t));
+	code->length = start;
+
+	return block;
+}
+
+bfc_error_t bfc_parse(bfc_ir_block_t **root_block, const bfc_program_t *const program, const bfc_args_t cmd_args, bfc_arena_t *const arena) {
+
+	bfc_error_t err = BFC_ERR_OK;
+	char err_str[512];
+
+	*root_block = NULL;
+
+	bfc_parse_code_t code = {0};
+
+	size_t capacity = 16;
+	size_t depth = 0;
+	bfc_parse_frame_t *stack = NULL;
+
+	if (program->file_size > UINT32_MAX) {
+		err = bfc_make_error(ERR_IO, "Source files larger than 4 GiB are not supported!");
+		goto end;
+	}
+
+	err = BFC_ERR_ALLOC;
+
+	stack = (bfc_parse_frame_t*) malloc(capacity * sizeof(bfc_parse_frame_t));
+	if (!stack) goto end;
+
+	stack[depth++] = (bfc_parse_frame_t) { .start = 0, .loop = 0, .offset = 0 };
+
+	// the ADD or MOVE run being summed up, emitted once a different command shows up
+	bfc_ir_token_type_t pending_op = IR_ADD;
+	ssize_t pending = 0;
+	uint32_t pending_src = UINT32_MAX;
+
+#define FLUSH_PENDING() \
+    do { \
+	if (pending != 0 && !bfc_parse_append(&code, bfc_parse_make_instr(pending_op, pending, pending_src))) \
+		goto end; \
+	pending = 0; \
+	pending_src = UINT32_MAX; \
+    } while (0)
+
+#define ACCUMULATE(op, delta) \
+    do { \
+	if (pending_op != (op)) { \
+		FLUSH_PENDING(); \
+		pending_op = (op); \
+	} \
+	if (pending_src == UINT32_MAX) pending_src = (uint32_t) i; \
+	pending += (delta); \
+    } while (0)
+
+	const char *buffer = program->buffer;
+	const size_t size = program->file_size;
+	const bfc_lex_classify_t classify = bfc_lex_select_classifier();
+
+	size_t base = 0;
+	while (base < size) {
+		uint64_t mask = (size - base >= BFC_LEX_BLOCK) ? classify(buffer + base) : bfc_lex_classify_tail(buffer + base, size - base);
+		size_t next = base + BFC_LEX_BLOCK;
+
+		while (mask != 0) {
+			const size_t i = base + (size_t) __builtin_ctzll(mask);
+			mask &= mask - 1;
+
+			switch (buffer[i]) {
+				case ';': {
+					if (cmd_args.f_no_comments) break;
+
+					const char *newline = memchr(buffer + i, '\n', size - i);
+
+					next = newline ? (size_t) (newline - buffer) + 1 : size;
+					mask = 0;
+				} break;
+
+				case '+': ACCUMULATE(IR_ADD, 1); break;
+				case '-': ACCUMULATE(IR_ADD, -1); break;
+				case '>': ACCUMULATE(IR_MOVE, 1); break;
+				case '<': ACCUMULATE(IR_MOVE, -1); break;
+
+				case '.': {
+					FLUSH_PENDING();
+					if (!bfc_parse_append(&code, bfc_parse_make_instr(IR_PUT, 0, (uint32_t) i))) goto end;
+				} break;
+
+				case ',': {
+					FLUSH_PENDING();
+					if (!bfc_parse_append(&code, bfc_parse_make_instr(IR_GET, 0, (uint32_t) i))) goto end;
+				} break;
+
+				case '[': {
+					FLUSH_PENDING();
+
+					if (!bfc_parse_append(&code, bfc_parse_make_instr(IR_LOOP, 0, (uint32_t) i))) goto end;
+
+					if (depth == capacity) {
+						capacity *= 2;
+
+						bfc_parse_frame_t *tmp = (bfc_parse_frame_t*) realloc(stack, capacity * sizeof(bfc_parse_frame_t));
+						if (!tmp) goto end;
+
+						stack = tmp;
+					}
+
+					stack[depth++] = (bfc_parse_frame_t) { .start = code.length, .loop = code.length - 1, .offset = (uint32_t) i };
+				} break;
+
+				case ']': {
+					FLUSH_PENDING();
+
+					if (depth == 1) {
+						snprintf(err_str, sizeof(err_str), "Found an extra ']'");
+
+						err = bfc_make_error_with_token(ERR_MISMATCHED_BRACKET, err_str, bfc_make_token(TT_LOOP_END, (uint32_t) i));
+						goto end;
+					}
+
+					const bfc_parse_frame_t frame = stack[--depth];
+
+					bfc_ir_block_t *body = bfc_parse_close_block(&code, frame.start, arena);
+					if (!body) goto end;
+
+					code.instr[frame.loop].val.body = (struct bfc_ir_block_t*) body;
+				} break;
+
+				default: break;
+			}
+		}
+
+		base = next;
+	}
+
+	FLUSH_PENDING();
+
+#undef ACCUMULATE
+#undef FLUSH_PENDING
+
+	if (depth > 1) {
+		snprintf(err_str, sizeof(err_str), "Missing a closing bracket ']' for opening bracket '['");
+
+		err = bfc_make_error_with_token(ERR_MISSING_BRACKET, err_str, bfc_make_token(TT_LOOP_START, stack[depth - 1].offset));
+		goto end;
+	}
+
+	*root_block = bfc_parse_close_block(&code, 0, arena);
+	if (!*root_block) goto end;
+
+	err = BFC_ERR_OK;
+
+end:
+	free(code.instr);
+	free(stack);
+
+	return err;
+}
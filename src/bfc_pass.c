@@ -0,0 +1,133 @@
+#include "bfc_pass.h"
+
+#include <string.h>
+
+static bfc_error_t bfc_pass_scan(bfc_ir_block_t **ir_block, bfc_pass_ctx_t *const ctx) {
+
+	(void) ctx;
+
+	return bfc_ir_optimize_scan(ir_block);
+}
+
+static bfc_error_t bfc_pass_mul(bfc_ir_block_t **ir_block, bfc_pass_ctx_t *const ctx) {
+
+	return bfc_ir_optimize_mul(ir_block, ctx->arena);
+}
+
+static bfc_error_t bfc_pass_clear(bfc_ir_block_t **ir_block, bfc_pass_ctx_t *const ctx) {
+
+	(void) ctx;
+
+	return bfc_ir_optimize_clear(ir_block);
+}
+
+static bfc_error_t bfc_pass_offsets(bfc_ir_block_t **ir_block, bfc_pass_ctx_t *const ctx) {
+
+	return bfc_ir_optimize_offsets(ir_block, ctx->runtime.cell_width);
+}
+
+static bfc_error_t bfc_pass_const(bfc_ir_block_t **ir_block, bfc_pass_ctx_t *const ctx) {
+
+	return bfc_ir_optimize_const(ir_block, ctx->runtime.cell_width, ctx->runtime.tape_size, ctx->arena);
+}
+
+static bfc_error_t bfc_pass_partial_eval(bfc_ir_block_t **ir_block, bfc_pass_ctx_t *const ctx) {
+
+	return bfc_eval_prefix(
+		&ctx->snapshot, ir_block, BFC_EVAL_STEP_BUDGET,
+		ctx->runtime.tape_size * ctx->runtime.cell_width, ctx->runtime.cell_width, ctx->arena
+	);
+}
+
+/*
+ * -O1 keeps to the cheap local rewrites, -O2 adds the loop and dataflow
+ * analyses, -O3 also runs the program's input-independent prefix at
+ * compile time. Every pass accepts whatever the passes before it left, so
+ * any of them can be switched off on its own.
+ */
+static const bfc_pass_t bfc_passes[] = {
+	{ "scan",         1, 0, bfc_pass_scan },
+	{ "mul",          2, 0, bfc_pass_mul },
+	{ "clear",        1, 0, bfc_pass_clear },
+	{ "offsets",      1, 0, bfc_pass_offsets },
+	{ "const",        2, 1, bfc_pass_const },
+	{ "partial-eval", 3, 0, bfc_pass_partial_eval },
+};
+
+_Static_assert(sizeof(bfc_passes) / sizeof(bfc_passes[0]) <= BFC_PASS_MAX, "pass masks and statistics are sized by BFC_PASS_MAX");
+
+size_t bfc_pass_count(void) {
+
+	return sizeof(bfc_passes) / sizeof(bfc_passes[0]);
+}
+
+const bfc_pass_t *bfc_pass_get(const size_t index) {
+
+	return index < bfc_pass_count() ? &bfc_passes[index] : NULL;
+}
+
+int bfc_pass_find(const char *name) {
+
+	for (size_t i = 0; i < bfc_pass_count(); ++i) {
+		if (strcmp(bfc_passes[i].name, name) == 0) return (int) i;
+	}
+
+	return -1;
+}
+
+bfc_error_t bfc_pass_run(bfc_ir_block_t **root_block, bfc_pass_ctx_t *const ctx, const bfc_pass_opts_t opts) {
+
+	for (size_t i = 0; i < bfc_pass_count(); ++i) {
+		const bfc_pass_t *pass = &bfc_passes[i];
+		const uint32_t bit = (uint32_t) 1 << i;
+
+		if (opts.disabled & bit) continue;
+		if (pass->level > opts.level && !(opts.enabled & bit)) continue;
+
+		bfc_pass_stat_t *stat = &ctx->stats[i];
+		size_t length = bfc_ir_count(*root_block);
+
+		stat->before = length;
+
+		for (size_t iteration = 0; iteration < BFC_PASS_MAX_ITERATIONS; ++iteration) {
+			const size_t before = length;
+
+			bfc_report_begin(ctx->report, pass->name, before, "instrs");
+			bfc_error_t err = pass->run(root_block, ctx);
+			length = bfc_ir_count(*root_block);
+			bfc_report_end(ctx->report, length, "instrs");
+
+			if (err.code != ERR_OK) return err;
+
+			++stat->runs;
+
+			if (!pass->fixpoint || length >= before) break;
+		}
+
+		stat->after = length;
+
+		if (opts.dump_after & bit) {
+			fprintf(ctx->diag, "*** IR Dump After %s ***\n", pass->name);
+			bfc_ir_dump(*root_block, ctx->diag);
+		}
+	}
+
+	return BFC_ERR_OK;
+}
+
+void bfc_pass_print_stats(const bfc_pass_ctx_t *const ctx, FILE *out) {
+
+	fprintf(out, "===-------------------------------------------------------------------------===\n");
+	fprintf(out, "                          bfc pass statistics\n");
+	fprintf(out, "===-------------------------------------------------------------------------===\n");
+	fprintf(out, "  %-14s %5s %12s %12s %12s\n", "pass", "runs", "before", "after", "removed");
+
+	for (size_t i = 0; i < bfc_pass_count(); ++i) {
+		const bfc_pass_stat_t *stat = &ctx->stats[i];
+		if (stat->runs == 0) continue;
+
+		fprintf(out, "  %-14s %5zu %12zu %12zu %12lld\n",
+			bfc_passes[i].name, stat->runs, stat->before, stat->after, (long long) stat->before - (long long) stat->after
+		);
+	}
+}
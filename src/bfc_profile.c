@@ -0,0 +1,468 @@
+#include "bfc_profile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BFC_PROFILE_MAGIC_SIZE (sizeof(BFC_PROFILE_MAGIC) - 1)
+
+// magic, site count and a reserved word
+#define BFC_PROFILE_FIXED_SIZE (BFC_PROFILE_MAGIC_SIZE + 8)
+
+// line, column and hash
+#define BFC_PROFILE_SITE_SIZE 12
+
+static size_t bfc_profile_count_loops(const bfc_ir_block_t *const ir_block) {
+
+	size_t count = 0;
+
+	for (size_t i = 0; i < ir_block->length; ++i) {
+		if (ir_block->instr[i].op == IR_LOOP)
+			count += 1 + bfc_profile_count_loops((const bfc_ir_block_t*) ir_block->instr[i].val.body);
+	}
+
+	return count;
+}
+
+#define BFC_PROFILE_HASH_SEED 2166136261u
+
+// FNV-1a over the four bytes of `word`
+static uint32_t bfc_profile_hash(uint32_t hash, const uint32_t word) {
+
+	for (size_t i = 0; i < 4; ++i) {
+		hash ^= (uint8_t) (word >> (8 * i));
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+// folds an instruction other than a loop into the hash of its block; `src` and `hints` are left out
+static uint32_t bfc_profile_hash_instr(uint32_t hash, const bfc_ir_instr_t *const instr) {
+
+	hash = bfc_profile_hash(hash, (uint32_t) instr->op);
+	hash = bfc_profile_hash(hash, (uint32_t) instr->off);
+
+	if (instr->op == IR_MUL) {
+		hash = bfc_profile_hash(hash, (uint32_t) instr->val.mul.off);
+
+		return bfc_profile_hash(hash, (uint32_t) instr->val.mul.factor);
+	}
+
+	hash = bfc_profile_hash(hash, (uint32_t) instr->val.imm);
+
+	return bfc_profile_hash(hash, (uint32_t) ((uint64_t) instr->val.imm >> 32));
+}
+
+static uint32_t bfc_profile_hash_loop(const uint32_t body_hash) {
+
+	return bfc_profile_hash(bfc_profile_hash(BFC_PROFILE_HASH_SEED, IR_LOOP), body_hash);
+}
+
+// `hash` receives the hash of the block as it was before the counters went in
+static bfc_error_t bfc_profile_instrument_block(bfc_profile_t *profile, bfc_ir_block_t *block, bfc_program_t *const program, const size_t lead, uint32_t *hash, bfc_arena_t *const arena) {
+
+	size_t loops = 0;
+	for (size_t i = 0; i < block->length; ++i) loops += block->instr[i].op == IR_LOOP;
+
+	const size_t new_length = block->length + loops + lead;
+
+	bfc_ir_instr_t *instr = (bfc_ir_instr_t*) bfc_arena_alloc(arena, new_length * sizeof(bfc_ir_instr_t));
+	if (!instr) return BFC_ERR_ALLOC;
+
+	*hash = BFC_PROFILE_HASH_SEED;
+
+	size_t length = lead;
+	for (size_t i = 0; i < block->length; ++i) {
+		const bfc_ir_instr_t *loop = &block->instr[i];
+
+		if (loop->op != IR_LOOP) {
+			*hash = bfc_profile_hash_instr(*hash, loop);
+			instr[length++] = *loop;
+			continue;
+		}
+
+		const size_t site = profile->length++;
+
+		size_t line = 0;
+		size_t col = 0;
+		bfc_program_locate(program, loop->src, &line, &col);
+
+		profile->sites[site] = (bfc_profile_site_t) { .line = (uint32_t) line, .col = (uint32_t) col };
+
+		instr[length] = bfc_ir_make_imm_instr(IR_COUNT, (ssize_t) (2 * site));
+		instr[length++].src = loop->src;
+		instr[length++] = *loop;
+
+		bfc_ir_block_t *body = (bfc_ir_block_t*) loop->val.body;
+
+		uint32_t body_hash;
+		bfc_error_t err = bfc_profile_instrument_block(profile, body, program, 1, &body_hash, arena);
+		if (err.code != ERR_OK) return err;
+
+		profile->sites[site].hash = bfc_profile_hash_loop(body_hash);
+		*hash = bfc_profile_hash(*hash, profile->sites[site].hash);
+
+		body->instr[0] = bfc_ir_make_imm_instr(IR_COUNT, (ssize_t) (2 * site + 1));
+		body->instr[0].src = loop->src;
+	}
+
+	block->instr = instr;
+	block->length = length;
+	block->capacity = new_length;
+
+	return BFC_ERR_OK;
+}
+
+bfc_error_t bfc_profile_instrument(bfc_profile_t **profile, bfc_ir_block_t **root_block, bfc_program_t *const program, const char *path, bfc_arena_t *const arena) {
+
+	*profile = (bfc_profile_t*) bfc_arena_alloc(arena, sizeof(bfc_profile_t));
+	if (!(*profile)) return BFC_ERR_ALLOC;
+
+	const size_t loops = bfc_profile_count_loops(*root_block);
+
+	(*profile)->length = 0;
+	(*profile)->counters = NULL;
+	(*profile)->path = path;
+	(*profile)->sites = (bfc_profile_site_t*) bfc_arena_alloc(arena, (loops ? loops : 1) * sizeof(bfc_profile_site_t));
+	if (!(*profile)->sites) return BFC_ERR_ALLOC;
+
+	if (loops > UINT32_MAX) return bfc_make_error(ERR_INTERNAL, "Too many loops to profile!");
+
+	uint32_t hash;
+
+	return bfc_profile_instrument_block(*profile, *root_block, program, 0, &hash, arena);
+}
+
+// a loop is the `ordinal`-th one with its `hash`, counting in the order the loops were numbered
+typedef struct {
+	uint32_t hash;
+	uint32_t ordinal;
+	size_t index;
+} bfc_profile_key_t;
+
+typedef struct {
+	const bfc_profile_t *profile;
+	bfc_profile_key_t *keys;
+	uint64_t hot;
+
+	// the loops of the program, numbered like bfc_profile_instrument does
+	bfc_ir_instr_t **loops;
+	bfc_profile_key_t *loop_keys;
+	size_t loop_count;
+} bfc_profile_use_t;
+
+static int bfc_profile_key_order(const void *a, const void *b) {
+
+	const bfc_profile_key_t *left = (const bfc_profile_key_t*) a;
+	const bfc_profile_key_t *right = (const bfc_profile_key_t*) b;
+
+	if (left->hash != right->hash) return left->hash < right->hash ? -1 : 1;
+
+	return left->index < right->index ? -1 : left->index > right->index;
+}
+
+static int bfc_profile_key_compare(const void *a, const void *b) {
+
+	const bfc_profile_key_t *left = (const bfc_profile_key_t*) a;
+	const bfc_profile_key_t *right = (const bfc_profile_key_t*) b;
+
+	if (left->hash != right->hash) return left->hash < right->hash ? -1 : 1;
+
+	return left->ordinal < right->ordinal ? -1 : left->ordinal > right->ordinal;
+}
+
+// fills in the ordinals, leaving `keys` sorted for bfc_profile_key_compare
+static void bfc_profile_number_keys(bfc_profile_key_t *keys, const size_t length) {
+
+	qsort(keys, length, sizeof(bfc_profile_key_t), bfc_profile_key_order);
+
+	for (size_t i = 0; i < length; ++i) {
+		keys[i].ordinal = (i > 0 && keys[i - 1].hash == keys[i].hash) ? keys[i - 1].ordinal + 1 : 0;
+	}
+}
+
+static int bfc_profile_count_compare(const void *a, const void *b) {
+
+	const uint64_t left = *(const uint64_t*) a;
+	const uint64_t right = *(const uint64_t*) b;
+
+	return left < right ? 1 : left > right ? -1 : 0;
+}
+
+// the fewest iterations a hot loop can have
+static bfc_error_t bfc_profile_hot_threshold(const bfc_profile_t *const profile, uint64_t *threshold) {
+
+	uint64_t *counts = (uint64_t*) malloc((profile->length + 1) * sizeof(uint64_t));
+	if (!counts) return BFC_ERR_ALLOC;
+
+	uint64_t total = 0;
+	for (size_t i = 0; i < profile->length; ++i) {
+		counts[i] = profile->counters[2 * i + 1];
+		total += counts[i];
+	}
+
+	qsort(counts, profile->length, sizeof(uint64_t), bfc_profile_count_compare);
+
+	*threshold = UINT64_MAX;
+
+	const uint64_t goal = total - total / 1000 * (1000 - BFC_PROFILE_HOT_PERMILLE);
+
+	uint64_t covered = 0;
+	for (size_t i = 0; i < profile->length && covered < goal; ++i) {
+		covered += counts[i];
+		*threshold = counts[i];
+	}
+
+	if (*threshold < BFC_PROFILE_HOT_MIN) *threshold = BFC_PROFILE_HOT_MIN;
+
+	free(counts);
+
+	return BFC_ERR_OK;
+}
+
+static int bfc_profile_has_loops(const bfc_ir_block_t *const ir_block) {
+
+	for (size_t i = 0; i < ir_block->length; ++i) {
+		if (ir_block->instr[i].op == IR_LOOP) return 1;
+	}
+
+	return 0;
+}
+
+// numbers the loops of `ir_block` in the order bfc_profile_instrument_block does and returns its hash
+static uint32_t bfc_profile_collect_loops(bfc_profile_use_t *use, bfc_ir_block_t *const ir_block) {
+
+	uint32_t hash = BFC_PROFILE_HASH_SEED;
+
+	for (size_t i = 0; i < ir_block->length; ++i) {
+		bfc_ir_instr_t *instr = &ir_block->instr[i];
+
+		if (instr->op != IR_LOOP) {
+			hash = bfc_profile_hash_instr(hash, instr);
+			continue;
+		}
+
+		const size_t index = use->loop_count++;
+		use->loops[index] = instr;
+
+		const uint32_t loop_hash = bfc_profile_hash_loop(bfc_profile_collect_loops(use, (bfc_ir_block_t*) instr->val.body));
+		use->loop_keys[index] = (bfc_profile_key_t) { .hash = loop_hash, .index = index };
+
+		hash = bfc_profile_hash(hash, loop_hash);
+	}
+
+	return hash;
+}
+
+static void bfc_profile_apply_loop(const bfc_profile_use_t *use, bfc_ir_instr_t *const instr, const size_t site) {
+
+	const bfc_ir_block_t *body = (const bfc_ir_block_t*) instr->val.body;
+
+	const uint64_t entries = use->profile->counters[2 * site];
+	const uint64_t iterations = use->profile->counters[2 * site + 1];
+
+	instr->hints = 0;
+
+	if (entries == 0) {
+		instr->hints = IR_HINT_COLD;
+		return;
+	}
+
+	if (iterations < use->hot) return;
+
+	instr->hints |= IR_HINT_ALIGN;
+
+	if (
+		iterations / entries >= BFC_PROFILE_UNROLL_TRIPS &&
+		body->length <= BFC_PROFILE_UNROLL_INSTRS && !bfc_profile_has_loops(body)
+	) instr->hints |= IR_HINT_UNROLL;
+}
+
+bfc_error_t bfc_profile_apply(const bfc_profile_t *const profile, bfc_ir_block_t *const root_block) {
+
+	bfc_profile_use_t use = { .profile = profile };
+
+	bfc_error_t err = bfc_profile_hot_threshold(profile, &use.hot);
+	if (err.code != ERR_OK) return err;
+
+	const size_t loops = bfc_profile_count_loops(root_block);
+
+	err = BFC_ERR_ALLOC;
+
+	use.keys = (bfc_profile_key_t*) malloc((profile->length + 1) * sizeof(bfc_profile_key_t));
+	use.loops = (bfc_ir_instr_t**) malloc((loops + 1) * sizeof(bfc_ir_instr_t*));
+	use.loop_keys = (bfc_profile_key_t*) malloc((loops + 1) * sizeof(bfc_profile_key_t));
+	if (!use.keys || !use.loops || !use.loop_keys) goto end;
+
+	for (size_t i = 0; i < profile->length; ++i) {
+		use.keys[i] = (bfc_profile_key_t) { .hash = profile->sites[i].hash, .index = i };
+	}
+
+	bfc_profile_number_keys(use.keys, profile->length);
+
+	bfc_profile_collect_loops(&use, root_block);
+	bfc_profile_number_keys(use.loop_keys, use.loop_count);
+
+	for (size_t i = 0; i < use.loop_count; ++i) {
+		const bfc_profile_key_t *found = (const bfc_profile_key_t*) bsearch(
+			&use.loop_keys[i], use.keys, profile->length, sizeof(bfc_profile_key_t), bfc_profile_key_compare
+		);
+
+		if (found) bfc_profile_apply_loop(&use, use.loops[use.loop_keys[i].index], found->index);
+	}
+
+	err = BFC_ERR_OK;
+
+end:
+	free(use.keys);
+	free(use.loops);
+	free(use.loop_keys);
+
+	return err;
+}
+
+size_t bfc_profile_counter_count(const bfc_profile_t *const profile) {
+
+	return 2 * profile->length;
+}
+
+size_t bfc_profile_header_size(const bfc_profile_t *const profile) {
+
+	return BFC_PROFILE_FIXED_SIZE + profile->length * BFC_PROFILE_SITE_SIZE;
+}
+
+static void bfc_profile_put_u32(uint8_t *out, const uint32_t value) {
+
+	for (size_t i = 0; i < 4; ++i) out[i] = (uint8_t) (value >> (8 * i));
+}
+
+static uint32_t bfc_profile_get_u32(const uint8_t *in) {
+
+	uint32_t value = 0;
+	for (size_t i = 0; i < 4; ++i) value |= (uint32_t) in[i] << (8 * i);
+
+	return value;
+}
+
+void bfc_profile_encode_header(const bfc_profile_t *const profile, uint8_t *header) {
+
+	memcpy(header, BFC_PROFILE_MAGIC, BFC_PROFILE_MAGIC_SIZE);
+	bfc_profile_put_u32(header + BFC_PROFILE_MAGIC_SIZE, (uint32_t) profile->length);
+	bfc_profile_put_u32(header + BFC_PROFILE_MAGIC_SIZE + 4, 0);
+
+	uint8_t *site = header + BFC_PROFILE_FIXED_SIZE;
+
+	for (size_t i = 0; i < profile->length; ++i, site += BFC_PROFILE_SITE_SIZE) {
+		bfc_profile_put_u32(site, profile->sites[i].line);
+		bfc_profile_put_u32(site + 4, profile->sites[i].col);
+		bfc_profile_put_u32(site + 8, profile->sites[i].hash);
+	}
+}
+
+bfc_error_t bfc_profile_write(const bfc_profile_t *const profile, const uint64_t *counters) {
+
+	const size_t header_size = bfc_profile_header_size(profile);
+	const size_t size = header_size + bfc_profile_counter_count(profile) * 8;
+
+	uint8_t *buffer = (uint8_t*) malloc(size);
+	if (!buffer) return BFC_ERR_ALLOC;
+
+	bfc_profile_encode_header(profile, buffer);
+
+	for (size_t i = 0; i < bfc_profile_counter_count(profile); ++i) {
+		uint8_t *out = buffer + header_size + 8 * i;
+
+		bfc_profile_put_u32(out, (uint32_t) counters[i]);
+		bfc_profile_put_u32(out + 4, (uint32_t) (counters[i] >> 32));
+	}
+
+	bfc_error_t err = bfc_write_file(profile->path, (const char*) buffer, size);
+
+	free(buffer);
+
+	return err;
+}
+
+bfc_error_t bfc_profile_read(bfc_profile_t **profile, const char *path, bfc_arena_t *const arena) {
+
+	char err_str[512];
+
+	bfc_error_t err = BFC_ERR_ALLOC;
+	uint8_t *buffer = NULL;
+
+	FILE *file_handle = fopen(path, "rb");
+	if (!file_handle) {
+		snprintf(err_str, sizeof(err_str), "Unable to open profile '%s'!", path);
+
+		return bfc_make_error(ERR_IO, err_str);
+	}
+
+	size_t capacity = 4096;
+	size_t size = 0;
+
+	buffer = (uint8_t*) malloc(capacity);
+	if (!buffer) goto end;
+
+	for (;;) {
+		if (size == capacity) {
+			uint8_t *tmp = (uint8_t*) realloc(buffer, capacity * 2);
+			if (!tmp) goto end;
+
+			buffer = tmp;
+			capacity *= 2;
+		}
+
+		size_t n = fread(buffer + size, 1, capacity - size, file_handle);
+		if (n == 0) break;
+
+		size += n;
+	}
+
+	if (ferror(file_handle)) {
+		snprintf(err_str, sizeof(err_str), "Unable to read profile '%s'!", path);
+		err = bfc_make_error(ERR_IO, err_str);
+		goto end;
+	}
+
+	const size_t length = size >= BFC_PROFILE_FIXED_SIZE ? bfc_profile_get_u32(buffer + BFC_PROFILE_MAGIC_SIZE) : 0;
+
+	if (
+		size < BFC_PROFILE_FIXED_SIZE || memcmp(buffer, BFC_PROFILE_MAGIC, BFC_PROFILE_MAGIC_SIZE) != 0 ||
+		size != BFC_PROFILE_FIXED_SIZE + length * BFC_PROFILE_SITE_SIZE + length * 16
+	) {
+		snprintf(err_str, sizeof(err_str), "'%s' is not a bfc profile!", path);
+		err = bfc_make_error(ERR_IO, err_str);
+		goto end;
+	}
+
+	*profile = (bfc_profile_t*) bfc_arena_alloc(arena, sizeof(bfc_profile_t));
+	if (!(*profile)) goto end;
+
+	(*profile)->length = length;
+	(*profile)->path = path;
+	(*profile)->sites = (bfc_profile_site_t*) bfc_arena_alloc(arena, (length ? length : 1) * sizeof(bfc_profile_site_t));
+	(*profile)->counters = (uint64_t*) bfc_arena_alloc(arena, (length ? 2 * length : 1) * sizeof(uint64_t));
+	if (!(*profile)->sites || !(*profile)->counters) goto end;
+
+	const uint8_t *site = buffer + BFC_PROFILE_FIXED_SIZE;
+	for (size_t i = 0; i < length; ++i, site += BFC_PROFILE_SITE_SIZE) {
+		(*profile)->sites[i] = (bfc_profile_site_t) { 
+			.line = bfc_profile_get_u32(site), 
+			.col = bfc_profile_get_u32(site + 4), 
+			.hash = bfc_profile_get_u32(site + 8) 
+		};
+	}
+
+	for (size_t i = 0; i < 2 * length; ++i, site += 8) {
+		(*profile)->counters[i] = (uint64_t) bfc_profile_get_u32(site) | (uint64_t) bfc_profile_get_u32(site + 4) << 32;
+	}
+
+	err = BFC_ERR_OK;
+
+end:
+	fclose(file_handle);
+	free(buffer);
+
+	return err;
+}
@@ -0,0 +1,184 @@
+#define _GNU_SOURCE
+
+#include "bfc_report.h"
+
+#include <malloc.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+static double bfc_report_clock(const clockid_t clock) {
+
+	struct timespec ts;
+	if (clock_gettime(clock, &ts) != 0) return 0;
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static size_t bfc_report_heap_bytes(void) {
+
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+	const struct mallinfo2 info = mallinfo2();
+
+	return info.uordblks + info.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static size_t bfc_report_peak_rss(void) {
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+
+	// Linux reports kilobytes
+	return (size_t) usage.ru_maxrss * 1024;
+}
+
+uint8_t bfc_report_enabled(const bfc_report_t *const report) {
+
+	return report && (report->time || report->mem);
+}
+
+void bfc_report_begin(bfc_report_t *const report, const char *name, const size_t in, const char *in_unit) {
+
+	if (!bfc_report_enabled(report)) return;
+
+	bfc_report_phase_t *phase = NULL;
+	for (size_t i = 0; i < report->length; ++i) {
+		if (strcmp(report->phases[i].name, name) == 0) phase = &report->phases[i];
+	}
+
+	if (!phase) {
+		// further phases go unreported rather than failing the compile
+		if (report->length == BFC_REPORT_MAX_PHASES) return;
+
+		phase = &report->phases[report->length++];
+		memset(phase, 0, sizeof(*phase));
+		phase->name = name;
+	}
+
+	++phase->runs;
+	phase->in += in;
+	phase->in_unit = in_unit;
+
+	report->current = phase;
+	report->arena_start = report->arena ? report->arena->bytes_allocated : 0;
+	report->cpu_start = bfc_report_clock(CLOCK_THREAD_CPUTIME_ID);
+	report->wall_start = bfc_report_clock(CLOCK_MONOTONIC);
+}
+
+void bfc_report_end(bfc_report_t *const report, const size_t out, const char *out_unit) {
+
+	if (!bfc_report_enabled(report) || !report->current) return;
+
+	const double wall = bfc_report_clock(CLOCK_MONOTONIC);
+	const double cpu = bfc_report_clock(CLOCK_THREAD_CPUTIME_ID);
+
+	bfc_report_phase_t *phase = report->current;
+	report->current = NULL;
+
+	phase->wall += wall - report->wall_start;
+	phase->cpu += cpu - report->cpu_start;
+
+	// the arena only grows; if this phase created it, it started out at 0
+	if (report->arena) phase->arena_bytes += report->arena->bytes_allocated - report->arena_start;
+
+	if (report->mem) {
+		phase->heap_bytes = bfc_report_heap_bytes();
+		phase->peak_rss = bfc_report_peak_rss();
+	}
+
+	phase->out += out;
+	phase->out_unit = out_unit;
+}
+
+// `bytes` scaled to the largest unit that keeps it at or above 1, in a 10 character field
+static void bfc_report_print_bytes(FILE *out, const size_t bytes) {
+
+	static const char *const units[] = { "B", "KiB", "MiB", "GiB" };
+
+	double value = (double) bytes;
+	size_t unit = 0;
+
+	while (value >= 1024 && unit < 3) {
+		value /= 1024;
+		++unit;
+	}
+
+	if (unit == 0) {
+		fprintf(out, "%6zu %-3s", bytes, units[unit]);
+	} else {
+		fprintf(out, "%6.1f %-3s", value, units[unit]);
+	}
+}
+
+static void bfc_report_print_count(FILE *out, const size_t count, const char *unit) {
+
+	if (!unit) {
+		fprintf(out, "  %10s %-6s", "-", "");
+	} else {
+		fprintf(out, "  %10zu %-6s", count, unit);
+	}
+}
+
+void bfc_report_print(const bfc_report_t *const report, FILE *out) {
+
+	if (!bfc_report_enabled(report) || report->length == 0) return;
+
+	double total_wall = 0;
+	double total_cpu = 0;
+	size_t total_arena = 0;
+
+	for (size_t i = 0; i < report->length; ++i) {
+		total_wall += report->phases[i].wall;
+		total_cpu += report->phases[i].cpu;
+		total_arena += report->phases[i].arena_bytes;
+	}
+
+	fprintf(out, "===-------------------------------------------------------------------------===\n");
+	fprintf(out, "                          bfc phase %s report\n", report->time ? (report->mem ? "time and memory" : "time") : "memory");
+	fprintf(out, "===-------------------------------------------------------------------------===\n");
+
+	if (report->time) fprintf(out, "  Total: %.4f seconds wall, %.4f seconds CPU\n", total_wall, total_cpu);
+	if (report->mem) {
+		fprintf(out, "  Total: ");
+		bfc_report_print_bytes(out, total_arena);
+		fprintf(out, " from the arena\n");
+	}
+
+	fprintf(out, "\n");
+
+	// each heading spans its column exactly
+	if (report->time) fprintf(out, "   ---Wall Time---  --CPU--");
+	if (report->mem) fprintf(out, "  --Arena--- ---Heap--- -Peak RSS-");
+	fprintf(out, "  -------In--------  -------Out-------  ---Name---\n");
+
+	for (size_t i = 0; i < report->length; ++i) {
+		const bfc_report_phase_t *phase = &report->phases[i];
+
+		if (report->time) {
+			fprintf(out, "  %7.4f (%5.1f%%)  %7.4f",
+				phase->wall, total_wall > 0 ? 100.0 * phase->wall / total_wall : 0.0, phase->cpu
+			);
+		}
+
+		if (report->mem) {
+			fprintf(out, "  ");
+			bfc_report_print_bytes(out, phase->arena_bytes);
+			fprintf(out, " ");
+			bfc_report_print_bytes(out, phase->heap_bytes);
+			fprintf(out, " ");
+			bfc_report_print_bytes(out, phase->peak_rss);
+		}
+
+		bfc_report_print_count(out, phase->in, phase->in_unit);
+		bfc_report_print_count(out, phase->out, phase->out_unit);
+
+		if (phase->runs > 1) {
+			fprintf(out, "  %s (%zu runs)\n", phase->name, phase->runs);
+		} else {
+			fprintf(out, "  %s\n", phase->name);
+		}
+	}
+}
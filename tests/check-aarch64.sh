@@ -0,0 +1,79 @@
+#!/bin/sh
+#
+# Cross-compiles every program in bench/corpus and tests/ for aarch64 Linux,
+# assembles and links it with binutils, runs it under qemu-user and compares
+# its output with the x86_64 build of the same program.
+#
+# usage: tests/check-aarch64.sh [bfc]
+#
+# CROSS_COMPILE (default aarch64-linux-gnu-) prefixes as and ld, QEMU
+# (default qemu-aarch64) runs the result. Without them the check is skipped.
+
+BFC=${1:-./bfc}
+CROSS_COMPILE=${CROSS_COMPILE:-aarch64-linux-gnu-}
+QEMU=${QEMU:-qemu-aarch64}
+
+for tool in "${CROSS_COMPILE}as" "${CROSS_COMPILE}ld" "$QEMU"; do
+	if ! command -v "$tool" >/dev/null 2>&1; then
+		echo "check-aarch64: $tool not found, skipped"
+		exit 0
+	fi
+done
+
+scratch=$(mktemp -d "${TMPDIR:-/tmp}/bfc-check-XXXXXX") || exit 1
+trap 'rm -rf "$scratch"' EXIT
+
+# the reference is the native build where the host can run it, the interpreter elsewhere
+case $(uname -m) in
+	x86_64) native=1 ;;
+	*)      native=0 ;;
+esac
+
+failed=0
+count=0
+
+for src in bench/corpus/*.b tests/*.bf; do
+	name=$(basename "$src")
+	flags=$(sed -n 's/^; bfc-flags: *//p' "$src" | head -n 1)
+	input=/dev/null
+	[ -f "${src%.*}.in" ] && input="${src%.*}.in"
+
+	count=$((count + 1))
+
+	# shellcheck disable=SC2086
+	if ! "$BFC" $flags -S --target=aarch64 "$src" -o "$scratch/a64.s" ||
+	   ! "${CROSS_COMPILE}as" "$scratch/a64.s" -o "$scratch/a64.o" ||
+	   ! "${CROSS_COMPILE}ld" -static "$scratch/a64.o" -o "$scratch/a64"; then
+		echo "FAIL $name: aarch64 build"
+		failed=$((failed + 1))
+		continue
+	fi
+
+	# shellcheck disable=SC2086
+	if [ $native -eq 1 ]; then
+		"$BFC" $flags "$src" -o "$scratch/x64" && "$scratch/x64" < "$input" > "$scratch/expected"
+	else
+		"$BFC" $flags --interpret "$src" < "$input" > "$scratch/expected"
+	fi
+
+	if [ $? -ne 0 ]; then
+		echo "FAIL $name: reference build"
+		failed=$((failed + 1))
+		continue
+	fi
+
+	"$QEMU" "$scratch/a64" < "$input" > "$scratch/actual"
+	status=$?
+
+	if [ $status -ne 0 ] || ! cmp -s "$scratch/expected" "$scratch/actual"; then
+		echo "FAIL $name: aarch64 output differs (exit status $status)"
+		failed=$((failed + 1))
+		continue
+	fi
+
+	echo "ok   $name"
+done
+
+echo "check-aarch64: $((count - failed)) of $count programs passed"
+
+[ $failed -eq 0 ]
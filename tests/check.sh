@@ -0,0 +1,135 @@
+#!/bin/sh
+#
+# Differential test: runs every program in tests/ on each engine (the
+# interpreter, the JIT and a native executable) at every -O level, with
+# each pass switched off on its own and built from its own profile, and
+# compares its output, exit status and tape overflow diagnostic with an
+# unoptimized interpreter run.
+#
+# usage: tests/check.sh [bfc]
+
+BFC=${1:-./bfc}
+PASSES="scan mul clear offsets const partial-eval"
+
+scratch=$(mktemp -d "${TMPDIR:-/tmp}/bfc-check-XXXXXX") || exit 1
+trap 'rm -rf "$scratch"' EXIT
+
+failed=0
+count=0
+
+# the "tape overflow at <line>:<col>" every engine prints, without bfc's own error prefix
+diagnostic() {
+	grep -o 'tape overflow at [0-9]*:[0-9]*' "$1"
+}
+
+# run <name> <config> <engine> <flags...>: one compile and run, compared with the reference
+run() {
+	name=$1
+	config=$2
+	engine=$3
+	shift 3
+
+	count=$((count + 1))
+
+	if [ "$engine" = native ]; then
+		if ! "$BFC" "$@" "$src" -o "$scratch/exe" 2> "$scratch/stderr"; then
+			echo "FAIL $name $config native: compile failed"
+			cat "$scratch/stderr"
+			failed=$((failed + 1))
+			return
+		fi
+
+		"$scratch/exe" < "$input" > "$scratch/actual" 2> "$scratch/stderr"
+	else
+		"$BFC" "$@" "$engine" "$src" < "$input" > "$scratch/actual" 2> "$scratch/stderr"
+	fi
+
+	status=$?
+
+	if [ $status -ne "$ref_status" ]; then
+		echo "FAIL $name $config $engine: exit status $status, expected $ref_status"
+		failed=$((failed + 1))
+	elif ! cmp -s "$scratch/expected" "$scratch/actual"; then
+		echo "FAIL $name $config $engine: output differs"
+		failed=$((failed + 1))
+	elif [ "$(diagnostic "$scratch/stderr")" != "$ref_diagnostic" ]; then
+		echo "FAIL $name $config $engine: diagnostic differs"
+		cat "$scratch/stderr"
+		failed=$((failed + 1))
+	fi
+}
+
+for src in tests/*.bf; do
+	name=$(basename "$src")
+	flags=$(sed -n 's/^; bfc-flags: *//p' "$src" | head -n 1)
+	input=/dev/null
+	[ -f "${src%.*}.in" ] && input="${src%.*}.in"
+
+	# shellcheck disable=SC2086
+	"$BFC" $flags -O0 --interpret "$src" < "$input" > "$scratch/expected" 2> "$scratch/stderr"
+	ref_status=$?
+	ref_diagnostic=$(diagnostic "$scratch/stderr")
+
+	for engine in --interpret --run native; do
+		for level in -O0 -O1 -O2 -O3; do
+			# shellcheck disable=SC2086
+			run "$name" "$level" "$engine" $flags $level
+		done
+
+		# shellcheck disable=SC2086
+		run "$name" "-fstaged-frontend" "$engine" $flags -O3 -fstaged-frontend
+
+		# -O2 leaves partial evaluation out, which otherwise folds most of these programs away
+		for pass in $PASSES; do
+			level=-O2
+			[ "$pass" = partial-eval ] && level=-O3
+
+			# shellcheck disable=SC2086
+			run "$name" "-fno-$pass" "$engine" $flags $level "-fno-$pass"
+		done
+
+		# the instrumented program writes its own profile, the next build lays its loops out by it
+		rm -f "$scratch/profile"
+
+		# shellcheck disable=SC2086
+		run "$name" "-fprofile-generate" "$engine" $flags "-fprofile-generate=$scratch/profile"
+
+		if [ ! -f "$scratch/profile" ] && [ "$ref_status" -eq 0 ]; then
+			echo "FAIL $name -fprofile-generate $engine: no profile written"
+			failed=$((failed + 1))
+		fi
+
+		if [ -f "$scratch/profile" ]; then
+			# shellcheck disable=SC2086
+			run "$name" "-fprofile-use" "$engine" $flags "-fprofile-use=$scratch/profile"
+		fi
+	done
+done
+
+# a batch must refuse to write over one of its inputs, however the input is spelled
+count=$((count + 1))
+mkdir "$scratch/batch"
+cp tests/hello.bf "$scratch/batch/prog"
+cp tests/hello.bf "$scratch/batch/other.bf"
+
+bfc_path=$(cd "$(dirname "$BFC")" && pwd)/$(basename "$BFC")
+
+if (cd "$scratch/batch" && "$bfc_path" ./prog other.bf 2> /dev/null) || ! cmp -s tests/hello.bf "$scratch/batch/prog"; then
+	echo "FAIL batch ./prog other.bf: the output overwrites its input"
+	failed=$((failed + 1))
+fi
+
+# a profile still finds the hot loop once code in front of it has changed
+count=$((count + 1))
+rm -f "$scratch/profile"
+"$BFC" --interpret "-fprofile-generate=$scratch/profile" tests/hot.bf > /dev/null
+{ echo '+[>++[-<+>]<-]>[-]'; echo; cat tests/hot.bf; } > "$scratch/edited.bf"
+
+if ! "$BFC" -S "-fprofile-use=$scratch/profile" "$scratch/edited.bf" -o "$scratch/edited.s" || ! grep -q p2align "$scratch/edited.s"; then
+	echo "FAIL profile of hot.bf: the hot loop is not found after an edit in front of it"
+	failed=$((failed + 1))
+fi
+
+echo "check: $((count - failed)) of $count runs passed"
+
+[ $failed -eq 0 ]
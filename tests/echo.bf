@@ -0,0 +1,4 @@
+; echo.bf: copies its input to its output with every byte moved up by one,
+; so partial evaluation stops at the first read
+
+,[>+<[->+<]>.[-]<,]
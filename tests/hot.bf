@@ -0,0 +1,7 @@
+; hot.bf: prints 64 lines of 64 stars from a loop that runs 4096 times, hot
+; enough for -fprofile-use to align and unroll it
+
+>>>>++++++[<<+++++++>>-]<++++++++++<<<
+>>>>++++++++[<<<<++++++++>>>>-]<<<<
+[>>>>++++++++[<<<++++++++>>>-]<<<[>.<-]>>.<<<-]
+>>>>>[.[-]]
@@ -0,0 +1,5 @@
+; overflow-move.bf: steps off the left end of the tape and back without
+; touching a cell there, prints "ok" and ends off the tape again; moving
+; alone never faults, so every engine has to run it to the end
+
+<<<>>>++++++++++[>+++++++++++>+++++++++++<<-]>+.>---.<<<<<
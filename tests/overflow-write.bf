@@ -0,0 +1,5 @@
+; overflow-write.bf: prints "ok" and then ends on an increment of a cell off
+; the left end of the tape; the cell is never read again, but the write
+; still has to fault
+
+++++++++++[>+++++++++++>+++++++++++<<-]>+.>---.<<<+
@@ -0,0 +1,5 @@
+; overflow.bf: prints "ok" and then prints a cell off the left end of the
+; tape, which every engine has to report after flushing what was printed
+; before
+
+++++++++++[>+++++++++++>+++++++++++<<-]>+.>---.<<<.
@@ -0,0 +1,19 @@
+; passes.bf: one loop shape for each optimization pass; prints "ABC  XYZ!" and a newline
+
+; mul: 8 * 8 + 1 into cell 1, copied to cells 2 and 3 by a balanced transfer loop
+++++++++[>++++++++<-]>+.
+[->+>+<<]>+.>++.
+
+; clear: both copies cleared again, a space printed from a fresh cell
+[-]<[-]>>++++[<++++++++>-]<..
+
+; scan: a row of nonzero cells walked back to the zero before it
+>+>+>+>+[<]
+>>>>[-]<[-]<[-]<[-]
+
+; offsets and const: straight-line arithmetic on neighbouring cells
+>>++++++++++[>+++++++++<-]>--.+.+.
+
+; a nested loop whose body does not reduce to a multiplication
+[-]<+++[>+++[>+++[>+<-]<-]<-]>>>+++++.
+[-]++++++++++.
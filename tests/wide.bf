@@ -0,0 +1,9 @@
+; wide.bf: builds 1000 in one cell, which only 16-bit cells can hold, then
+; counts it down by eights printing a '*' for each: 125 of them, not the
+; 29 an 8-bit cell would give
+; bfc-flags: -fcell-width=16
+
+++++++++++[>++++++++++[>++++++++++<-]<-]
+>>>>++++++[<+++++++>-]<<
+[>>++++++++[<<->>-]<.<]
+>[-]++++++++++.
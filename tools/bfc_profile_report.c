@@ -0,0 +1,163 @@
+#include "bfc_arena.h"
+#include "bfc_error.h"
+#include "bfc_io.h"
+#include "bfc_profile.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * bfc-profile: ranks the loops of a -fprofile-generate run by how often
+ * their bodies ran. Given the program's source as well, it also shows the
+ * code starting at each loop's `[`.
+ */
+
+#define BFC_PROFILE_REPORT_DEFAULT_COUNT 20
+#define BFC_PROFILE_REPORT_SNIPPET 40
+
+typedef struct {
+	size_t site;
+	uint64_t entries;
+	uint64_t iterations;
+} bfc_profile_report_row_t;
+
+static void bfc_profile_report_usage(void) {
+
+	fprintf(stderr, "usage: bfc-profile [-n <count>] <profile> [<source.bf>]\n");
+	fprintf(stderr, "  -n <count>  Show the <count> hottest loops (default %d, 0 for all)\n", BFC_PROFILE_REPORT_DEFAULT_COUNT);
+}
+
+static int bfc_profile_report_compare(const void *a, const void *b) {
+
+	const bfc_profile_report_row_t *left = (const bfc_profile_report_row_t*) a;
+	const bfc_profile_report_row_t *right = (const bfc_profile_report_row_t*) b;
+
+	if (left->iterations != right->iterations) return left->iterations < right->iterations ? 1 : -1;
+	if (left->entries != right->entries) return left->entries < right->entries ? 1 : -1;
+
+	// ties stay in source order
+	return left->site < right->site ? -1 : left->site > right->site;
+}
+
+// the source from the loop's `[` on, as far as it fits on one line
+static void bfc_profile_report_snippet(bfc_program_t *program, const bfc_profile_site_t site, FILE *out) {
+
+	char *line = bfc_program_getline(program, site.line);
+	if (!line) return;
+
+	size_t length = strlen(line);
+	const char *start = site.col > 0 && site.col <= length ? line + site.col - 1 : line + length;
+
+	for (size_t i = 0; start[i] != '\0' && i < BFC_PROFILE_REPORT_SNIPPET; ++i) {
+		fputc((start[i] >= ' ' && start[i] <= '~') ? start[i] : ' ', out);
+	}
+
+	if (strlen(start) > BFC_PROFILE_REPORT_SNIPPET) fputs("...", out);
+
+	free(line);
+}
+
+int main(int argc, char **argv) {
+
+	int ret = EXIT_FAILURE;
+
+	const char *profile_path = NULL;
+	const char *source_path = NULL;
+	size_t count = BFC_PROFILE_REPORT_DEFAULT_COUNT;
+
+	bfc_arena_t *arena = NULL;
+	bfc_program_t *program = NULL;
+	bfc_profile_t *profile = NULL;
+	bfc_profile_report_row_t *rows = NULL;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			char *end = NULL;
+			count = (size_t) strtoull(argv[++i], &end, 10);
+
+			if (*end != '\0') {
+				bfc_profile_report_usage();
+				goto end;
+			}
+		} else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+			bfc_profile_report_usage();
+			goto end;
+		} else if (!profile_path) {
+			profile_path = argv[i];
+		} else if (!source_path) {
+			source_path = argv[i];
+		} else {
+			bfc_profile_report_usage();
+			goto end;
+		}
+	}
+
+	if (!profile_path) {
+		bfc_profile_report_usage();
+		goto end;
+	}
+
+	bfc_error_t err = bfc_arena_create(&arena);
+	if (err.code == ERR_OK) err = bfc_profile_read(&profile, profile_path, arena);
+	if (err.code == ERR_OK && source_path) err = bfc_program_create(&program, source_path);
+
+	if (err.code != ERR_OK) {
+		fprintf(stderr, "bfc-profile: %s\n", err.msg);
+		goto end;
+	}
+
+	rows = (bfc_profile_report_row_t*) malloc((profile->length + 1) * sizeof(bfc_profile_report_row_t));
+	if (!rows) {
+		fprintf(stderr, "bfc-profile: %s\n", BFC_ERR_ALLOC.msg);
+		goto end;
+	}
+
+	uint64_t total = 0;
+	for (size_t i = 0; i < profile->length; ++i) {
+		rows[i] = (bfc_profile_report_row_t) {
+			.site = i,
+			.entries = profile->counters[2 * i],
+			.iterations = profile->counters[2 * i + 1],
+		};
+
+		total += rows[i].iterations;
+	}
+
+	qsort(rows, profile->length, sizeof(bfc_profile_report_row_t), bfc_profile_report_compare);
+
+	if (count == 0 || count > profile->length) count = profile->length;
+
+	printf("%zu loops in '%s', %llu iterations in total\n\n", profile->length, profile_path, (unsigned long long) total);
+	printf("%6s %16s %7s %14s %12s  %s\n", "rank", "iterations", "share", "entries", "per entry", source_path ? "location    source" : "location");
+
+	for (size_t i = 0; i < count; ++i) {
+		const bfc_profile_report_row_t *row = &rows[i];
+		const bfc_profile_site_t site = profile->sites[row->site];
+
+		char location[32];
+		snprintf(location, sizeof(location), "%u:%u", site.line, site.col);
+
+		printf("%6zu %16llu %6.2f%% %14llu %12.1f  %-*s",
+			i + 1, (unsigned long long) row->iterations,
+			total ? 100.0 * (double) row->iterations / (double) total : 0.0,
+			(unsigned long long) row->entries,
+			row->entries ? (double) row->iterations / (double) row->entries : 0.0,
+			program ? 12 : 0, location
+		);
+
+		if (program) bfc_profile_report_snippet(program, site, stdout);
+
+		printf("\n");
+	}
+
+	ret = EXIT_SUCCESS;
+
+end:
+	free(rows);
+	if (program) bfc_program_destroy(&program);
+	if (arena)   bfc_arena_destroy(&arena);
+
+	return ret;
+}